@@ -0,0 +1,177 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+
+#include <memory>
+#include <string>
+#include <benchmark/benchmark.h>
+
+#include <paraconf.h>
+#include <pdi.h>
+
+/* Writes a deflated 2D matrix with square chunks of a given edge, 0 meaning
+ * automatic chunking
+ */
+static void PDI_write_chunked(benchmark::State& state)
+{
+	std::string edge = std::to_string(state.range(1));
+	std::string chunking = state.range(1) ? "[" + edge + ", " + edge + "]" : "auto";
+	std::string config_yaml
+		= "logging: off                                                  \n"
+		  "metadata:                                                     \n"
+		  "  matrix_size: { size: 2, type: array, subtype: int64 }       \n"
+		  "data:                                                         \n"
+		  "  matrix_data:                                                \n"
+		  "    type: array                                               \n"
+		  "    subtype: double                                           \n"
+		  "    size: ['${matrix_size[0]}', '${matrix_size[1]}']          \n"
+		  "plugins:                                                      \n"
+		  "  decl_hdf5:                                                  \n"
+		  "    file: chunked_matrix_data.h5                              \n"
+		  "    collision_policy: replace                                 \n"
+		  "    write:                                                    \n"
+		  "      matrix_data:                                            \n"
+		  "        deflate: 1                                            \n"
+		  "        chunking: "
+		+ chunking + "\n";
+
+	int64_t matrix_size[2] = {state.range(0), state.range(0)};
+	std::unique_ptr<double[]> matrix{static_cast<double*>(operator new[] (matrix_size[0] * matrix_size[1] * sizeof(double)))};
+	for (int i = 0; i < matrix_size[0] * matrix_size[1]; i++) {
+		matrix[i] = i * 1.2345;
+	}
+	PDI_init(PC_parse_string(config_yaml.c_str()));
+	PDI_expose("matrix_size", matrix_size, PDI_OUT);
+	for (auto _: state) {
+		PDI_expose("matrix_data", matrix.get(), PDI_OUT);
+	}
+	PDI_finalize();
+	state.SetBytesProcessed(state.iterations() * matrix_size[0] * matrix_size[1] * sizeof(double));
+}
+
+BENCHMARK(PDI_write_chunked)
+	->Name("Decl_hdf5_chunking/PDI_write")
+	->ArgsProduct({{1024, 2048}, {0, 16, 64, 256, 1024}})
+	->Unit(benchmark::kMillisecond);
+
+/* Reads back a deflated 2D matrix written with square chunks of a given edge,
+ * 0 meaning automatic chunking
+ */
+static void PDI_read_chunked(benchmark::State& state)
+{
+	std::string edge = std::to_string(state.range(1));
+	std::string chunking = state.range(1) ? "[" + edge + ", " + edge + "]" : "auto";
+	std::string config_yaml
+		= "logging: off                                                  \n"
+		  "metadata:                                                     \n"
+		  "  matrix_size: { size: 2, type: array, subtype: int64 }       \n"
+		  "  input: int                                                  \n"
+		  "data:                                                         \n"
+		  "  matrix_data:                                                \n"
+		  "    type: array                                               \n"
+		  "    subtype: double                                           \n"
+		  "    size: ['${matrix_size[0]}', '${matrix_size[1]}']          \n"
+		  "plugins:                                                      \n"
+		  "  decl_hdf5:                                                  \n"
+		  "    - file: chunked_matrix_data.h5                            \n"
+		  "      collision_policy: replace                               \n"
+		  "      when: $input=0                                          \n"
+		  "      write:                                                  \n"
+		  "        matrix_data:                                          \n"
+		  "          deflate: 1                                          \n"
+		  "          chunking: "
+		+ chunking
+		+ "\n"
+		  "    - file: chunked_matrix_data.h5                            \n"
+		  "      when: $input=1                                          \n"
+		  "      read: [matrix_data]                                     \n";
+
+	int64_t matrix_size[2] = {state.range(0), state.range(0)};
+	std::unique_ptr<double[]> matrix{static_cast<double*>(operator new[] (matrix_size[0] * matrix_size[1] * sizeof(double)))};
+	for (int i = 0; i < matrix_size[0] * matrix_size[1]; i++) {
+		matrix[i] = i * 1.2345;
+	}
+	PDI_init(PC_parse_string(config_yaml.c_str()));
+	PDI_expose("matrix_size", matrix_size, PDI_OUT);
+	int input = 0;
+	PDI_expose("input", &input, PDI_OUT);
+	PDI_expose("matrix_data", matrix.get(), PDI_OUT);
+	input = 1;
+	PDI_expose("input", &input, PDI_OUT);
+	for (auto _: state) {
+		PDI_expose("matrix_data", matrix.get(), PDI_IN);
+	}
+	PDI_finalize();
+	state.SetBytesProcessed(state.iterations() * matrix_size[0] * matrix_size[1] * sizeof(double));
+}
+
+BENCHMARK(PDI_read_chunked)
+	->Name("Decl_hdf5_chunking/PDI_read")
+	->ArgsProduct({{1024, 2048}, {0, 16, 64, 256, 1024}})
+	->Unit(benchmark::kMillisecond);
+
+/* Writes a deflated and shuffled 2D matrix compressing its chunks with a given
+ * number of threads, 1 meaning compression by HDF5
+ */
+static void PDI_write_threads(benchmark::State& state)
+{
+	std::string config_yaml
+		= "logging: off                                                  \n"
+		  "metadata:                                                     \n"
+		  "  matrix_size: { size: 2, type: array, subtype: int64 }       \n"
+		  "data:                                                         \n"
+		  "  matrix_data:                                                \n"
+		  "    type: array                                               \n"
+		  "    subtype: double                                           \n"
+		  "    size: ['${matrix_size[0]}', '${matrix_size[1]}']          \n"
+		  "plugins:                                                      \n"
+		  "  decl_hdf5:                                                  \n"
+		  "    file: chunked_matrix_data.h5                              \n"
+		  "    collision_policy: replace                                 \n"
+		  "    write:                                                    \n"
+		  "      matrix_data:                                            \n"
+		  "        deflate: 1                                            \n"
+		  "        shuffle: 1                                            \n"
+		  "        compression_threads: "
+		+ std::to_string(state.range(1)) + "\n";
+
+	int64_t matrix_size[2] = {state.range(0), state.range(0)};
+	std::unique_ptr<double[]> matrix{static_cast<double*>(operator new[] (matrix_size[0] * matrix_size[1] * sizeof(double)))};
+	for (int i = 0; i < matrix_size[0] * matrix_size[1]; i++) {
+		matrix[i] = i * 1.2345;
+	}
+	PDI_init(PC_parse_string(config_yaml.c_str()));
+	PDI_expose("matrix_size", matrix_size, PDI_OUT);
+	for (auto _: state) {
+		PDI_expose("matrix_data", matrix.get(), PDI_OUT);
+	}
+	PDI_finalize();
+	state.SetBytesProcessed(state.iterations() * matrix_size[0] * matrix_size[1] * sizeof(double));
+}
+
+BENCHMARK(PDI_write_threads)
+	->Name("Decl_hdf5_chunking/PDI_write_threads")
+	->ArgsProduct({{1024, 2048}, {1, 2, 4, 8, 0}})
+	->Unit(benchmark::kMillisecond)
+	->UseRealTime();
@@ -0,0 +1,491 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include <mpi.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include <hdf5.h>
+
+#include <paraconf.h>
+#include <pdi.h>
+
+/* Every benchmark of this file is run by all the processes of MPI_COMM_WORLD,
+ * the time of an iteration being that of the slowest process so that all
+ * processes agree on the number of iterations to run. Only the first process
+ * reports the results.
+ */
+
+namespace {
+
+int world_rank()
+{
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	return rank;
+}
+
+int world_size()
+{
+	int size;
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+	return size;
+}
+
+/* Runs the benchmark loop, timing each iteration from a barrier to the end of
+ * the slowest process and reporting the bytes written by all processes
+ */
+template <class Io>
+void timed_loop(benchmark::State& state, int64_t bytes_per_process, Io&& io)
+{
+	for (auto _: state) {
+		MPI_Barrier(MPI_COMM_WORLD);
+		double start = MPI_Wtime();
+		io();
+		double elapsed = MPI_Wtime() - start;
+		MPI_Allreduce(MPI_IN_PLACE, &elapsed, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+		state.SetIterationTime(elapsed);
+	}
+	state.SetBytesProcessed(state.iterations() * bytes_per_process * world_size());
+}
+
+std::vector<double> make_field(int64_t n)
+{
+	std::vector<double> field(n);
+	for (int64_t i = 0; i < n; i++) {
+		field[i] = (world_rank() * n + i) * 1.2345;
+	}
+	return field;
+}
+
+/* The PDI configuration header shared by all PDI benchmarks, with a `field` of
+ * `n` doubles per process
+ */
+std::string pdi_header()
+{
+	return "logging: off                                                  \n"
+	       "metadata:                                                     \n"
+	       "  rank: int                                                   \n"
+	       "  size: int                                                   \n"
+	       "  n: int64                                                    \n"
+	       "  index: int                                                  \n"
+	       "data:                                                         \n"
+	       "  field: { type: array, subtype: double, size: $n }           \n"
+	       "plugins:                                                      \n"
+	       "  mpi:                                                        \n"
+	       "  decl_hdf5:                                                  \n";
+}
+
+void pdi_init(const std::string& config_yaml, int64_t n)
+{
+	PDI_init(PC_parse_string(config_yaml.c_str()));
+	int rank = world_rank();
+	int size = world_size();
+	PDI_expose("rank", &rank, PDI_OUT);
+	PDI_expose("size", &size, PDI_OUT);
+	PDI_expose("n", &n, PDI_OUT);
+}
+
+/* Creates a file shared by all processes of MPI_COMM_WORLD */
+hid_t create_shared_file(const char* name)
+{
+	hid_t fapl = H5Pcreate(H5P_FILE_ACCESS);
+	H5Pset_fapl_mpio(fapl, MPI_COMM_WORLD, MPI_INFO_NULL);
+	hid_t file = H5Fcreate(name, H5F_ACC_TRUNC, H5P_DEFAULT, fapl);
+	H5Pclose(fapl);
+	return file;
+}
+
+/* Writes the `n` doubles of each process at its place in a 1D dataset shared
+ * by all processes
+ */
+void write_shared(hid_t file, const char* name, const double* data, int64_t n, H5FD_mpio_xfer_t xfer, hid_t dcpl)
+{
+	hsize_t file_size = n * world_size();
+	hsize_t start = n * world_rank();
+	hsize_t count = n;
+	hid_t file_space = H5Screate_simple(1, &file_size, NULL);
+	hid_t mem_space = H5Screate_simple(1, &count, NULL);
+	hid_t dset = H5Dcreate(file, name, H5T_NATIVE_DOUBLE, file_space, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+	H5Sselect_hyperslab(file_space, H5S_SELECT_SET, &start, NULL, &count, NULL);
+	hid_t dxpl = H5Pcreate(H5P_DATASET_XFER);
+	H5Pset_dxpl_mpio(dxpl, xfer);
+	H5Dwrite(dset, H5T_NATIVE_DOUBLE, mem_space, file_space, dxpl, data);
+	H5Pclose(dxpl);
+	H5Dclose(dset);
+	H5Sclose(mem_space);
+	H5Sclose(file_space);
+}
+
+/* A reporter for the processes other than the first one */
+class Null_reporter: public benchmark::BenchmarkReporter
+{
+public:
+	bool ReportContext(const Context&) override { return true; }
+
+	void ReportRuns(const std::vector<Run>&) override {}
+};
+
+} // namespace
+
+/* Writes the field of each process in a single file shared by all processes,
+ * with collective or independent transfers
+ */
+static void PDI_write_shared(benchmark::State& state)
+{
+	std::string config_yaml = pdi_header()
+		+ "    file: shared_field.h5                                      \n"
+		  "    communicator: $MPI_COMM_WORLD                              \n"
+		  "    collision_policy: replace                                  \n"
+		  "    datasets:                                                  \n"
+		  "      field: { type: array, subtype: double, size: '$size*$n' }\n"
+		  "    write:                                                     \n"
+		  "      field:                                                   \n"
+		  "        dataset_selection: { start: ['$rank*$n'] }             \n"
+		  "        mpio: "
+		+ (state.range(1) ? "COLLECTIVE" : "INDEPENDENT") + "\n";
+
+	int64_t n = state.range(0);
+	std::vector<double> field = make_field(n);
+	pdi_init(config_yaml, n);
+	timed_loop(state, n * sizeof(double), [&]() { PDI_expose("field", field.data(), PDI_OUT); });
+	PDI_finalize();
+}
+
+BENCHMARK(PDI_write_shared)
+	->Name("Decl_hdf5_parallel/PDI_write_shared")
+	->ArgsProduct({{1 << 16, 1 << 20}, {0, 1}})
+	->Unit(benchmark::kMillisecond)
+	->UseManualTime();
+
+static void HDF5_write_shared(benchmark::State& state)
+{
+	int64_t n = state.range(0);
+	std::vector<double> field = make_field(n);
+	H5FD_mpio_xfer_t xfer = state.range(1) ? H5FD_MPIO_COLLECTIVE : H5FD_MPIO_INDEPENDENT;
+	timed_loop(state, n * sizeof(double), [&]() {
+		hid_t file = create_shared_file("shared_field.h5");
+		write_shared(file, "field", field.data(), n, xfer, H5P_DEFAULT);
+		H5Fclose(file);
+	});
+}
+
+BENCHMARK(HDF5_write_shared)
+	->Name("Decl_hdf5_parallel/HDF5_write_shared")
+	->ArgsProduct({{1 << 16, 1 << 20}, {0, 1}})
+	->Unit(benchmark::kMillisecond)
+	->UseManualTime();
+
+/* Writes the field of each process in its own file */
+static void PDI_write_file_per_process(benchmark::State& state)
+{
+	std::string config_yaml = pdi_header()
+		+ "    file: field_${rank}.h5                                     \n"
+		  "    collision_policy: replace                                  \n"
+		  "    write: [field]                                             \n";
+
+	int64_t n = state.range(0);
+	std::vector<double> field = make_field(n);
+	pdi_init(config_yaml, n);
+	timed_loop(state, n * sizeof(double), [&]() { PDI_expose("field", field.data(), PDI_OUT); });
+	PDI_finalize();
+}
+
+BENCHMARK(PDI_write_file_per_process)
+	->Name("Decl_hdf5_parallel/PDI_write_file_per_process")
+	->Arg(1 << 16)
+	->Arg(1 << 20)
+	->Unit(benchmark::kMillisecond)
+	->UseManualTime();
+
+static void HDF5_write_file_per_process(benchmark::State& state)
+{
+	int64_t n = state.range(0);
+	std::vector<double> field = make_field(n);
+	std::string file_name = "field_" + std::to_string(world_rank()) + ".h5";
+	timed_loop(state, n * sizeof(double), [&]() {
+		hid_t file = H5Fcreate(file_name.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+		hsize_t size = n;
+		hid_t space = H5Screate_simple(1, &size, NULL);
+		hid_t dset = H5Dcreate(file, "field", H5T_NATIVE_DOUBLE, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+		H5Dwrite(dset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, field.data());
+		H5Dclose(dset);
+		H5Sclose(space);
+		H5Fclose(file);
+	});
+}
+
+BENCHMARK(HDF5_write_file_per_process)
+	->Name("Decl_hdf5_parallel/HDF5_write_file_per_process")
+	->Arg(1 << 16)
+	->Arg(1 << 20)
+	->Unit(benchmark::kMillisecond)
+	->UseManualTime();
+
+/* Writes the field of each process in a chunked and deflated dataset shared
+ * by all processes, filters requiring collective transfers
+ */
+static void PDI_write_deflate(benchmark::State& state)
+{
+	std::string config_yaml = pdi_header()
+		+ "    file: deflated_field.h5                                    \n"
+		  "    communicator: $MPI_COMM_WORLD                              \n"
+		  "    collision_policy: replace                                  \n"
+		  "    datasets:                                                  \n"
+		  "      field: { type: array, subtype: double, size: '$size*$n' }\n"
+		  "    write:                                                     \n"
+		  "      field:                                                   \n"
+		  "        dataset_selection: { start: ['$rank*$n'] }             \n"
+		  "        deflate: 1                                             \n"
+		  "        chunking: "
+		+ std::to_string(state.range(1)) + "\n";
+
+	int64_t n = state.range(0);
+	std::vector<double> field = make_field(n);
+	pdi_init(config_yaml, n);
+	timed_loop(state, n * sizeof(double), [&]() { PDI_expose("field", field.data(), PDI_OUT); });
+	PDI_finalize();
+}
+
+BENCHMARK(PDI_write_deflate)
+	->Name("Decl_hdf5_parallel/PDI_write_deflate")
+	->ArgsProduct({{1 << 16, 1 << 20}, {1 << 14}})
+	->Unit(benchmark::kMillisecond)
+	->UseManualTime();
+
+static void HDF5_write_deflate(benchmark::State& state)
+{
+	int64_t n = state.range(0);
+	std::vector<double> field = make_field(n);
+	hsize_t chunk = state.range(1);
+	timed_loop(state, n * sizeof(double), [&]() {
+		hid_t file = create_shared_file("deflated_field.h5");
+		hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+		H5Pset_chunk(dcpl, 1, &chunk);
+		H5Pset_deflate(dcpl, 1);
+		write_shared(file, "field", field.data(), n, H5FD_MPIO_COLLECTIVE, dcpl);
+		H5Pclose(dcpl);
+		H5Fclose(file);
+	});
+}
+
+BENCHMARK(HDF5_write_deflate)
+	->Name("Decl_hdf5_parallel/HDF5_write_deflate")
+	->ArgsProduct({{1 << 16, 1 << 20}, {1 << 14}})
+	->Unit(benchmark::kMillisecond)
+	->UseManualTime();
+
+/* Writes a small dataset with a given number of attributes in a file per
+ * process
+ */
+static void PDI_write_attributes(benchmark::State& state)
+{
+	std::string attributes;
+	for (int64_t attr = 0; attr < state.range(0); attr++) {
+		attributes += "          attr_" + std::to_string(attr) + ": '$rank+" + std::to_string(attr) + "'\n";
+	}
+	std::string config_yaml = pdi_header()
+		+ "    file: attributes_${rank}.h5                                \n"
+		  "    collision_policy: replace                                  \n"
+		  "    write:                                                     \n"
+		  "      field:                                                   \n"
+		  "        attributes:                                            \n"
+		+ attributes;
+
+	int64_t n = 1024;
+	std::vector<double> field = make_field(n);
+	pdi_init(config_yaml, n);
+	timed_loop(state, n * sizeof(double), [&]() { PDI_expose("field", field.data(), PDI_OUT); });
+	PDI_finalize();
+	state.SetItemsProcessed(state.iterations() * state.range(0) * world_size());
+}
+
+BENCHMARK(PDI_write_attributes)
+	->Name("Decl_hdf5_parallel/PDI_write_attributes")
+	->Arg(16)
+	->Arg(256)
+	->Unit(benchmark::kMillisecond)
+	->UseManualTime();
+
+static void HDF5_write_attributes(benchmark::State& state)
+{
+	int64_t n = 1024;
+	std::vector<double> field = make_field(n);
+	std::string file_name = "attributes_" + std::to_string(world_rank()) + ".h5";
+	timed_loop(state, n * sizeof(double), [&]() {
+		hid_t file = H5Fcreate(file_name.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+		hsize_t size = n;
+		hid_t space = H5Screate_simple(1, &size, NULL);
+		hid_t dset = H5Dcreate(file, "field", H5T_NATIVE_DOUBLE, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+		H5Dwrite(dset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, field.data());
+		hid_t attr_space = H5Screate(H5S_SCALAR);
+		for (int64_t attr = 0; attr < state.range(0); attr++) {
+			long value = world_rank() + attr;
+			std::string attr_name = "attr_" + std::to_string(attr);
+			hid_t h5_attr = H5Acreate(dset, attr_name.c_str(), H5T_NATIVE_LONG, attr_space, H5P_DEFAULT, H5P_DEFAULT);
+			H5Awrite(h5_attr, H5T_NATIVE_LONG, &value);
+			H5Aclose(h5_attr);
+		}
+		H5Sclose(attr_space);
+		H5Dclose(dset);
+		H5Sclose(space);
+		H5Fclose(file);
+	});
+	state.SetItemsProcessed(state.iterations() * state.range(0) * world_size());
+}
+
+BENCHMARK(HDF5_write_attributes)
+	->Name("Decl_hdf5_parallel/HDF5_write_attributes")
+	->Arg(16)
+	->Arg(256)
+	->Unit(benchmark::kMillisecond)
+	->UseManualTime();
+
+/* Writes the field of each process in a shared file on its exposure or on an
+ * event, the raw HDF5 reference being `HDF5_write_shared` with collective
+ * transfers
+ */
+static void PDI_write_trigger(benchmark::State& state)
+{
+	bool on_event = state.range(1);
+	std::string config_yaml = pdi_header()
+		+ "    file: shared_field.h5                                      \n"
+		  "    communicator: $MPI_COMM_WORLD                              \n"
+		  "    collision_policy: replace                                  \n"
+		+ (on_event ? "    on_event: write_field                              \n" : "")
+		+ "    datasets:                                                  \n"
+		  "      field: { type: array, subtype: double, size: '$size*$n' }\n"
+		  "    write:                                                     \n"
+		  "      field:                                                   \n"
+		  "        dataset_selection: { start: ['$rank*$n'] }             \n";
+
+	int64_t n = state.range(0);
+	std::vector<double> field = make_field(n);
+	pdi_init(config_yaml, n);
+	if (on_event) {
+		timed_loop(state, n * sizeof(double), [&]() { PDI_multi_expose("write_field", "field", field.data(), PDI_OUT, NULL); });
+	} else {
+		timed_loop(state, n * sizeof(double), [&]() { PDI_expose("field", field.data(), PDI_OUT); });
+	}
+	PDI_finalize();
+}
+
+BENCHMARK(PDI_write_trigger)
+	->Name("Decl_hdf5_parallel/PDI_write_trigger")
+	->ArgsProduct({{1 << 16, 1 << 20}, {0, 1}})
+	->Unit(benchmark::kMillisecond)
+	->UseManualTime();
+
+/* Writes the same amount of data per process split in a given number of
+ * datasets of a shared file
+ */
+static void PDI_write_datasets(benchmark::State& state)
+{
+	int64_t count = state.range(1);
+	std::string datasets;
+	for (int64_t dset = 0; dset < count; dset++) {
+		datasets += "      block_" + std::to_string(dset) + ": { type: array, subtype: double, size: '$size*$n' }\n";
+	}
+	std::string config_yaml = pdi_header()
+		+ "    file: datasets.h5                                          \n"
+		  "    communicator: $MPI_COMM_WORLD                              \n"
+		  "    collision_policy: write_into                               \n"
+		  "    datasets:                                                  \n"
+		+ datasets
+		+ "    write:                                                     \n"
+		  "      field:                                                   \n"
+		  "        dataset: 'block_${index}'                              \n"
+		  "        dataset_selection: { start: ['$rank*$n'] }             \n";
+
+	int64_t n = state.range(0) / count;
+	std::vector<double> field = make_field(n);
+	if (world_rank() == 0) remove("datasets.h5");
+	MPI_Barrier(MPI_COMM_WORLD);
+	pdi_init(config_yaml, n);
+	timed_loop(state, count * n * sizeof(double), [&]() {
+		for (int index = 0; index < count; index++) {
+			PDI_multi_expose("write_block", "index", &index, PDI_OUT, "field", field.data(), PDI_OUT, NULL);
+		}
+	});
+	PDI_finalize();
+}
+
+BENCHMARK(PDI_write_datasets)
+	->Name("Decl_hdf5_parallel/PDI_write_datasets")
+	->ArgsProduct({{1 << 20}, {1, 16, 256}})
+	->Unit(benchmark::kMillisecond)
+	->UseManualTime();
+
+static void HDF5_write_datasets(benchmark::State& state)
+{
+	int64_t count = state.range(1);
+	int64_t n = state.range(0) / count;
+	std::vector<double> field = make_field(n);
+	timed_loop(state, count * n * sizeof(double), [&]() {
+		hid_t file = create_shared_file("datasets.h5");
+		for (int64_t index = 0; index < count; index++) {
+			std::string name = "block_" + std::to_string(index);
+			write_shared(file, name.c_str(), field.data(), n, H5FD_MPIO_COLLECTIVE, H5P_DEFAULT);
+		}
+		H5Fclose(file);
+	});
+}
+
+BENCHMARK(HDF5_write_datasets)
+	->Name("Decl_hdf5_parallel/HDF5_write_datasets")
+	->ArgsProduct({{1 << 20}, {1, 16, 256}})
+	->Unit(benchmark::kMillisecond)
+	->UseManualTime();
+
+int main(int argc, char* argv[])
+{
+	MPI_Init(&argc, &argv);
+	if (world_rank() != 0) {
+		// only the first process writes the result file
+		int kept = 1;
+		for (int arg = 1; arg < argc; arg++) {
+			if (strncmp(argv[arg], "--benchmark_out", strlen("--benchmark_out"))) {
+				argv[kept++] = argv[arg];
+			}
+		}
+		argc = kept;
+	}
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+		MPI_Finalize();
+		return 1;
+	}
+	if (world_rank() == 0) {
+		benchmark::RunSpecifiedBenchmarks();
+	} else {
+		Null_reporter null_reporter;
+		benchmark::RunSpecifiedBenchmarks(&null_reporter);
+	}
+	benchmark::Shutdown();
+	MPI_Finalize();
+	return 0;
+}
@@ -259,3 +259,100 @@ static void HDF5_read(benchmark::State& state)
 }
 
 BENCHMARK(HDF5_read)->Name("Decl_hdf5_struct/HDF5_read");
+
+/// A record with padding between and after its members
+struct Padded_record {
+	char c;
+	double d;
+	int i;
+};
+
+/* Writes an array of padded records, stored as is or packed (without padding)
+ * in the dataset
+ */
+static void PDI_write_packed(benchmark::State& state)
+{
+	std::string config_yaml
+		= "logging: off                                                  \n"
+		  "metadata:                                                     \n"
+		  "  nb_records: int64                                           \n"
+		  "data:                                                         \n"
+		  "  records:                                                    \n"
+		  "    type: array                                               \n"
+		  "    size: $nb_records                                         \n"
+		  "    subtype:                                                  \n"
+		  "      type: struct                                            \n"
+		  "      members: [ {c: char}, {d: double}, {i: int} ]           \n"
+		  "plugins:                                                      \n"
+		  "  decl_hdf5:                                                  \n"
+		  "    file: packed_record_data.h5                               \n"
+		  "    collision_policy: replace                                 \n"
+		  "    write:                                                    \n"
+		  "      records: { pack: "
+		+ std::to_string(state.range(1)) + " }\n";
+
+	int64_t nb_records = state.range(0);
+	std::unique_ptr<Padded_record[]> records{new Padded_record[nb_records]};
+	for (int64_t i = 0; i < nb_records; i++) {
+		records[i] = Padded_record{static_cast<char>(i), i * 1.23, static_cast<int>(i)};
+	}
+	PDI_init(PC_parse_string(config_yaml.c_str()));
+	PDI_expose("nb_records", &nb_records, PDI_OUT);
+	for (auto _: state) {
+		PDI_expose("records", records.get(), PDI_OUT);
+	}
+	PDI_finalize();
+	state.SetItemsProcessed(state.iterations() * nb_records);
+}
+
+BENCHMARK(PDI_write_packed)
+	->Name("Decl_hdf5_struct/PDI_write_packed")
+	->ArgsProduct({{1 << 20}, {0, 1}})
+	->Unit(benchmark::kMillisecond);
+
+/* Writes an array of padded records to a packed dataset, converted by HDF5
+ */
+static void HDF5_write_packed(benchmark::State& state)
+{
+	hsize_t nb_records = state.range(0);
+	std::unique_ptr<Padded_record[]> records{new Padded_record[nb_records]};
+	for (hsize_t i = 0; i < nb_records; i++) {
+		records[i] = Padded_record{static_cast<char>(i), i * 1.23, static_cast<int>(i)};
+	}
+
+	for (auto _: state) {
+		hid_t file_id = H5Fcreate("packed_record_data.h5", H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+		if (file_id < 0) exit(1);
+		hid_t dataspace_id = H5Screate_simple(1, &nb_records, NULL);
+		if (dataspace_id < 0) exit(1);
+		hid_t record_id = H5Tcreate(H5T_COMPOUND, sizeof(Padded_record));
+		if (record_id < 0) exit(1);
+		herr_t status = H5Tinsert(record_id, "c", HOFFSET(Padded_record, c), H5T_NATIVE_CHAR);
+		if (status < 0) exit(1);
+		status = H5Tinsert(record_id, "d", HOFFSET(Padded_record, d), H5T_NATIVE_DOUBLE);
+		if (status < 0) exit(1);
+		status = H5Tinsert(record_id, "i", HOFFSET(Padded_record, i), H5T_NATIVE_INT);
+		if (status < 0) exit(1);
+		hid_t packed_id = H5Tcopy(record_id);
+		if (packed_id < 0) exit(1);
+		status = H5Tpack(packed_id);
+		if (status < 0) exit(1);
+		hid_t dataset_id = H5Dcreate(file_id, "records", packed_id, dataspace_id, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+		if (dataset_id < 0) exit(1);
+		status = H5Dwrite(dataset_id, record_id, H5S_ALL, H5S_ALL, H5P_DEFAULT, records.get());
+		if (status < 0) exit(1);
+		status = H5Tclose(packed_id);
+		if (status < 0) exit(1);
+		status = H5Tclose(record_id);
+		if (status < 0) exit(1);
+		status = H5Sclose(dataspace_id);
+		if (status < 0) exit(1);
+		status = H5Dclose(dataset_id);
+		if (status < 0) exit(1);
+		status = H5Fclose(file_id);
+		if (status < 0) exit(1);
+	}
+	state.SetItemsProcessed(state.iterations() * nb_records);
+}
+
+BENCHMARK(HDF5_write_packed)->Name("Decl_hdf5_struct/HDF5_write_packed")->Arg(1 << 20)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,306 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include <hdf5.h>
+#ifdef H5_HAVE_PARALLEL
+#include <mpi.h>
+#endif
+
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <utility>
+
+#include <pdi/context.h>
+#include <pdi/error.h>
+#include <pdi/paraconf_wrapper.h>
+
+#include "checkpoint.h"
+
+namespace fs = std::filesystem;
+
+using PDI::Config_error;
+using PDI::Context;
+using PDI::each;
+using PDI::System_error;
+using PDI::to_string;
+using std::deque;
+using std::exception;
+using std::find;
+using std::ifstream;
+using std::lock_guard;
+using std::mutex;
+using std::ofstream;
+using std::string;
+using std::unique_lock;
+
+namespace {
+
+/** Removes a file from a list of files if it is listed
+ *
+ * \param files the list of files
+ * \param filename the file to remove
+ */
+void unlist(deque<string>& files, const string& filename)
+{
+	auto&& listed = find(files.begin(), files.end(), filename);
+	if (listed != files.end()) files.erase(listed);
+}
+
+/** Checks whether a file is listed in a list of files
+ *
+ * \param files the list of files
+ * \param filename the file to look for
+ * \return whether the file is listed
+ */
+bool listed(const deque<string>& files, const string& filename)
+{
+	return find(files.begin(), files.end(), filename) != files.end();
+}
+
+/** Gives the default name of the manifest, one per process when MPI is in use
+ *
+ * \return the default name of the manifest
+ */
+string default_manifest()
+{
+#ifdef H5_HAVE_PARALLEL
+	int initialized = 0;
+	int finalized = 0;
+	MPI_Initialized(&initialized);
+	MPI_Finalized(&finalized);
+	if (initialized && !finalized) {
+		int rank = 0;
+		MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+		return "checkpoint." + std::to_string(rank) + ".manifest";
+	}
+#endif
+	return "checkpoint.manifest";
+}
+
+} // namespace
+
+namespace decl_hdf5 {
+
+Checkpoint::Checkpoint(PC_tree_t tree)
+{
+	each(tree, [&](PC_tree_t key_tree, PC_tree_t value) {
+		string key = to_string(key_tree);
+		if (key == "local_path") {
+			m_local_path = to_string(value);
+		} else if (key == "global_path") {
+			m_global_path = to_string(value);
+		} else if (key == "drain_every") {
+			m_drain_every = to_string(value);
+		} else if (key == "local_retention") {
+			m_local_retention = to_string(value);
+		} else if (key == "global_retention") {
+			m_global_retention = to_string(value);
+		} else if (key == "manifest") {
+			m_manifest = to_string(value);
+		} else {
+			throw Config_error{key_tree, "Unknown key in HDF5 checkpoint configuration: `{}'", key};
+		}
+	});
+	if (!m_local_path) {
+		throw Config_error{tree, "Missing `local_path' in HDF5 checkpoint configuration"};
+	}
+	if (!m_global_path) {
+		throw Config_error{tree, "Missing `global_path' in HDF5 checkpoint configuration"};
+	}
+	m_thread = std::thread{[this]() { run(); }};
+}
+
+Checkpoint::~Checkpoint()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_drain_cv.notify_all();
+	m_thread.join();
+}
+
+void Checkpoint::run()
+{
+	unique_lock<mutex> lock(m_mutex);
+	for (;;) {
+		m_drain_cv.wait(lock, [&]() { return m_stop || !m_drains.empty(); });
+		// pending drains are done before stopping
+		if (m_drains.empty()) return;
+		Drain drain = m_drains.front();
+		lock.unlock();
+
+		// the copy is only visible in the global tier once complete
+		string error;
+		try {
+			string partial_file = drain.m_global_file + ".part";
+			fs::copy_file(drain.m_local_file, partial_file, fs::copy_options::overwrite_existing);
+			fs::rename(partial_file, drain.m_global_file);
+		} catch (const exception& e) {
+			error = e.what();
+		}
+
+		lock.lock();
+		m_drains.pop_front();
+		m_drained_cv.notify_all();
+		if (error.empty()) {
+			unlist(m_global_files, drain.m_filename);
+			m_global_files.emplace_back(drain.m_filename);
+		} else {
+			m_drain_error = "Cannot drain `" + drain.m_filename + "' checkpoint: " + error;
+		}
+		try {
+			retain();
+			save();
+		} catch (const exception& e) {
+			m_drain_error = e.what();
+		}
+	}
+}
+
+void Checkpoint::load(Context& ctx)
+{
+	string local_dir = m_local_path.to_string(ctx);
+	string global_dir = m_global_path.to_string(ctx);
+	string manifest_path = (fs::path{global_dir} / (m_manifest ? m_manifest.to_string(ctx) : default_manifest())).string();
+	if (manifest_path == m_manifest_path && local_dir == m_local_dir && global_dir == m_global_dir) return;
+
+	m_manifest_path = manifest_path;
+	m_local_dir = local_dir;
+	m_global_dir = global_dir;
+	m_local_files.clear();
+	m_global_files.clear();
+	ifstream manifest(m_manifest_path);
+	if (!manifest) return;
+	ctx.logger().debug("Loading `{}' checkpoint manifest", m_manifest_path);
+	string tier;
+	string filename;
+	while (manifest >> tier >> filename) {
+		if (tier == "local") {
+			m_local_files.emplace_back(filename);
+		} else if (tier == "global") {
+			m_global_files.emplace_back(filename);
+		}
+	}
+}
+
+void Checkpoint::save()
+{
+	string partial_path = m_manifest_path + ".part";
+	{
+		fs::create_directories(fs::path{m_manifest_path}.parent_path());
+		ofstream manifest(partial_path, ofstream::trunc);
+		for (auto&& filename: m_local_files) {
+			manifest << "local " << filename << "\n";
+		}
+		for (auto&& filename: m_global_files) {
+			manifest << "global " << filename << "\n";
+		}
+		if (!manifest.flush()) {
+			throw System_error{"Cannot write `{}' checkpoint manifest", partial_path};
+		}
+	}
+	fs::rename(partial_path, m_manifest_path);
+}
+
+void Checkpoint::retain()
+{
+	while (0 < m_nb_local && m_local_files.size() > static_cast<size_t>(m_nb_local)) {
+		const string& oldest = m_local_files.front();
+		// files waiting to be drained are removed after the drain
+		auto&& drain = std::find_if(m_drains.begin(), m_drains.end(), [&](const Drain& drain) { return drain.m_filename == oldest; });
+		if (drain != m_drains.end()) break;
+		std::error_code ignored;
+		fs::remove(fs::path{m_local_dir} / oldest, ignored);
+		m_local_files.pop_front();
+	}
+	while (0 < m_nb_global && m_global_files.size() > static_cast<size_t>(m_nb_global)) {
+		std::error_code ignored;
+		fs::remove(fs::path{m_global_dir} / m_global_files.front(), ignored);
+		m_global_files.pop_front();
+	}
+}
+
+string Checkpoint::write_path(Context& ctx, const string& filename)
+{
+	unique_lock<mutex> lock(m_mutex);
+	// the local copy must not be overwritten while it is being drained
+	m_drained_cv.wait(lock, [&]() {
+		return std::none_of(m_drains.begin(), m_drains.end(), [&](const Drain& drain) { return drain.m_filename == filename; });
+	});
+	load(ctx);
+	fs::path local_file = fs::path{m_local_dir} / filename;
+	fs::create_directories(local_file.parent_path());
+	// the local copy is not valid until written again
+	unlist(m_local_files, filename);
+	return local_file.string();
+}
+
+string Checkpoint::read_path(Context& ctx, const string& filename)
+{
+	lock_guard<mutex> lock(m_mutex);
+	load(ctx);
+	fs::path local_file = fs::path{m_local_dir} / filename;
+	fs::path global_file = fs::path{m_global_dir} / filename;
+	if (listed(m_local_files, filename) && fs::exists(local_file)) {
+		ctx.logger().debug("Reading `{}' checkpoint from the local tier", filename);
+		return local_file.string();
+	}
+	if (listed(m_global_files, filename)) {
+		ctx.logger().debug("Reading `{}' checkpoint from the global tier", filename);
+		return global_file.string();
+	}
+	// not in the manifest, the local copy is used if any
+	if (fs::exists(local_file)) return local_file.string();
+	return global_file.string();
+}
+
+void Checkpoint::written(Context& ctx, const string& filename)
+{
+	lock_guard<mutex> lock(m_mutex);
+	if (!m_drain_error.empty()) {
+		ctx.logger().warn("{}", m_drain_error);
+		m_drain_error.clear();
+	}
+	load(ctx);
+	m_nb_local = m_local_retention.to_long(ctx);
+	m_nb_global = m_global_retention.to_long(ctx);
+	m_local_files.emplace_back(filename);
+
+	long drain_every = m_drain_every.to_long(ctx);
+	if (0 < drain_every && 0 == ++m_nb_written % drain_every) {
+		fs::path global_file = fs::path{m_global_dir} / filename;
+		fs::create_directories(global_file.parent_path());
+		ctx.logger().debug("Draining `{}' checkpoint to the global tier", filename);
+		m_drains.push_back({filename, (fs::path{m_local_dir} / filename).string(), global_file.string()});
+		m_drain_cv.notify_all();
+	}
+	retain();
+	save();
+}
+
+} // namespace decl_hdf5
@@ -0,0 +1,188 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef DECL_HDF5_CHECKPOINT_H_
+#define DECL_HDF5_CHECKPOINT_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <paraconf.h>
+
+#include <pdi/pdi_fwd.h>
+#include <pdi/expression.h>
+
+namespace decl_hdf5 {
+
+/** A Checkpoint writes files to a fast local tier and drains some of them to
+ * a global tier in a background thread.
+ *
+ * The files of both tiers are listed in a manifest stored in the global tier,
+ * a file is only listed once it is complete in a tier.
+ * All member functions must be called from the thread that uses the plugin,
+ * except the destructor that waits for the pending drains.
+ */
+class Checkpoint
+{
+	/// A file to copy from the local tier to the global tier
+	struct Drain {
+		/// the name of the file
+		std::string m_filename;
+
+		/// the path of the file in the local tier
+		std::string m_local_file;
+
+		/// the path of the file in the global tier
+		std::string m_global_file;
+	};
+
+	/// the directory of the local tier
+	PDI::Expression m_local_path;
+
+	/// the directory of the global tier
+	PDI::Expression m_global_path;
+
+	/// the number of files written between two drains to the global tier
+	PDI::Expression m_drain_every = 1L;
+
+	/// the number of files kept in the local tier (all if 0)
+	PDI::Expression m_local_retention = 0L;
+
+	/// the number of files kept in the global tier (all if 0)
+	PDI::Expression m_global_retention = 0L;
+
+	/// the name of the manifest in the global tier, one per MPI process by default
+	PDI::Expression m_manifest;
+
+	/// protects all the following members
+	std::mutex m_mutex;
+
+	/// notified when a drain is queued or when the thread must stop
+	std::condition_variable m_drain_cv;
+
+	/// notified when a drain is done
+	std::condition_variable m_drained_cv;
+
+	/// the path of the manifest loaded, empty if none
+	std::string m_manifest_path;
+
+	/// the directory of the local tier when the manifest was loaded
+	std::string m_local_dir;
+
+	/// the directory of the global tier when the manifest was loaded
+	std::string m_global_dir;
+
+	/// the files in the local tier, oldest first
+	std::deque<std::string> m_local_files;
+
+	/// the files in the global tier, oldest first
+	std::deque<std::string> m_global_files;
+
+	/// the drains to do, the first one is in progress
+	std::deque<Drain> m_drains;
+
+	/// the error of the last failed drain, empty if none
+	std::string m_drain_error;
+
+	/// the number of files kept in the local tier, evaluated on the last write
+	long m_nb_local = 0;
+
+	/// the number of files kept in the global tier, evaluated on the last write
+	long m_nb_global = 0;
+
+	/// the number of files written
+	long m_nb_written = 0;
+
+	/// whether the thread must stop
+	bool m_stop = false;
+
+	/// the background thread
+	std::thread m_thread;
+
+	/** The background thread main loop
+	 */
+	void run();
+
+	/** Loads the manifest of the global tier if not done yet, with m_mutex held
+	 *
+	 * \param ctx the context in which to operate
+	 */
+	void load(PDI::Context& ctx);
+
+	/** Writes the manifest, with m_mutex held
+	 */
+	void save();
+
+	/** Removes the oldest files of both tiers over their retention count,
+	 * with m_mutex held
+	 */
+	void retain();
+
+public:
+	/** Creates the Checkpoint and starts its background thread
+	 *
+	 * \param tree the CHECKPOINT_DESC configuration
+	 */
+	Checkpoint(PC_tree_t tree);
+
+	Checkpoint(const Checkpoint&) = delete;
+
+	Checkpoint& operator= (const Checkpoint&) = delete;
+
+	/** Waits for the pending drains and stops the background thread
+	 */
+	~Checkpoint();
+
+	/** Gives the path where to write a file, in the local tier, once any
+	 * pending drain of this file is done
+	 *
+	 * \param ctx the context in which to operate
+	 * \param filename the name of the file
+	 * \return the path of the file in the local tier
+	 */
+	std::string write_path(PDI::Context& ctx, const std::string& filename);
+
+	/** Gives the path where to read a file, the local copy if it is valid, the
+	 * global one otherwise
+	 *
+	 * \param ctx the context in which to operate
+	 * \param filename the name of the file
+	 * \return the path of the freshest valid copy of the file
+	 */
+	std::string read_path(PDI::Context& ctx, const std::string& filename);
+
+	/** Lists a file written and closed in the local tier and drains it if due
+	 *
+	 * \param ctx the context in which to operate
+	 * \param filename the name of the file
+	 */
+	void written(PDI::Context& ctx, const std::string& filename);
+};
+
+} // namespace decl_hdf5
+
+#endif // DECL_HDF5_CHECKPOINT_H_
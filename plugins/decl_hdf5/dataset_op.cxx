@@ -46,8 +46,15 @@
 #include <pdi/scalar_datatype.h>
 #include <pdi/tuple_datatype.h>
 
+#include "direct_chunk_write.h"
 #include "hdf5_wrapper.h"
+#include "incremental_write.h"
+#include "precision.h"
+#include "prefetcher.h"
+#include "record_packer.h"
+#include "replication.h"
 #include "selection.h"
+#include "virtual_dataset.h"
 
 #include "dataset_op.h"
 
@@ -58,6 +65,7 @@ using PDI::Datatype;
 using PDI::Datatype_sptr;
 using PDI::Datatype_template_sptr;
 using PDI::each;
+using PDI::Error;
 using PDI::Expression;
 using PDI::Ref_r;
 using PDI::Ref_w;
@@ -67,8 +75,12 @@ using PDI::to_string;
 using PDI::Tuple_datatype;
 using PDI::Type_error;
 using PDI::Value_error;
+using std::copy;
 using std::dynamic_pointer_cast;
+using std::equal;
+using std::fill;
 using std::function;
+using std::make_shared;
 using std::string;
 using std::stringstream;
 using std::tie;
@@ -95,15 +107,12 @@ tuple<vector<hsize_t>, vector<hsize_t>, vector<hsize_t>> get_selection(hid_t sel
 }
 
 /** Validates that memory space and dataset space number of elements match
+ *
+ * The numbers of points are those returned by the application of the
+ * selections, the dataspaces are only inquired to report an error.
  */
-void validate_dataspaces(PC_tree_t selectree, hid_t h5_mem_space, hid_t h5_file_space, const std::string dataset_name)
+void validate_dataspaces(PC_tree_t selectree, hid_t h5_mem_space, hid_t h5_file_space, hsize_t n_data_pts, hsize_t n_file_pts, const std::string dataset_name)
 {
-	hssize_t n_data_pts = H5Sget_select_npoints(h5_mem_space);
-	if (0 > n_data_pts) handle_hdf5_err();
-
-	hssize_t n_file_pts = H5Sget_select_npoints(h5_file_space);
-	if (0 > n_file_pts) handle_hdf5_err();
-
 	if (n_data_pts != n_file_pts) {
 		vector<hsize_t> pr_size;
 		vector<hsize_t> pr_subsize;
@@ -124,6 +133,140 @@ void validate_dataspaces(PC_tree_t selectree, hid_t h5_mem_space, hid_t h5_file_
 	}
 }
 
+/** Computes chunk sizes for a dataset from its shape, element size and selection.
+ *
+ * Chunks start from the selected block (the per-process part of the dataset),
+ * or the whole dataset if nothing is selected, unlimited dimensions get a
+ * chunk size of 1 and the largest dimension is then halved until the chunk
+ * fits in the target size.
+ *
+ * \param h5_file_space the dataset dataspace with the dataset selection applied
+ * \param h5_file_type the dataset HDF5 type
+ * \param target_size the maximum size of a chunk in bytes
+ * \return the chunk size in each dimension or an empty vector if the dataset can not be chunked
+ */
+vector<hsize_t> auto_chunking(hid_t h5_file_space, hid_t h5_file_type, hsize_t target_size)
+{
+	int rank = H5Sget_simple_extent_ndims(h5_file_space);
+	if (0 > rank) handle_hdf5_err();
+	if (0 == rank) return {};
+
+	vector<hsize_t> dims(rank);
+	vector<hsize_t> maxdims(rank);
+	if (0 > H5Sget_simple_extent_dims(h5_file_space, &dims[0], &maxdims[0])) handle_hdf5_err();
+
+	vector<hsize_t> chunk = dims;
+	hssize_t npoints = H5Sget_select_npoints(h5_file_space);
+	if (0 > npoints) handle_hdf5_err();
+	if (npoints > 0) {
+		vector<hsize_t> start(rank);
+		if (0 > H5Sget_select_bounds(h5_file_space, &start[0], &chunk[0])) handle_hdf5_err();
+		transform(start.begin(), start.end(), chunk.begin(), chunk.begin(), [](hsize_t start, hsize_t end) { return end - start + 1; });
+	}
+
+	for (int dim = 0; dim < rank; ++dim) {
+		if (maxdims[dim] == H5S_UNLIMITED) {
+			chunk[dim] = 1;
+		} else if (dims[dim] == 0) {
+			// a chunk can not be larger than a fixed size dimension
+			return {};
+		}
+	}
+
+	size_t element_size = H5Tget_size(h5_file_type);
+	if (0 == element_size) handle_hdf5_err();
+	auto chunk_bytes = [&]() {
+		hsize_t result = element_size;
+		for (auto&& size: chunk) {
+			result *= size;
+		}
+		return result;
+	};
+	while (chunk_bytes() > target_size) {
+		// max_element returns the first largest, i.e. the outermost one on ties
+		auto&& largest = std::max_element(chunk.begin(), chunk.end());
+		if (*largest <= 1) break;
+		*largest = (*largest + 1) / 2;
+	}
+	return chunk;
+}
+
+/** Builds the dataspace of an appendable dataset from the dataspace of one record.
+ *
+ * The dataset has one more leading, unlimited, record dimension and the
+ * record selection is applied to the record at the given index.
+ *
+ * \param h5_record_space the dataspace of one record with the dataset selection applied
+ * \param nb_records the number of records in the dataset
+ * \param index the index of the record to select
+ * \return the dataset dataspace
+ */
+Raii_hid append_space(hid_t h5_record_space, hsize_t nb_records, hsize_t index)
+{
+	int rank = H5Sget_simple_extent_ndims(h5_record_space);
+	if (0 > rank) handle_hdf5_err();
+
+	vector<hsize_t> dims(rank + 1, nb_records);
+	vector<hsize_t> maxdims(rank + 1, H5S_UNLIMITED);
+	vector<hsize_t> start(rank + 1, index);
+	vector<hsize_t> stride(rank + 1, 1);
+	vector<hsize_t> count(rank + 1, 1);
+	vector<hsize_t> block(rank + 1, 1);
+	if (rank > 0) {
+		if (0 > H5Sget_simple_extent_dims(h5_record_space, &dims[1], &maxdims[1])) handle_hdf5_err();
+		if (H5Sget_select_type(h5_record_space) == H5S_SEL_ALL) {
+			copy(dims.begin() + 1, dims.end(), count.begin() + 1);
+			fill(start.begin() + 1, start.end(), 0);
+		} else {
+			htri_t regular = H5Sis_regular_hyperslab(h5_record_space);
+			if (0 > regular) handle_hdf5_err();
+			if (!regular) throw Value_error{"Only regular hyperslab selections are supported in appendable datasets"};
+			if (0 > H5Sget_regular_hyperslab(h5_record_space, &start[1], &stride[1], &count[1], &block[1])) handle_hdf5_err();
+		}
+	}
+
+	Raii_hid result = make_raii_hid(H5Screate_simple(rank + 1, &dims[0], &maxdims[0]), H5Sclose);
+	hssize_t npoints = H5Sget_select_npoints(h5_record_space);
+	if (0 > npoints) handle_hdf5_err();
+	if (npoints == 0) {
+		if (0 > H5Sselect_none(result)) handle_hdf5_err();
+	} else {
+		if (0 > H5Sselect_hyperslab(result, H5S_SELECT_SET, &start[0], &stride[0], &count[0], &block[0])) handle_hdf5_err();
+	}
+	return result;
+}
+
+/** Adds a record at the end of an existing appendable dataset.
+ *
+ * \param h5_set the dataset to extend
+ * \param h5_record_space the dataspace of one record with the dataset selection applied
+ * \param dataset_name the name of the dataset
+ * \return the dataset dataspace with the added record selected
+ */
+Raii_hid append_record(hid_t h5_set, hid_t h5_record_space, const string& dataset_name)
+{
+	Raii_hid h5_set_space = make_raii_hid(H5Dget_space(h5_set), H5Sclose);
+	int rank = H5Sget_simple_extent_ndims(h5_set_space);
+	if (0 > rank) handle_hdf5_err();
+	int record_rank = H5Sget_simple_extent_ndims(h5_record_space);
+	if (0 > record_rank) handle_hdf5_err();
+	if (rank != record_rank + 1) {
+		throw Value_error{"Cannot append to `{}' dataset: {} dimensions expected, found {}", dataset_name, record_rank + 1, rank};
+	}
+
+	vector<hsize_t> dims(rank);
+	if (0 > H5Sget_simple_extent_dims(h5_set_space, &dims[0], NULL)) handle_hdf5_err();
+	vector<hsize_t> record_dims(record_rank);
+	if (record_rank > 0 && 0 > H5Sget_simple_extent_dims(h5_record_space, &record_dims[0], NULL)) handle_hdf5_err();
+	if (!equal(record_dims.begin(), record_dims.end(), dims.begin() + 1)) {
+		throw Value_error{"Cannot append to `{}' dataset: record of incompatible shape", dataset_name};
+	}
+
+	hsize_t index = dims[0]++;
+	if (0 > H5Dset_extent(h5_set, &dims[0])) handle_hdf5_err(fmt::format("Cannot extend `{}' dataset", dataset_name).c_str());
+	return append_space(h5_record_space, dims[0], index);
+}
+
 } // namespace
 
 namespace decl_hdf5 {
@@ -134,7 +277,11 @@ Dataset_op::Dataset_op(Direction dir, std::string name, PDI::Expression default_
 	, m_dataset{name}
 	, m_value{name}
 	, m_when{default_when}
-{}
+{
+	if (dir == WRITE) {
+		m_packer = make_shared<Record_packer>();
+	}
+}
 
 Dataset_op::Dataset_op(Direction dir, string name, Expression default_when, PC_tree_t tree, Collision_policy file_collision_policy)
 	: Dataset_op{dir, name, default_when, file_collision_policy}
@@ -157,11 +304,76 @@ Dataset_op::Dataset_op(Direction dir, string name, Expression default_when, PC_t
 			} else if (key == "dataset_selection") {
 				m_dataset_selection = value;
 			} else if (key == "chunking") {
-				m_chunking = value;
+				if (PDI::is_scalar(value) && to_string(value) == "auto") {
+					m_chunking_auto = true;
+				} else {
+					m_chunking = value;
+				}
+			} else if (key == "chunking_target_size") {
+				m_chunking_target_size = value;
 			} else if (key == "deflate") {
 				m_deflate = value;
 			} else if (key == "fletcher") {
 				m_fletcher = value;
+			} else if (key == "shuffle") {
+				m_shuffle = value;
+			} else if (key == "precision") {
+				if (dir == READ) {
+					throw Config_error{key_tree, "`precision' is only valid for write operations"};
+				}
+				m_precision = Precision{value};
+			} else if (key == "compression_threads") {
+				m_compression_threads = value;
+			} else if (key == "dataset_creation_properties") {
+				m_dataset_creation_properties = Properties{Properties::DATASET_CREATION, value};
+			} else if (key == "append") {
+				if (dir == READ) {
+					throw Config_error{key_tree, "`append' is only valid for write operations"};
+				}
+				m_append = value;
+			} else if (key == "incremental") {
+				if (dir == READ) {
+					throw Config_error{key_tree, "`incremental' is only valid for write operations"};
+				}
+				m_incremental = to_string(value);
+			} else if (key == "prefetch") {
+				if (dir == WRITE) {
+					throw Config_error{key_tree, "`prefetch' is only valid for read operations"};
+				}
+				m_prefetch = to_string(value);
+				// background reads race with the other users of HDF5 unless it is built thread-safe
+				hbool_t threadsafe = false;
+				if (0 <= H5is_library_threadsafe(&threadsafe) && threadsafe) {
+					m_prefetcher = make_shared<Prefetcher>();
+				}
+			} else if (key == "pack") {
+				if (dir == READ) {
+					throw Config_error{key_tree, "`pack' is only valid for write operations"};
+				}
+				m_pack = to_string(value);
+			} else if (key == "replicated") {
+#ifdef H5_HAVE_PARALLEL
+				if (to_string(value) == "node") {
+					if (dir == WRITE) {
+						throw Config_error{key_tree, "`replicated: node' is only valid for read operations"};
+					}
+					m_replicated = 1L;
+					m_replicated_per_node = true;
+				} else {
+					m_replicated = to_string(value);
+				}
+#else
+				throw Config_error{key_tree, "Used HDF5 is not parallel. Invalid replicated"};
+#endif
+			} else if (key == "virtual_dataset") {
+				if (dir == READ) {
+					throw Config_error{key_tree, "`virtual_dataset' is only valid for write operations"};
+				}
+#ifdef H5_HAVE_PARALLEL
+				m_virtual_dataset = make_shared<Virtual_dataset>(value);
+#else
+				throw Config_error{key_tree, "Used HDF5 is not parallel. Invalid virtual_dataset"};
+#endif
 			} else if (key == "attributes") {
 				// pass
 			} else if (key == "mpio") {
@@ -180,6 +392,20 @@ Dataset_op::Dataset_op(Direction dir, string name, Expression default_when, PC_t
 		}
 	});
 
+	if (m_incremental && !(m_collision_policy & Collision_policy::WRITE_INTO)) {
+		throw Config_error{tree, "`incremental' requires the `write_into' collision policy"};
+	}
+
+#ifdef H5_HAVE_PARALLEL
+	if (m_virtual_dataset && m_append) {
+		throw Config_error{tree, "`virtual_dataset' can not be used with `append'"};
+	}
+	// a skipped write would leave the other processes waiting for its mapping
+	if (m_virtual_dataset && ((file_collision_policy & Collision_policy::SKIP) || (m_collision_policy & Collision_policy::SKIP))) {
+		throw Config_error{tree, "`virtual_dataset' can not be used with the `skip' collision policies"};
+	}
+#endif
+
 	// need to know the final dataset expression
 	PC_tree_t attribute_tree = PC_get(tree, ".attributes");
 	if (!PC_status(attribute_tree)) {
@@ -211,7 +437,30 @@ void Dataset_op::fletcher(Context& ctx, Expression value)
 	}
 }
 
-void Dataset_op::execute(Context& ctx, hid_t h5_file, bool use_mpio, const unordered_map<string, Datatype_template_sptr>& dsets)
+void Dataset_op::shuffle(Context& ctx, Expression value)
+{
+	if (m_shuffle) {
+		ctx.logger().warn("shuffle defined at file and dataset level (the dataset shuffle setting will be used)");
+	} else {
+		m_shuffle = value;
+	}
+}
+
+void Dataset_op::compression_threads(Context& ctx, Expression value)
+{
+	if (m_compression_threads) {
+		ctx.logger().warn("compression_threads defined at file and dataset level (the dataset compression_threads setting will be used)");
+	} else {
+		m_compression_threads = value;
+	}
+}
+
+void Dataset_op::dataset_creation_properties(const Properties& properties)
+{
+	m_dataset_creation_properties.merge(properties);
+}
+
+void Dataset_op::execute(Context& ctx, hid_t h5_file, bool use_mpio, File_communicators* comms, const unordered_map<string, Datatype_template_sptr>& dsets)
 {
 	Raii_hid xfer_lst = make_raii_hid(H5Pcreate(H5P_DATASET_XFER), H5Pclose);
 	if (use_mpio) {
@@ -220,13 +469,13 @@ void Dataset_op::execute(Context& ctx, hid_t h5_file, bool use_mpio, const unord
 		}
 	}
 	if (m_direction == READ) {
-		do_read(ctx, h5_file, xfer_lst);
+		do_read(ctx, h5_file, xfer_lst, use_mpio, comms);
 	} else {
-		do_write(ctx, h5_file, xfer_lst, dsets);
+		do_write(ctx, h5_file, xfer_lst, use_mpio, comms, dsets);
 	}
 }
 
-void Dataset_op::do_read(Context& ctx, hid_t h5_file, hid_t read_lst)
+void Dataset_op::do_read(Context& ctx, hid_t h5_file, hid_t read_lst, bool use_mpio, File_communicators* comms)
 {
 	string dataset_name = m_dataset.to_string(ctx);
 	ctx.logger().trace("Preparing for reading `{}' dataset", dataset_name);
@@ -240,7 +489,7 @@ void Dataset_op::do_read(Context& ctx, hid_t h5_file, hid_t read_lst)
 	Raii_hid h5_mem_space, h5_mem_type;
 	tie(h5_mem_space, h5_mem_type) = space(ref.type());
 	ctx.logger().trace("Applying `{}' memory selection", dataset_name);
-	m_memory_selection.apply(ctx, h5_mem_space);
+	hsize_t n_mem_pts = m_memory_selection.apply(ctx, h5_mem_space);
 
 	ctx.logger().trace("Opening `{}' dataset", dataset_name);
 	Raii_hid h5_set
@@ -250,28 +499,90 @@ void Dataset_op::do_read(Context& ctx, hid_t h5_file, hid_t read_lst)
 	Raii_hid h5_file_space = make_raii_hid(H5Dget_space(h5_set), H5Sclose, ("Cannot inquire `" + dataset_name + "' dataset dataspace").c_str());
 
 	ctx.logger().trace("Applying `{}' dataset selection", dataset_name);
-	m_dataset_selection.apply(ctx, h5_file_space, h5_mem_space);
+	hsize_t n_file_pts = m_dataset_selection.apply(ctx, h5_file_space, h5_mem_space);
 
 	ctx.logger().trace("Validating `{}' dataset dataspaces selection", dataset_name);
-	validate_dataspaces(m_dataset_selection.selection_tree(), h5_mem_space, h5_file_space, dataset_name);
+	validate_dataspaces(m_dataset_selection.selection_tree(), h5_mem_space, h5_file_space, n_mem_pts, n_file_pts, dataset_name);
 
-	ctx.logger().trace("Reading `{}' dataset", dataset_name);
-	if (0 > H5Dread(h5_set, h5_mem_type, h5_mem_space, h5_file_space, read_lst, ref)) handle_hdf5_err();
+	if (m_prefetch && !m_prefetcher) {
+		ctx.logger().warn("HDF5 is not thread-safe, `{}' dataset is read without prefetching", dataset_name);
+		m_prefetch = Expression{};
+	}
+
+	// background reads are not done in parallel, they would require MPI_THREAD_MULTIPLE
+	bool prefetch = m_prefetcher && !use_mpio;
+	string filename;
+	if (prefetch) {
+		ssize_t filename_size = H5Fget_name(h5_file, NULL, 0);
+		if (0 > filename_size) handle_hdf5_err();
+		filename.resize(filename_size + 1);
+		if (0 > H5Fget_name(h5_file, &filename[0], filename.size())) handle_hdf5_err();
+		filename.resize(filename_size);
+	}
+
+#ifdef H5_HAVE_PARALLEL
+	bool replicated = m_replicated && m_replicated.to_long(ctx);
+	if (replicated && !use_mpio) {
+		ctx.logger().debug("`{}' dataset is not read in parallel, ignoring replication", dataset_name);
+		replicated = false;
+	}
+#endif
+
+	if (prefetch && m_prefetcher->fetch(filename, dataset_name, h5_file_space, h5_mem_type, h5_mem_space, ref)) {
+		ctx.logger().trace("`{}' dataset served from prefetched data", dataset_name);
+#ifdef H5_HAVE_PARALLEL
+	} else if (replicated) {
+		ctx.logger().trace("Reading replicated `{}' dataset on one process {}", dataset_name, m_replicated_per_node ? "per node" : "in total");
+		replicated_read(ctx, *comms, h5_set, h5_mem_type, h5_mem_space, h5_file_space, read_lst, m_replicated_per_node, ref);
+#endif
+	} else {
+		ctx.logger().trace("Reading `{}' dataset", dataset_name);
+		if (0 > H5Dread(h5_set, h5_mem_type, h5_mem_space, h5_file_space, read_lst, ref)) handle_hdf5_err();
+	}
 
 	for (auto&& attr: m_attributes) {
 		attr.execute(ctx, h5_file);
 	}
+
+	if (prefetch) {
+		string next_dataset_name;
+		try {
+			next_dataset_name = m_prefetch.to_string(ctx);
+		} catch (const Error& e) {
+			ctx.logger().debug("Not prefetching after `{}' dataset: {}", dataset_name, e.what());
+		}
+		if (!next_dataset_name.empty()) {
+			ctx.logger().trace("Prefetching `{}' dataset", next_dataset_name);
+			Raii_hid h5_file_access_list = make_raii_hid(H5Fget_access_plist(h5_file), H5Pclose);
+			m_prefetcher->prefetch(filename, next_dataset_name, h5_file_access_list, h5_file_space, h5_mem_type);
+		}
+	}
 	ctx.logger().trace("`{}' dataset read finished", dataset_name);
 }
 
-hid_t Dataset_op::dataset_creation_plist(Context& ctx, const Datatype* dataset_type, const string& dataset_name)
+hid_t Dataset_op::dataset_creation_plist(
+	Context& ctx,
+	const Datatype* dataset_type,
+	const string& dataset_name,
+	hid_t h5_file_space,
+	hid_t h5_file_type
+)
 {
 	hid_t dset_plist = H5Pcreate(H5P_DATASET_CREATE);
+	m_dataset_creation_properties.apply(ctx, dset_plist);
+
 	// chunking
 	Ref_r chunking_ref;
+	bool chunking_auto = m_chunking_auto;
 	try {
-		chunking_ref = dataset_type->attribute("decl_hdf5.chunking").to_ref(ctx);
+		Expression chunking_attr = dataset_type->attribute("decl_hdf5.chunking");
 		ctx.logger().trace("Getting `{}' dataset chunking from type attribute", dataset_name);
+		if (chunking_attr.to_string(ctx) == "auto") {
+			chunking_auto = true;
+		} else {
+			chunking_auto = false;
+			chunking_ref = chunking_attr.to_ref(ctx);
+		}
 	} catch (const Type_error& e) {
 		// no chunking attribute, check dataset option
 		if (m_chunking) {
@@ -279,9 +590,9 @@ hid_t Dataset_op::dataset_creation_plist(Context& ctx, const Datatype* dataset_t
 			chunking_ref = m_chunking.to_ref(ctx);
 		}
 	}
+	vector<hsize_t> sizes;
 	if (chunking_ref) {
 		ctx.logger().trace("Setting `{}' dataset chunking:", dataset_name);
-		vector<hsize_t> sizes;
 		Datatype_sptr ref_type = chunking_ref.type();
 		if (auto&& scalar_type = dynamic_pointer_cast<const Scalar_datatype>(ref_type)) {
 			sizes.emplace_back(chunking_ref.scalar_value<size_t>());
@@ -302,8 +613,30 @@ hid_t Dataset_op::dataset_creation_plist(Context& ctx, const Datatype* dataset_t
 		}
 	}
 
+	// scale-offset and N-bit, reduce the values before they are shuffled and deflated
+	bool precision_filtered = m_precision.set_filters(ctx, dataset_type, dataset_name, dset_plist, h5_file_type);
+
+	// shuffle, must be set before deflate to be applied first
+	long shuffle = 0;
+	try {
+		shuffle = dataset_type->attribute("decl_hdf5.shuffle").to_long(ctx);
+		ctx.logger().trace("Getting `{}' dataset shuffle from type attribute", dataset_name);
+	} catch (const Type_error& e) {
+		// no shuffle attribute, check dataset option
+		if (m_shuffle) {
+			ctx.logger().trace("Getting `{}' dataset shuffle from dataset operation", dataset_name);
+			shuffle = m_shuffle.to_long(ctx);
+		}
+	}
+	if (shuffle) {
+		ctx.logger().trace("Setting `{}' dataset shuffle", dataset_name);
+		if (0 > H5Pset_shuffle(dset_plist)) {
+			handle_hdf5_err(fmt::format("Cannot set `{}' dataset shuffle", dataset_name).c_str());
+		}
+	}
+
 	// deflate
-	unsigned int deflate_level = -1;
+	long deflate_level = -1;
 	try {
 		deflate_level = dataset_type->attribute("decl_hdf5.deflate").to_long(ctx);
 		ctx.logger().trace("Getting `{}' dataset deflate from type attribute", dataset_name);
@@ -340,10 +673,48 @@ hid_t Dataset_op::dataset_creation_plist(Context& ctx, const Datatype* dataset_t
 		}
 	}
 
+	// filters and extensible datasets require a chunked layout
+	if (sizes.empty() && (precision_filtered || shuffle || deflate_level != -1 || fletcher != -1) && !chunking_auto) {
+		ctx.logger().debug("No chunking defined for filtered `{}' dataset, using automatic chunking", dataset_name);
+		chunking_auto = true;
+	}
+	int rank = H5Sget_simple_extent_ndims(h5_file_space);
+	if (0 > rank) handle_hdf5_err();
+	vector<hsize_t> maxdims(rank);
+	if (rank > 0 && 0 > H5Sget_simple_extent_dims(h5_file_space, NULL, &maxdims[0])) handle_hdf5_err();
+	if (sizes.empty() && std::count(maxdims.begin(), maxdims.end(), H5S_UNLIMITED) && !chunking_auto) {
+		ctx.logger().debug("No chunking defined for extensible `{}' dataset, using automatic chunking", dataset_name);
+		chunking_auto = true;
+	}
+	if (sizes.empty() && chunking_auto) {
+		hsize_t target_size = m_chunking_target_size.to_long(ctx);
+		sizes = auto_chunking(h5_file_space, h5_file_type, target_size);
+		if (sizes.empty()) {
+			ctx.logger().debug("Automatic chunking: `{}' dataset can not be chunked, using contiguous layout", dataset_name);
+		} else {
+			ctx.logger().debug(
+				"Automatic chunking: `{}' dataset chunks set to [{}] ({} B target)",
+				dataset_name,
+				fmt::join(sizes, ", "),
+				target_size
+			);
+			if (0 > H5Pset_chunk(dset_plist, sizes.size(), sizes.data())) {
+				handle_hdf5_err(fmt::format("Cannot set `{}' dataset chunking", dataset_name).c_str());
+			}
+		}
+	}
+
 	return dset_plist;
 }
 
-void Dataset_op::do_write(Context& ctx, hid_t h5_file, hid_t write_lst, const unordered_map<string, Datatype_template_sptr>& dsets)
+void Dataset_op::do_write(
+	Context& ctx,
+	hid_t h5_file,
+	hid_t write_lst,
+	bool use_mpio,
+	File_communicators* comms,
+	const unordered_map<string, Datatype_template_sptr>& dsets
+)
 {
 	string dataset_name = m_dataset.to_string(ctx);
 	ctx.logger().trace("Preparing for writing `{}' dataset", dataset_name);
@@ -356,36 +727,60 @@ void Dataset_op::do_write(Context& ctx, hid_t h5_file, hid_t write_lst, const un
 	Raii_hid h5_mem_space, h5_mem_type;
 	tie(h5_mem_space, h5_mem_type) = space(ref.type());
 	ctx.logger().trace("Applying `{}' memory selection", dataset_name);
-	m_memory_selection.apply(ctx, h5_mem_space);
+	hsize_t n_mem_pts = m_memory_selection.apply(ctx, h5_mem_space);
 
 	auto&& dataset_type_iter = dsets.find(dataset_name);
 	Datatype_sptr dataset_type;
 	Raii_hid h5_file_type, h5_file_space;
+	hsize_t n_file_pts;
 	if (dataset_type_iter != dsets.end()) {
 		dataset_type = dataset_type_iter->second->evaluate(ctx);
 		tie(h5_file_space, h5_file_type) = space(dataset_type);
 		ctx.logger().trace("Applying `{}' dataset selection", dataset_name);
-		m_dataset_selection.apply(ctx, h5_file_space, h5_mem_space);
+		n_file_pts = m_dataset_selection.apply(ctx, h5_file_space, h5_mem_space);
 	} else {
-		if (!m_dataset_selection.size().empty()) {
+		if (!m_dataset_selection.size().empty() || !m_dataset_selection.stride().empty() || !m_dataset_selection.block().empty()) {
 			throw Config_error{m_dataset_selection.selection_tree(), "Dataset selection is invalid in implicit dataset `{}'", dataset_name};
 		}
 		dataset_type = ref.type();
 		tie(h5_file_space, h5_file_type) = space(dataset_type, true);
+		hssize_t n_dense_pts = H5Sget_select_npoints(h5_file_space);
+		if (0 > n_dense_pts) handle_hdf5_err();
+		n_file_pts = n_dense_pts;
+	}
+	if (m_pack && m_pack.to_long(ctx) && H5T_COMPOUND == H5Tget_class(h5_file_type)) {
+		// store the records without their in-memory padding
+		Raii_hid h5_packed_type = make_raii_hid(H5Tcopy(h5_file_type), H5Tclose);
+		if (0 > H5Tpack(h5_packed_type)) handle_hdf5_err();
+		h5_file_type = std::move(h5_packed_type);
 	}
+	m_precision.reduce_type(ctx, dataset_type.get(), h5_file_type);
 
 	ctx.logger().trace("Validating `{}' dataset dataspaces selection", dataset_name);
-	validate_dataspaces(m_dataset_selection.selection_tree(), h5_mem_space, h5_file_space, dataset_name);
+	validate_dataspaces(m_dataset_selection.selection_tree(), h5_mem_space, h5_file_space, n_mem_pts, n_file_pts, dataset_name);
 
 	Raii_hid set_lst = make_raii_hid(H5Pcreate(H5P_LINK_CREATE), H5Pclose);
 	if (0 > H5Pset_create_intermediate_group(set_lst, 1)) handle_hdf5_err();
 
+	bool append = m_append && m_append.to_long(ctx);
+	Raii_hid h5_record_space;
+	if (append) {
+		// the data is a record of a dataset with an additional unlimited dimension, created with a single record
+		h5_record_space = std::move(h5_file_space);
+		h5_file_space = append_space(h5_record_space, 1, 0);
+	}
+
 	ctx.logger().trace("Opening `{}' dataset", dataset_name);
 	hid_t h5_set_raw = H5Dopen2(h5_file, dataset_name.c_str(), H5P_DEFAULT);
-	Raii_hid dset_plist = make_raii_hid(dataset_creation_plist(ctx, dataset_type.get(), dataset_name), H5Pclose);
-	if (0 > h5_set_raw) {
+	Raii_hid dset_plist = make_raii_hid(dataset_creation_plist(ctx, dataset_type.get(), dataset_name, h5_file_space, h5_file_type), H5Pclose);
+	bool extend = false;
+	bool created = 0 > h5_set_raw;
+	if (created) {
 		ctx.logger().trace("Cannot open `{}' dataset, creating", dataset_name);
 		h5_set_raw = H5Dcreate2(h5_file, dataset_name.c_str(), h5_file_type, h5_file_space, set_lst, dset_plist, H5P_DEFAULT);
+	} else if (append) {
+		// Dataset exists -> add a record at its end
+		extend = true;
 	} else {
 		// Dataset exists -> collision
 		function<void(const char*, const std::string&)> notify = [&](const char* message, const std::string& filename) {
@@ -406,6 +801,7 @@ void Dataset_op::do_write(Context& ctx, hid_t h5_file, hid_t write_lst, const un
 			H5Dclose(h5_set_raw);
 			if (0 > H5Ldelete(h5_file, dataset_name.c_str(), H5P_DEFAULT)) handle_hdf5_err();
 			;
+			created = true;
 			h5_set_raw = H5Dcreate2(h5_file, dataset_name.c_str(), h5_file_type, h5_file_space, set_lst, dset_plist, H5P_DEFAULT);
 			if (h5_set_raw < 0) {
 				throw System_error{"Dataset collision `{}': Cannot create a dataset after deleting old one", dataset_name};
@@ -419,13 +815,93 @@ void Dataset_op::do_write(Context& ctx, hid_t h5_file, hid_t write_lst, const un
 		}
 	}
 	Raii_hid h5_set = make_raii_hid(h5_set_raw, H5Dclose);
+	if (extend) {
+		ctx.logger().trace("Appending a record to `{}' dataset", dataset_name);
+		h5_file_space = append_record(h5_set, h5_record_space, dataset_name);
+	}
 
-	ctx.logger().trace("Writing `{}' dataset", dataset_name);
-	if (0 > H5Dwrite(h5_set, h5_mem_type, h5_mem_space, h5_file_space, write_lst, ref)) handle_hdf5_err();
+	// records are packed to the dataset layout beforehand so that HDF5 has no conversion to do
+	Raii_hid h5_set_type = make_raii_hid(H5Dget_type(h5_set), H5Tclose);
+	hid_t h5_write_type = h5_mem_type;
+	hid_t h5_write_space = h5_mem_space;
+	const void* write_data = ref.get();
+	Raii_hid h5_packed_space;
+	if (const void* packed_data = m_packer->pack(h5_mem_type, h5_mem_space, h5_set_type, write_data)) {
+		ctx.logger().trace("Packed `{}' records to the dataset layout", dataset_name);
+		h5_packed_space = make_raii_hid(H5Screate_simple(1, &n_mem_pts, NULL), H5Sclose);
+		h5_write_type = h5_set_type;
+		h5_write_space = h5_packed_space;
+		write_data = packed_data;
+	}
+	write_data = m_precision.round(ctx, dataset_type.get(), h5_write_type, h5_write_space, write_data);
+
+#ifdef H5_HAVE_PARALLEL
+	if (m_replicated && m_replicated.to_long(ctx)) {
+		if (!use_mpio) {
+			ctx.logger().debug("`{}' dataset is not written in parallel, ignoring replication", dataset_name);
+		} else if (!replicated_owner(*comms)) {
+			// the write remains collective, only the owner process selects data
+			ctx.logger().trace("Replicated `{}' dataset written by another process", dataset_name);
+			if (0 > H5Sselect_none(h5_write_space)) handle_hdf5_err();
+			if (0 > H5Sselect_none(h5_file_space)) handle_hdf5_err();
+		}
+	}
+#endif
+
+	bool written = false;
+	if (m_incremental && m_incremental.to_long(ctx)) {
+		// the chunk hashes are not shared between processes
+		if (!use_mpio) {
+			ctx.logger().trace("Writing modified chunks of `{}' dataset", dataset_name);
+			written = incremental_write(ctx, h5_file, dataset_name, h5_set, created, h5_write_type, h5_write_space, h5_file_space, write_lst, write_data);
+		}
+		if (!written) {
+			ctx.logger().debug("Incremental write not applicable to `{}' dataset", dataset_name);
+			drop_chunk_hashes(h5_file, dataset_name);
+		}
+	}
+#ifdef DECL_HDF5_HAVE_ZLIB
+	// H5Dwrite_chunk is not supported by parallel HDF5
+	if (!written && m_compression_threads && !use_mpio) {
+		long nb_threads = m_compression_threads.to_long(ctx);
+		if (nb_threads < 0) {
+			throw Value_error{"Invalid compression_threads for `{}' dataset: {}, expecting a positive number or 0", dataset_name, nb_threads};
+		}
+		if (nb_threads != 1) {
+			ctx.logger().trace("Writing `{}' dataset with multithreaded chunk compression", dataset_name);
+			if (!m_compression_pool) {
+				m_compression_pool = std::make_shared<Thread_pool>();
+			}
+			written = direct_chunk_write(
+				ctx,
+				h5_set,
+				h5_write_type,
+				h5_write_space,
+				h5_file_space,
+				write_data,
+				nb_threads,
+				*m_compression_pool
+			);
+			if (!written) {
+				ctx.logger().debug("Multithreaded chunk compression not applicable to `{}' dataset", dataset_name);
+			}
+		}
+	}
+#endif
+	if (!written) {
+		ctx.logger().trace("Writing `{}' dataset", dataset_name);
+		if (0 > H5Dwrite(h5_set, h5_write_type, h5_write_space, h5_file_space, write_lst, write_data)) handle_hdf5_err();
+	}
 
 	for (auto&& attr: m_attributes) {
 		attr.execute(ctx, h5_file);
 	}
+
+#ifdef H5_HAVE_PARALLEL
+	if (m_virtual_dataset) {
+		m_virtual_dataset->update(ctx, h5_file, dataset_name, h5_file_space, h5_file_type);
+	}
+#endif
 	ctx.logger().trace("`{}' dataset write finished", dataset_name);
 }
 
@@ -32,6 +32,7 @@
 #include <mpi.h>
 #endif
 
+#include <memory>
 #include <string>
 #include <unordered_map>
 
@@ -43,7 +44,14 @@
 
 #include "attribute_op.h"
 #include "collision_policy.h"
+#include "direct_chunk_write.h"
+#include "precision.h"
+#include "prefetcher.h"
+#include "properties.h"
+#include "record_packer.h"
+#include "replication.h"
 #include "selection.h"
+#include "virtual_dataset.h"
 
 namespace decl_hdf5 {
 
@@ -93,12 +101,62 @@ private:
 	/// chunking property set from yaml
 	PDI::Expression m_chunking;
 
+	/// whether chunking is automatically computed (`chunking: auto`)
+	bool m_chunking_auto = false;
+
+	/// target size in bytes of automatically computed chunks
+	PDI::Expression m_chunking_target_size = 1L << 20;
+
 	/// deflate property set from yaml
 	PDI::Expression m_deflate;
 
 	/// fletcher property set from yaml
 	PDI::Expression m_fletcher;
 
+	/// shuffle property set from yaml
+	PDI::Expression m_shuffle;
+
+	/// lossy precision reduction applied on write
+	Precision m_precision;
+
+	/// number of threads used to compress the dataset chunks
+	PDI::Expression m_compression_threads;
+
+	/// threads compressing the dataset chunks, kept between writes and shared by the copies of this operation
+	std::shared_ptr<Thread_pool> m_compression_pool;
+
+	/// whether each write appends a record to an extensible dataset
+	PDI::Expression m_append;
+
+	/// whether only the chunks modified since the last write are written
+	PDI::Expression m_incremental;
+
+	/// the name of the dataset to read in the background after each read
+	PDI::Expression m_prefetch;
+
+	/// the background reader, shared between the copies of this operation
+	std::shared_ptr<Prefetcher> m_prefetcher;
+
+	/// whether records are stored without padding in the dataset
+	PDI::Expression m_pack;
+
+	/// the conversion of records to the dataset layout, shared between the copies of this operation
+	std::shared_ptr<Record_packer> m_packer;
+
+#ifdef H5_HAVE_PARALLEL
+	/// whether the data is the same on all processes and only transferred by one of them
+	PDI::Expression m_replicated;
+
+	/// whether replicated data is transferred by one process per node instead of one in total
+	bool m_replicated_per_node = false;
+
+	/// the virtual dataset giving a global view of this dataset, shared between the copies of this operation
+	std::shared_ptr<Virtual_dataset> m_virtual_dataset;
+#endif
+
+	/// additional properties used to create the dataset
+	Properties m_dataset_creation_properties;
+
 	/// attributes of this dataset
 	std::vector<Attribute_op> m_attributes;
 
@@ -107,10 +165,18 @@ private:
 	 * \param ctx the context in which to operate
 	 * \param dataset_type type of the dataset
 	 * \param dataset_name name of the dataset
+	 * \param h5_file_space the dataset dataspace with the dataset selection applied
+	 * \param h5_file_type the dataset HDF5 type
 	 *
 	 * \return dataset creation plist hid_t
 	 */
-	hid_t dataset_creation_plist(PDI::Context& ctx, const PDI::Datatype* dataset_type, const std::string& dataset_name);
+	hid_t dataset_creation_plist(
+		PDI::Context& ctx,
+		const PDI::Datatype* dataset_type,
+		const std::string& dataset_name,
+		hid_t h5_file_space,
+		hid_t h5_file_type
+	);
 
 public:
 	/** Builds a Dataset_op from its yaml config
@@ -181,19 +247,59 @@ public:
 	 */
 	void fletcher(PDI::Context& ctx, PDI::Expression value);
 
+	/** Set shuffle dataset
+	 *
+	 * \param ctx the context in which to operate
+	 * \param value turn on shuffle if true, turn off if false
+	 */
+	void shuffle(PDI::Context& ctx, PDI::Expression value);
+
+	/** Set the number of threads used to compress the dataset chunks
+	 *
+	 * \param ctx the context in which to operate
+	 * \param value the number of threads (0 for one per hardware core)
+	 */
+	void compression_threads(PDI::Context& ctx, PDI::Expression value);
+
+	/** Accesses the number of threads used to compress the dataset chunks
+	 *
+	 * \return The number of threads used to compress the dataset chunks
+	 */
+	const PDI::Expression& compression_threads() const { return m_compression_threads; }
+
+	/** Set the default properties used to create the dataset
+	 *
+	 * \param properties the properties to use when not set at the dataset level
+	 */
+	void dataset_creation_properties(const Properties& properties);
+
 	/** Executes the requested operation.
 	 *
 	 * \param ctx the context in which to operate
 	 * \param h5_file the already opened HDF5 file id
 	 * \param use_mpio whether the hdf5 read/write is parallel
+	 * \param comms the communicators of the file, used to replicate data if the file is opened in parallel
 	 * \param dsets the type of the explicitly typed datasets
 	 */
-	void execute(PDI::Context& ctx, hid_t h5_file, bool use_mpio, const std::unordered_map<std::string, PDI::Datatype_template_sptr>& dsets);
+	void execute(
+		PDI::Context& ctx,
+		hid_t h5_file,
+		bool use_mpio,
+		File_communicators* comms,
+		const std::unordered_map<std::string, PDI::Datatype_template_sptr>& dsets
+	);
 
 private:
-	void do_read(PDI::Context& ctx, hid_t h5_file, hid_t read_lst);
-
-	void do_write(PDI::Context& ctx, hid_t h5_file, hid_t xfer_lst, const std::unordered_map<std::string, PDI::Datatype_template_sptr>& dsets);
+	void do_read(PDI::Context& ctx, hid_t h5_file, hid_t read_lst, bool use_mpio, File_communicators* comms);
+
+	void do_write(
+		PDI::Context& ctx,
+		hid_t h5_file,
+		hid_t xfer_lst,
+		bool use_mpio,
+		File_communicators* comms,
+		const std::unordered_map<std::string, PDI::Datatype_template_sptr>& dsets
+	);
 };
 
 } // namespace decl_hdf5
@@ -28,6 +28,8 @@
 #include <mpi.h>
 #endif
 
+#include <exception>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -52,6 +54,8 @@ using PDI::Plugin;
 using PDI::Ref;
 using PDI::to_long;
 using PDI::to_string;
+using std::lock_guard;
+using std::recursive_mutex;
 using std::string;
 using std::unordered_map;
 using std::vector;
@@ -68,6 +72,9 @@ class decl_hdf5_plugin: public Plugin
 	/// the file operations to execute on data, we use a map of vector vs. multimap to conserve order
 	unordered_map<string, vector<File_op>> m_data;
 
+	/// the file operations whose file staged in memory is flushed on events
+	unordered_map<string, vector<File_op>> m_flushes;
+
 public:
 	decl_hdf5_plugin(Context& ctx, PC_tree_t config)
 		: Plugin{ctx}
@@ -76,6 +83,9 @@ public:
 		if (0 > H5open()) handle_hdf5_err("Cannot initialize HDF5 library");
 		opt_each(config, [&](PC_tree_t elem) {
 			for (auto&& op: File_op::parse(ctx, elem)) {
+				for (auto&& evname: op.flush_on()) {
+					m_flushes[evname].emplace_back(op);
+				}
 				auto&& events = op.event();
 				if (events.empty()) {
 					// if there are no event names, this is data triggered
@@ -108,12 +118,33 @@ public:
 
 	~decl_hdf5_plugin()
 	{
+		// write the files staged in memory, the prefetch threads are still running
+		{
+			lock_guard<recursive_mutex> lock{hdf5_mutex()};
+			for (auto&& ops: {&m_events, &m_data}) {
+				for (auto&& event_ops: *ops) {
+					for (auto&& op: event_ops.second) {
+						try {
+							Hdf5_error_handler _;
+							op.flush(context());
+						} catch (const std::exception& e) {
+							context().logger().error("While finalizing: {}", e.what());
+						}
+					}
+				}
+			}
+		}
+		// stop the background threads of the operations and close the staged files before closing HDF5
+		m_events.clear();
+		m_data.clear();
+		m_flushes.clear();
 		if (0 > H5close()) handle_hdf5_err("Cannot finalize HDF5 library");
 		context().logger().info("Closing plugin");
 	}
 
 	void data(const std::string& name, Ref ref)
 	{
+		lock_guard<recursive_mutex> lock{hdf5_mutex()};
 		Hdf5_error_handler _;
 		for (auto&& op: m_data[name]) {
 			op.execute(context());
@@ -122,10 +153,14 @@ public:
 
 	void event(const std::string& event)
 	{
+		lock_guard<recursive_mutex> lock{hdf5_mutex()};
 		Hdf5_error_handler _;
 		for (auto&& op: m_events[event]) {
 			op.execute(context());
 		}
+		for (auto&& op: m_flushes[event]) {
+			op.flush(context());
+		}
 	}
 
 	/** Pretty name for the plugin that will be shown in the logger
@@ -0,0 +1,350 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include <hdf5.h>
+#ifdef H5_HAVE_PARALLEL
+#include <mpi.h>
+#endif
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <pdi/context.h>
+#include <pdi/error.h>
+
+#include "hdf5_wrapper.h"
+
+#include "direct_chunk_write.h"
+
+using PDI::Context;
+using PDI::System_error;
+using std::atomic;
+using std::condition_variable;
+using std::min;
+using std::mutex;
+using std::thread;
+using std::unique_lock;
+using std::vector;
+
+namespace {
+
+using namespace decl_hdf5;
+
+/** Shuffles the bytes of a buffer the same way as the HDF5 shuffle filter
+ *
+ * \param from the buffer to shuffle
+ * \param to the buffer where to store the shuffled bytes
+ * \param nbytes the size of both buffers
+ * \param element_size the size of an element in the buffer
+ */
+void shuffle(const unsigned char* from, unsigned char* to, size_t nbytes, size_t element_size)
+{
+	size_t nb_elements = nbytes / element_size;
+	for (size_t byte = 0; byte < element_size; ++byte) {
+		unsigned char* byte_to = to + byte * nb_elements;
+		for (size_t element = 0; element < nb_elements; ++element) {
+			byte_to[element] = from[element * element_size + byte];
+		}
+	}
+	// leftover bytes are stored unchanged at the end
+	memcpy(to + nb_elements * element_size, from + nb_elements * element_size, nbytes % element_size);
+}
+
+/// A chunk compressed by a worker thread
+struct Compressed_chunk {
+	/// the compressed data
+	vector<unsigned char> data;
+
+	/// whether the compression is finished
+	bool ready = false;
+};
+
+} // namespace
+
+namespace decl_hdf5 {
+
+void Thread_pool::work(size_t thread_id)
+{
+	size_t done_job_id = 0;
+	unique_lock<mutex> lock(m_mutex);
+	for (;;) {
+		m_job_posted.wait(lock, [&]() { return m_stopping || m_job_id != done_job_id; });
+		if (m_stopping) return;
+		done_job_id = m_job_id;
+		if (thread_id >= m_job_threads) continue;
+		lock.unlock();
+		m_job();
+		lock.lock();
+		if (--m_running == 0) m_job_done.notify_all();
+	}
+}
+
+Thread_pool::~Thread_pool()
+{
+	{
+		unique_lock<mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_job_posted.notify_all();
+	for (auto&& worker: m_workers) {
+		worker.join();
+	}
+}
+
+void Thread_pool::start(size_t nb_threads, std::function<void()> job)
+{
+	m_job_lock = unique_lock<mutex>(m_job_mutex);
+	unique_lock<mutex> lock(m_mutex);
+	while (m_workers.size() < nb_threads) {
+		m_workers.emplace_back([this, thread_id = m_workers.size()]() { work(thread_id); });
+	}
+	m_job = std::move(job);
+	m_job_threads = nb_threads;
+	m_running = nb_threads;
+	++m_job_id;
+	m_job_posted.notify_all();
+}
+
+void Thread_pool::wait()
+{
+	{
+		unique_lock<mutex> lock(m_mutex);
+		m_job_done.wait(lock, [&]() { return m_running == 0; });
+		m_job = nullptr;
+	}
+	m_job_lock.unlock();
+}
+
+bool direct_chunk_write(
+	Context& ctx,
+	hid_t h5_set,
+	hid_t h5_mem_type,
+	hid_t h5_mem_space,
+	hid_t h5_file_space,
+	const void* data,
+	size_t nb_threads,
+	Thread_pool& pool
+)
+{
+	// the filters must be limited to shuffle & deflate
+	Raii_hid dset_plist = make_raii_hid(H5Dget_create_plist(h5_set), H5Pclose);
+	if (H5Pget_layout(dset_plist) != H5D_CHUNKED) return false;
+	int nb_filters = H5Pget_nfilters(dset_plist);
+	if (0 > nb_filters) handle_hdf5_err();
+	bool use_shuffle = false;
+	int deflate_level = -1;
+	for (int filter_id = 0; filter_id < nb_filters; ++filter_id) {
+		unsigned int flags;
+		size_t cd_nelmts = 1;
+		unsigned int cd_values[1] = {0};
+		H5Z_filter_t filter = H5Pget_filter2(dset_plist, filter_id, &flags, &cd_nelmts, cd_values, 0, NULL, NULL);
+		if (filter == H5Z_FILTER_SHUFFLE && deflate_level == -1) {
+			use_shuffle = true;
+		} else if (filter == H5Z_FILTER_DEFLATE) {
+			deflate_level = cd_values[0];
+		} else {
+			return false;
+		}
+	}
+	if (deflate_level == -1) return false;
+
+	// no type conversion must be required
+	Raii_hid h5_file_type = make_raii_hid(H5Dget_type(h5_set), H5Tclose);
+	htri_t same_types = H5Tequal(h5_file_type, h5_mem_type);
+	if (0 > same_types) handle_hdf5_err();
+	if (!same_types) return false;
+	size_t element_size = H5Tget_size(h5_mem_type);
+	if (0 == element_size) handle_hdf5_err();
+
+	// the selection must be a single block aligned on chunks
+	int rank = H5Sget_simple_extent_ndims(h5_file_space);
+	if (0 >= rank) return false;
+	vector<hsize_t> dims(rank);
+	if (0 > H5Sget_simple_extent_dims(h5_file_space, &dims[0], NULL)) handle_hdf5_err();
+	vector<hsize_t> chunk(rank);
+	if (rank != H5Pget_chunk(dset_plist, rank, &chunk[0])) handle_hdf5_err();
+	hssize_t nb_points = H5Sget_select_npoints(h5_file_space);
+	if (0 >= nb_points) return false;
+	vector<hsize_t> start(rank);
+	vector<hsize_t> extent(rank);
+	if (0 > H5Sget_select_bounds(h5_file_space, &start[0], &extent[0])) handle_hdf5_err();
+	hsize_t block_points = 1;
+	for (int dim = 0; dim < rank; ++dim) {
+		extent[dim] = extent[dim] - start[dim] + 1;
+		block_points *= extent[dim];
+		if (start[dim] % chunk[dim]) return false;
+		hsize_t end = start[dim] + extent[dim];
+		if (end % chunk[dim] && end != dims[dim]) return false;
+	}
+	if (block_points != static_cast<hsize_t>(nb_points)) return false;
+
+	// get the selected data as a dense block
+	const unsigned char* block = static_cast<const unsigned char*>(data);
+	vector<unsigned char> gathered;
+	hssize_t mem_extent_points = H5Sget_simple_extent_npoints(h5_mem_space);
+	if (0 > mem_extent_points) handle_hdf5_err();
+	if (mem_extent_points != nb_points) {
+		ctx.logger().trace("Gathering sparse memory selection before compression");
+		gathered.resize(nb_points * element_size);
+		if (0 > H5Dgather(h5_mem_space, data, h5_mem_type, gathered.size(), gathered.data(), NULL, NULL)) handle_hdf5_err();
+		block = gathered.data();
+	}
+
+	// strides (in elements) of the block and of a chunk
+	vector<hsize_t> nb_chunks(rank);
+	vector<hsize_t> block_stride(rank);
+	vector<hsize_t> chunk_stride(rank);
+	hsize_t total_chunks = 1;
+	for (int dim = rank - 1; dim >= 0; --dim) {
+		nb_chunks[dim] = (extent[dim] + chunk[dim] - 1) / chunk[dim];
+		total_chunks *= nb_chunks[dim];
+		block_stride[dim] = (dim == rank - 1) ? 1 : block_stride[dim + 1] * extent[dim + 1];
+		chunk_stride[dim] = (dim == rank - 1) ? 1 : chunk_stride[dim + 1] * chunk[dim + 1];
+	}
+	size_t chunk_bytes = chunk_stride[0] * chunk[0] * element_size;
+
+	// position of a chunk in the block from its linear index
+	auto chunk_position = [&](hsize_t chunk_id) {
+		vector<hsize_t> position(rank);
+		for (int dim = rank - 1; dim >= 0; --dim) {
+			position[dim] = (chunk_id % nb_chunks[dim]) * chunk[dim];
+			chunk_id /= nb_chunks[dim];
+		}
+		return position;
+	};
+
+	if (nb_threads == 0) nb_threads = std::max(1u, thread::hardware_concurrency());
+	nb_threads = min<size_t>(nb_threads, total_chunks);
+	// maximum number of compressed chunks waiting to be written
+	const hsize_t max_pending = 4 * nb_threads;
+
+	vector<Compressed_chunk> chunks(total_chunks);
+	atomic<hsize_t> next_chunk{0};
+	hsize_t written_chunks = 0;
+	bool failed = false;
+	mutex chunks_mutex;
+	condition_variable chunk_ready;
+	condition_variable chunk_written;
+
+	auto compress_chunks = [&]() {
+		vector<unsigned char> raw(chunk_bytes);
+		vector<unsigned char> shuffled(use_shuffle ? chunk_bytes : 0);
+		for (hsize_t chunk_id = next_chunk++; chunk_id < total_chunks; chunk_id = next_chunk++) {
+			{
+				unique_lock<mutex> lock(chunks_mutex);
+				chunk_written.wait(lock, [&]() { return failed || chunk_id < written_chunks + max_pending; });
+				if (failed) return;
+			}
+
+			// copy the chunk rows from the block, padding with zeroes at the end of the dataset
+			vector<hsize_t> position = chunk_position(chunk_id);
+			vector<hsize_t> valid(rank);
+			bool partial = false;
+			for (int dim = 0; dim < rank; ++dim) {
+				valid[dim] = min(chunk[dim], extent[dim] - position[dim]);
+				partial = partial || valid[dim] != chunk[dim];
+			}
+			if (partial) std::fill(raw.begin(), raw.end(), 0);
+			size_t row_bytes = valid[rank - 1] * element_size;
+			vector<hsize_t> row(rank, 0);
+			for (;;) {
+				hsize_t from = 0;
+				hsize_t to = 0;
+				for (int dim = 0; dim < rank; ++dim) {
+					from += (position[dim] + row[dim]) * block_stride[dim];
+					to += row[dim] * chunk_stride[dim];
+				}
+				memcpy(&raw[to * element_size], block + from * element_size, row_bytes);
+				int dim = rank - 2;
+				while (dim >= 0 && ++row[dim] == valid[dim]) {
+					row[dim] = 0;
+					--dim;
+				}
+				if (dim < 0) break;
+			}
+
+			const unsigned char* to_compress = raw.data();
+			if (use_shuffle) {
+				shuffle(raw.data(), shuffled.data(), chunk_bytes, element_size);
+				to_compress = shuffled.data();
+			}
+			vector<unsigned char> compressed(compressBound(chunk_bytes));
+			uLongf compressed_size = compressed.size();
+			int status = compress2(compressed.data(), &compressed_size, to_compress, chunk_bytes, deflate_level);
+			compressed.resize(compressed_size);
+
+			unique_lock<mutex> lock(chunks_mutex);
+			if (status != Z_OK) {
+				failed = true;
+				chunk_written.notify_all();
+				chunk_ready.notify_all();
+				return;
+			}
+			chunks[chunk_id].data = std::move(compressed);
+			chunks[chunk_id].ready = true;
+			chunk_ready.notify_all();
+		}
+	};
+
+	ctx.logger().debug("Compressing {} chunks with {} threads", total_chunks, nb_threads);
+	pool.start(nb_threads, compress_chunks);
+
+	// write the chunks in order as they become available
+	bool write_failed = false;
+	for (hsize_t chunk_id = 0; chunk_id < total_chunks; ++chunk_id) {
+		vector<unsigned char> compressed;
+		{
+			unique_lock<mutex> lock(chunks_mutex);
+			chunk_ready.wait(lock, [&]() { return failed || chunks[chunk_id].ready; });
+			if (failed) break;
+			compressed = std::move(chunks[chunk_id].data);
+		}
+		vector<hsize_t> offset = chunk_position(chunk_id);
+		for (int dim = 0; dim < rank; ++dim) {
+			offset[dim] += start[dim];
+		}
+		herr_t status = H5Dwrite_chunk(h5_set, H5P_DEFAULT, 0, &offset[0], compressed.size(), compressed.data());
+		unique_lock<mutex> lock(chunks_mutex);
+		if (0 > status) {
+			failed = true;
+			write_failed = true;
+		} else {
+			++written_chunks;
+		}
+		chunk_written.notify_all();
+		if (failed) break;
+	}
+	pool.wait();
+	if (write_failed) handle_hdf5_err("Cannot write compressed chunk");
+	if (failed) throw System_error{"Cannot compress chunk with zlib"};
+	return true;
+}
+
+} // namespace decl_hdf5
@@ -0,0 +1,144 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef DECL_HDF5_DIRECT_CHUNK_WRITE_H_
+#define DECL_HDF5_DIRECT_CHUNK_WRITE_H_
+
+#include <hdf5.h>
+#ifdef H5_HAVE_PARALLEL
+#include <mpi.h>
+#endif
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <pdi/pdi_fwd.h>
+
+namespace decl_hdf5 {
+
+/** A pool of threads kept alive between writes to run the chunk compression
+ *
+ * The threads are created on the first job that requires them and stopped when
+ * the pool is destroyed.
+ * Only one job runs at a time, start() waits for the previous one to finish.
+ */
+class Thread_pool
+{
+	/// serializes the jobs
+	std::mutex m_job_mutex;
+
+	/// protects the state of the current job
+	std::mutex m_mutex;
+
+	/// notified when a job is posted or the pool stops
+	std::condition_variable m_job_posted;
+
+	/// notified when a thread finishes the current job
+	std::condition_variable m_job_done;
+
+	/// the threads of the pool
+	std::vector<std::thread> m_workers;
+
+	/// the current job
+	std::function<void()> m_job;
+
+	/// identifier of the current job, incremented for each new job
+	size_t m_job_id = 0;
+
+	/// number of threads running the current job (the first ones of the pool)
+	size_t m_job_threads = 0;
+
+	/// number of threads that have not yet finished the current job
+	size_t m_running = 0;
+
+	/// whether the pool is being destroyed
+	bool m_stopping = false;
+
+	/// lock on m_job_mutex held between start() and wait()
+	std::unique_lock<std::mutex> m_job_lock;
+
+	/** The loop of a thread of the pool
+	 *
+	 * \param thread_id the index of the thread in the pool
+	 */
+	void work(size_t thread_id);
+
+public:
+	Thread_pool() = default;
+
+	Thread_pool(const Thread_pool&) = delete;
+
+	Thread_pool& operator= (const Thread_pool&) = delete;
+
+	/// Stops and joins the threads
+	~Thread_pool();
+
+	/** Starts a job on some threads of the pool, creating them if needed
+	 *
+	 * \param nb_threads the number of threads that run the job
+	 * \param job the job, run once by each of these threads
+	 */
+	void start(size_t nb_threads, std::function<void()> job);
+
+	/// Waits for all the threads running the current job to finish it
+	void wait();
+};
+
+/** Writes a selection of a deflate compressed dataset by compressing its chunks
+ * in parallel and writing them with H5Dwrite_chunk.
+ *
+ * This is only possible if the dataset filters are limited to shuffle and
+ * deflate, if no type conversion is required and if the dataset selection is a
+ * single block aligned on chunks (except at the end of the dataset).
+ * The written file is the same as the one HDF5 would have produced and can be
+ * read by any HDF5 reader.
+ *
+ * \param ctx the context in which to operate
+ * \param h5_set the dataset to write
+ * \param h5_mem_type the type of the data in memory
+ * \param h5_mem_space the memory dataspace with the memory selection applied
+ * \param h5_file_space the dataset dataspace with the dataset selection applied
+ * \param data the data to write
+ * \param nb_threads the number of threads to use for compression
+ * \param pool the threads compressing the chunks
+ * \return whether the data was written, if false, nothing was done and the
+ *         data must be written with H5Dwrite
+ */
+bool direct_chunk_write(
+	PDI::Context& ctx,
+	hid_t h5_set,
+	hid_t h5_mem_type,
+	hid_t h5_mem_space,
+	hid_t h5_file_space,
+	const void* data,
+	size_t nb_threads,
+	Thread_pool& pool
+);
+
+} // namespace decl_hdf5
+
+#endif // DECL_HDF5_DIRECT_CHUNK_WRITE_H_
@@ -46,12 +46,14 @@ using PDI::Context;
 using PDI::each;
 using PDI::Error;
 using PDI::Expression;
+using PDI::is_map;
 using PDI::opt_each;
 using PDI::Ref_r;
 using PDI::Ref_w;
 using PDI::System_error;
 using PDI::to_string;
 using std::function;
+using std::make_shared;
 using std::move;
 using std::string;
 using std::unique_ptr;
@@ -70,6 +72,9 @@ vector<File_op> File_op::parse(Context& ctx, PC_tree_t tree)
 	// pass 1: file-level optional values
 	Expression deflate;
 	Expression fletcher;
+	Expression shuffle;
+	Expression compression_threads;
+	Properties dataset_creation_properties;
 	Expression default_when = 1L;
 	each(tree, [&](PC_tree_t key_tree, PC_tree_t value) {
 		string key = to_string(key_tree);
@@ -87,6 +92,46 @@ vector<File_op> File_op::parse(Context& ctx, PC_tree_t tree)
 #else
 			throw Config_error {key_tree, "Used HDF5 is not parallel. Invalid communicator: `{}'", to_string(value)};
 #endif
+		} else if (key == "mpi_info") {
+#ifdef H5_HAVE_PARALLEL
+			template_op.m_mpi_info = Properties{Properties::MPI_INFO, value};
+#else
+			throw Config_error {key_tree, "Used HDF5 is not parallel. Invalid mpi_info"};
+#endif
+		} else if (key == "file_access_properties") {
+			template_op.m_file_access_properties = Properties{Properties::FILE_ACCESS, value};
+		} else if (key == "file_creation_properties") {
+			template_op.m_file_creation_properties = Properties{Properties::FILE_CREATION, value};
+		} else if (key == "dataset_creation_properties") {
+			dataset_creation_properties = Properties{Properties::DATASET_CREATION, value};
+		} else if (key == "staging") {
+			PC_tree_t mode_tree = value;
+			if (is_map(value)) {
+				mode_tree = PC_get(value, ".mode");
+				each(value, [&](PC_tree_t staging_key_tree, PC_tree_t staging_value) {
+					string staging_key = to_string(staging_key_tree);
+					if (staging_key == "mode") {
+						// already read
+					} else if (staging_key == "flush_on") {
+						opt_each(staging_value, [&](PC_tree_t event_tree) { template_op.m_flush_on.emplace_back(to_string(event_tree)); });
+					} else if (staging_key == "flush_every") {
+						template_op.m_flush_every = to_string(staging_value);
+					} else if (staging_key == "increment") {
+						template_op.m_staging_increment = to_string(staging_value);
+					} else {
+						throw Config_error{staging_key_tree, "Unknown key in HDF5 staging configuration: `{}'", staging_key};
+					}
+				});
+			}
+			string mode = to_string(mode_tree);
+			if (mode == "memory") {
+				if (!template_op.m_staging_increment) template_op.m_staging_increment = 1L << 20;
+				template_op.m_staged_file = make_shared<Staged_file>();
+			} else if (mode != "none") {
+				throw Config_error{mode_tree, "Invalid staging mode: `{}'. Expecting memory or none.", mode};
+			}
+		} else if (key == "checkpoint") {
+			template_op.m_checkpoint = make_shared<Checkpoint>(value);
 		} else if (key == "datasets") {
 			each(value, [&](PC_tree_t dset_name, PC_tree_t dset_type) {
 				template_op.m_datasets.emplace(to_string(dset_name), ctx.datatype(dset_type));
@@ -95,6 +140,10 @@ vector<File_op> File_op::parse(Context& ctx, PC_tree_t tree)
 			deflate = value;
 		} else if (key == "fletcher") {
 			fletcher = value;
+		} else if (key == "shuffle") {
+			shuffle = value;
+		} else if (key == "compression_threads") {
+			compression_threads = value;
 		} else if (key == "write") {
 			// will read in pass 2
 		} else if (key == "read") {
@@ -107,6 +156,18 @@ vector<File_op> File_op::parse(Context& ctx, PC_tree_t tree)
 	});
 
 
+	if (template_op.m_staged_file && template_op.m_checkpoint) {
+		throw Config_error{tree, "Checkpoint files can not be staged in memory"};
+	}
+#ifdef H5_HAVE_PARALLEL
+	if (template_op.m_staged_file && template_op.m_communicator) {
+		throw Config_error{tree, "Files staged in memory can not be accessed in parallel"};
+	}
+	if (template_op.m_checkpoint && template_op.m_communicator) {
+		throw Config_error{tree, "Checkpoint files can not be accessed in parallel"};
+	}
+#endif
+
 	// pass 2 read & writes
 
 	vector<Dataset_op> dset_ops;
@@ -148,6 +209,13 @@ vector<File_op> File_op::parse(Context& ctx, PC_tree_t tree)
 				if (fletcher) {
 					dset_ops.back().fletcher(ctx, fletcher.to_long(ctx));
 				}
+				if (shuffle) {
+					dset_ops.back().shuffle(ctx, shuffle.to_long(ctx));
+				}
+				if (compression_threads) {
+					dset_ops.back().compression_threads(ctx, compression_threads);
+				}
+				dset_ops.back().dataset_creation_properties(dataset_creation_properties);
 			} else {
 				attr_ops.emplace_back(Attribute_op::WRITE, tree, default_when);
 			}
@@ -167,12 +235,27 @@ vector<File_op> File_op::parse(Context& ctx, PC_tree_t tree)
 					if (fletcher) {
 						dset_ops.back().fletcher(ctx, fletcher.to_long(ctx));
 					}
+					if (shuffle) {
+						dset_ops.back().shuffle(ctx, shuffle.to_long(ctx));
+					}
+					if (compression_threads) {
+						dset_ops.back().compression_threads(ctx, compression_threads);
+					}
+					dset_ops.back().dataset_creation_properties(dataset_creation_properties);
 				});
 			}
 		});
 	}
 
 
+#ifndef DECL_HDF5_HAVE_ZLIB
+	for (auto&& one_dset_op: dset_ops) {
+		if (one_dset_op.compression_threads()) {
+			ctx.logger().warn("`compression_threads' ignored for `{}' dataset: the plugin was built without zlib", one_dset_op.value());
+		}
+	}
+#endif
+
 	// final pass to build the result
 
 	vector<File_op> result;
@@ -182,6 +265,12 @@ vector<File_op> File_op::parse(Context& ctx, PC_tree_t tree)
 			File_op one_op = template_op;
 #ifdef H5_HAVE_PARALLEL
 			if (one_dset_op.communicator()) {
+				if (template_op.m_staged_file) {
+					throw Config_error{tree, "Files staged in memory can not be accessed in parallel"};
+				}
+				if (template_op.m_checkpoint) {
+					throw Config_error{tree, "Checkpoint files can not be accessed in parallel"};
+				}
 				one_op.m_communicator = one_dset_op.communicator();
 			}
 #endif
@@ -223,9 +312,17 @@ File_op::File_op(const File_op& other)
 	,
 #ifdef H5_HAVE_PARALLEL
 	m_communicator{other.m_communicator}
+	, m_mpi_info{other.m_mpi_info}
 	,
 #endif
-	m_dset_ops{other.m_dset_ops}
+	m_file_access_properties{other.m_file_access_properties}
+	, m_file_creation_properties{other.m_file_creation_properties}
+	, m_staging_increment{other.m_staging_increment}
+	, m_flush_on{other.m_flush_on}
+	, m_flush_every{other.m_flush_every}
+	, m_staged_file{other.m_staged_file}
+	, m_checkpoint{other.m_checkpoint}
+	, m_dset_ops{other.m_dset_ops}
 	, m_attr_ops{other.m_attr_ops}
 	, m_dset_size_ops{other.m_dset_size_ops}
 {
@@ -279,6 +376,13 @@ void File_op::execute(Context& ctx)
 	if (dset_reads.empty() && dset_writes.empty() && attr_reads.empty() && attr_writes.empty() && m_dset_size_ops.empty()) return;
 	std::string filename = m_file.to_string(ctx);
 
+	// checkpoints are written to the local tier and read from the freshest valid tier
+	std::string checkpoint_name = filename;
+	bool checkpoint_write = m_checkpoint && (!dset_writes.empty() || !attr_writes.empty());
+	if (m_checkpoint) {
+		filename = checkpoint_write ? m_checkpoint->write_path(ctx, checkpoint_name) : m_checkpoint->read_path(ctx, checkpoint_name);
+	}
+
 	Raii_hid file_lst = make_raii_hid(H5Pcreate(H5P_FILE_ACCESS), H5Pclose);
 	bool use_mpio = false;
 #ifdef H5_HAVE_PARALLEL
@@ -287,60 +391,57 @@ void File_op::execute(Context& ctx)
 		comm = *(static_cast<const MPI_Comm*>(Ref_r{communicator().to_ref(ctx)}.get()));
 	}
 	if (comm != MPI_COMM_SELF) {
-		if (0 > H5Pset_fapl_mpio(file_lst, comm, MPI_INFO_NULL)) handle_hdf5_err();
+		MPI_Info info = m_mpi_info.mpi_info(ctx);
+		herr_t status = H5Pset_fapl_mpio(file_lst, comm, info);
+		if (info != MPI_INFO_NULL) MPI_Info_free(&info);
+		if (0 > status) handle_hdf5_err();
 		use_mpio = true;
 		ctx.logger().debug("Opening `{}' file in parallel mode", filename);
 	}
+	// the communicators used for replication are created once for all the datasets of the file
+	File_communicators file_comms{comm};
+	File_communicators* comms = &file_comms;
+#else
+	File_communicators* comms = nullptr;
 #endif
-
-	hid_t h5_file_raw = -1;
-	if ((!dset_writes.empty() || !attr_writes.empty()) && (!dset_reads.empty() || !attr_reads.empty())) {
-		ctx.logger().trace("Opening `{}' file to read and write", filename);
-		h5_file_raw = H5Fopen(m_file.to_string(ctx).c_str(), H5F_ACC_RDWR, file_lst);
-	} else if (!dset_writes.empty() || !attr_writes.empty()) {
-		ctx.logger().trace("Opening `{}' file to write", filename);
-		h5_file_raw = H5Fopen(m_file.to_string(ctx).c_str(), H5F_ACC_RDWR, file_lst);
-		if (0 > h5_file_raw) {
-			ctx.logger().trace("Cannot open `{}' file, creating new file", filename);
-			h5_file_raw = H5Fcreate(filename.c_str(), H5F_ACC_EXCL, H5P_DEFAULT, file_lst);
-		} else {
-			// File exists -> collision
-			function<void(const char*, const std::string&)> notify = [&](const char* message, const std::string& filename) {
-				ctx.logger().trace("File `{}' already exists: {}", filename, message);
-			};
-			if (m_collision_policy & Collision_policy::WARNING) {
-				notify = [&](const char* message, const std::string& filename) {
-					ctx.logger().warn("File `{}' already exists: {}", filename, message);
-				};
-			}
-
-			if (m_collision_policy & Collision_policy::SKIP) {
-				notify("Skipping", filename);
-				H5Fclose(h5_file_raw);
-				return;
-			} else if (m_collision_policy & Collision_policy::REPLACE) {
-				notify("Deleting old file and creating a new one", filename);
-				H5Fclose(h5_file_raw);
-				h5_file_raw = H5Fcreate(filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, file_lst);
-			} else if (m_collision_policy & Collision_policy::ERROR) {
-				H5Fclose(h5_file_raw);
-				throw System_error{"Filename collision `{}': File already exists", filename};
-			} else {
-				// m_collision_policy & Collision_policy::WRITE_INTO == 1
-				notify("Writing into existing file", filename);
-			}
+	m_file_access_properties.apply(ctx, file_lst);
+
+	bool read = !dset_reads.empty() || !attr_reads.empty();
+	bool write = !dset_writes.empty() || !attr_writes.empty();
+	Raii_hid h5_file_owner;
+	hid_t h5_file;
+	if (m_staged_file) {
+		if (!m_staged_file->m_filename.empty() && (m_staged_file->m_filename != filename || (write && !m_staged_file->m_writable))) {
+			// a file staged to read only is opened again to write
+			ctx.logger().debug("Closing `{}' file staged in memory", m_staged_file->m_filename);
+			m_staged_file->m_file = Raii_hid{};
+			m_staged_file->m_filename.clear();
 		}
+		if (m_staged_file->m_filename.empty()) {
+			// the file lives in memory and is written to its path on flush and close, only the changed pages are written
+			hsize_t increment = m_staging_increment.to_long(ctx);
+			if (0 > H5Pset_fapl_core(file_lst, increment, 1)) handle_hdf5_err();
+			if (0 > H5Pset_core_write_tracking(file_lst, 1, increment)) handle_hdf5_err();
+			ctx.logger().debug("Staging `{}' file in memory", filename);
+			Raii_hid h5_staged_file = open(ctx, filename, file_lst, read, write);
+			if (0 > h5_staged_file) return;
+			m_staged_file->m_file = move(h5_staged_file);
+			m_staged_file->m_filename = filename;
+			m_staged_file->m_writable = write;
+			m_staged_file->m_nb_executions = 0;
+		}
+		h5_file = m_staged_file->m_file;
 	} else {
-		ctx.logger().trace("Opening `{}' file to read", filename);
-		h5_file_raw = H5Fopen(filename.c_str(), H5F_ACC_RDONLY, file_lst);
+		h5_file_owner = open(ctx, filename, file_lst, read, write);
+		if (0 > h5_file_owner) return;
+		h5_file = h5_file_owner;
 	}
-	Raii_hid h5_file = make_raii_hid(h5_file_raw, H5Fclose, ("Cannot open `" + filename + "' file").c_str());
 
 	for (auto&& one_dset_op: dset_writes) {
-		one_dset_op.execute(ctx, h5_file, use_mpio, m_datasets);
+		one_dset_op.execute(ctx, h5_file, use_mpio, comms, m_datasets);
 	}
 	for (auto&& one_dset_op: dset_reads) {
-		one_dset_op.execute(ctx, h5_file, use_mpio, m_datasets);
+		one_dset_op.execute(ctx, h5_file, use_mpio, comms, m_datasets);
 	}
 	for (auto&& one_attr_op: attr_writes) {
 		one_attr_op.execute(ctx, h5_file);
@@ -374,7 +475,76 @@ void File_op::execute(Context& ctx)
 
 		ctx.logger().trace("Getting size of `{}' dataset finished", dataset_name);
 	}
+	if (m_staged_file) {
+		long flush_every = m_flush_every ? m_flush_every.to_long(ctx) : 0;
+		if (0 < flush_every && ++m_staged_file->m_nb_executions >= flush_every) {
+			flush(ctx);
+		}
+		ctx.logger().trace("All operations done in `{}'. Keeping the file in memory.", filename);
+		return;
+	}
 	ctx.logger().trace("All operations done in `{}'. Closing the file.", filename);
+	if (checkpoint_write) {
+		h5_file_owner = Raii_hid{};
+		m_checkpoint->written(ctx, checkpoint_name);
+	}
+}
+
+void File_op::flush(Context& ctx)
+{
+	if (!m_staged_file || m_staged_file->m_filename.empty() || !m_staged_file->m_writable) return;
+	ctx.logger().debug("Flushing `{}' file staged in memory", m_staged_file->m_filename);
+	if (0 > H5Fflush(m_staged_file->m_file, H5F_SCOPE_GLOBAL)) handle_hdf5_err(("Cannot flush `" + m_staged_file->m_filename + "' file").c_str());
+	m_staged_file->m_nb_executions = 0;
+}
+
+Raii_hid File_op::open(Context& ctx, const string& filename, hid_t file_lst, bool read, bool write)
+{
+	Raii_hid file_create_lst = make_raii_hid(H5Pcreate(H5P_FILE_CREATE), H5Pclose);
+	m_file_creation_properties.apply(ctx, file_create_lst);
+
+	hid_t h5_file_raw = -1;
+	if (!write) {
+		ctx.logger().trace("Opening `{}' file to read", filename);
+		h5_file_raw = H5Fopen(filename.c_str(), H5F_ACC_RDONLY, file_lst);
+	} else if (read) {
+		ctx.logger().trace("Opening `{}' file to read and write", filename);
+		h5_file_raw = H5Fopen(filename.c_str(), H5F_ACC_RDWR, file_lst);
+	} else {
+		ctx.logger().trace("Opening `{}' file to write", filename);
+		h5_file_raw = H5Fopen(filename.c_str(), H5F_ACC_RDWR, file_lst);
+		if (0 > h5_file_raw) {
+			ctx.logger().trace("Cannot open `{}' file, creating new file", filename);
+			h5_file_raw = H5Fcreate(filename.c_str(), H5F_ACC_EXCL, file_create_lst, file_lst);
+		} else {
+			// File exists -> collision
+			function<void(const char*, const std::string&)> notify = [&](const char* message, const std::string& filename) {
+				ctx.logger().trace("File `{}' already exists: {}", filename, message);
+			};
+			if (m_collision_policy & Collision_policy::WARNING) {
+				notify = [&](const char* message, const std::string& filename) {
+					ctx.logger().warn("File `{}' already exists: {}", filename, message);
+				};
+			}
+
+			if (m_collision_policy & Collision_policy::SKIP) {
+				notify("Skipping", filename);
+				H5Fclose(h5_file_raw);
+				return Raii_hid{-1, nullptr};
+			} else if (m_collision_policy & Collision_policy::REPLACE) {
+				notify("Deleting old file and creating a new one", filename);
+				H5Fclose(h5_file_raw);
+				h5_file_raw = H5Fcreate(filename.c_str(), H5F_ACC_TRUNC, file_create_lst, file_lst);
+			} else if (m_collision_policy & Collision_policy::ERROR) {
+				H5Fclose(h5_file_raw);
+				throw System_error{"Filename collision `{}': File already exists", filename};
+			} else {
+				// m_collision_policy & Collision_policy::WRITE_INTO == 1
+				notify("Writing into existing file", filename);
+			}
+		}
+	}
+	return make_raii_hid(h5_file_raw, H5Fclose, ("Cannot open `" + filename + "' file").c_str());
 }
 
 } // namespace decl_hdf5
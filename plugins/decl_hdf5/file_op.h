@@ -32,6 +32,7 @@
 #include <mpi.h>
 #endif
 
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -42,8 +43,11 @@
 #include <pdi/expression.h>
 
 #include "attribute_op.h"
+#include "checkpoint.h"
 #include "collision_policy.h"
 #include "dataset_op.h"
+#include "hdf5_wrapper.h"
+#include "properties.h"
 
 namespace decl_hdf5 {
 
@@ -52,6 +56,21 @@ namespace decl_hdf5 {
  */
 class File_op
 {
+	/// A file staged in memory between executions
+	struct Staged_file {
+		/// the name of the file, empty if no file is open
+		std::string m_filename;
+
+		/// the file, kept open between executions
+		Raii_hid m_file;
+
+		/// whether the file is open to write
+		bool m_writable = false;
+
+		/// number of executions since the file was opened or last flushed
+		long m_nb_executions = 0;
+	};
+
 	/// What to do when file already exists (default = OVERWRITE)
 	Collision_policy m_collision_policy;
 
@@ -64,8 +83,32 @@ class File_op
 #ifdef H5_HAVE_PARALLEL
 	/// a communicator for parallel HDF5 (null if no comm is specified)
 	PDI::Expression m_communicator;
+
+	/// MPI-IO hints used to open the file in parallel
+	Properties m_mpi_info;
 #endif
 
+	/// properties used to open the file
+	Properties m_file_access_properties;
+
+	/// properties used to create the file
+	Properties m_file_creation_properties;
+
+	/// the increment by which the memory of a file staged in memory grows (null if the file is not staged)
+	PDI::Expression m_staging_increment;
+
+	/// events that flush the file staged in memory to its path
+	std::vector<std::string> m_flush_on;
+
+	/// number of executions after which the file staged in memory is flushed to its path (never if null)
+	PDI::Expression m_flush_every;
+
+	/// the file staged in memory, shared between the copies of this operation (null if the file is not staged)
+	std::shared_ptr<Staged_file> m_staged_file;
+
+	/// the tiers where the file is written, shared between the copies of this operation (null if not a checkpoint)
+	std::shared_ptr<Checkpoint> m_checkpoint;
+
 	/// type of the datasets for which an explicit type is specified
 	std::unordered_map<std::string, PDI::Datatype_template_sptr> m_datasets;
 
@@ -78,6 +121,17 @@ class File_op
 	/// map of descriptors to datasets name to get their sizes
 	std::unordered_map<std::string, PDI::Expression> m_dset_size_ops;
 
+	/** Opens or creates the file, applying the collision policy
+	 *
+	 * \param ctx the context in which to operate
+	 * \param filename the name of the file
+	 * \param file_lst the file access properties
+	 * \param read whether the file is opened for reading
+	 * \param write whether the file is opened for writing
+	 * \return the opened file or a negative hid_t if the file is skipped
+	 */
+	Raii_hid open(PDI::Context& ctx, const std::string& filename, hid_t file_lst, bool read, bool write);
+
 public:
 	/** Parse a "file" subtree to create one or multiple File_op's.
 	 *
@@ -120,11 +174,21 @@ public:
 	PDI::Expression communicator() const { return m_communicator; }
 #endif
 
+	/** Events that flush the file staged in memory to its path
+	 */
+	const std::vector<std::string>& flush_on() const { return m_flush_on; }
+
 	/** Executes the requested operation.
 	 *
 	 * \param ctx the context in which to operate
 	 */
 	void execute(PDI::Context& ctx);
+
+	/** Writes the file staged in memory to its path, if any
+	 *
+	 * \param ctx the context in which to operate
+	 */
+	void flush(PDI::Context& ctx);
 };
 
 } // namespace decl_hdf5
@@ -27,6 +27,7 @@
 #include <mpi.h>
 #endif
 
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -50,6 +51,7 @@ using PDI::Type_error;
 using std::dynamic_pointer_cast;
 using std::make_tuple;
 using std::move;
+using std::recursive_mutex;
 using std::string;
 using std::tie;
 using std::tuple;
@@ -145,6 +147,12 @@ void handle_hdf5_err(const char* message)
 	throw System_error{"{} {}", message, h5_errmsg};
 }
 
+recursive_mutex& hdf5_mutex()
+{
+	static recursive_mutex mutex;
+	return mutex;
+}
+
 tuple<Raii_hid, Raii_hid> space(Datatype_sptr type, bool dense)
 {
 	//check if outer type is an array
@@ -32,6 +32,7 @@
 #endif
 
 #include <functional>
+#include <mutex>
 #include <tuple>
 #include <utility>
 
@@ -48,6 +49,15 @@ namespace decl_hdf5 {
  */
 [[noreturn]] void handle_hdf5_err(const char* message = NULL);
 
+/** The mutex that serializes the HDF5 calls of the plugin and of its
+ * background threads.
+ *
+ * It must be held by any thread calling HDF5 while another one might do so.
+ *
+ * \return the HDF5 mutex
+ */
+std::recursive_mutex& hdf5_mutex();
+
 /** A RAII-style HDF5 error handler.
  *
  * Creating an instance of this class removes any HDF5 error handler.
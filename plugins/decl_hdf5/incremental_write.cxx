@@ -0,0 +1,330 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include <hdf5.h>
+#ifdef H5_HAVE_PARALLEL
+#include <mpi.h>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <pdi/context.h>
+#include <pdi/error.h>
+
+#include "hdf5_wrapper.h"
+
+#include "incremental_write.h"
+
+using PDI::Context;
+using std::memcpy;
+using std::min;
+using std::string;
+using std::vector;
+
+namespace {
+
+using namespace decl_hdf5;
+
+/// The hash of a chunk that is not known to be up to date in the file
+constexpr uint64_t UNKNOWN_HASH = 0;
+
+constexpr uint64_t PRIME1 = 11400714785074694791ULL;
+constexpr uint64_t PRIME2 = 14029467366897019727ULL;
+constexpr uint64_t PRIME3 = 1609587929392839161ULL;
+constexpr uint64_t PRIME4 = 9650029242287828579ULL;
+constexpr uint64_t PRIME5 = 2870177450012600261ULL;
+
+uint64_t rotl(uint64_t value, int bits)
+{
+	return (value << bits) | (value >> (64 - bits));
+}
+
+uint64_t read64(const unsigned char* bytes)
+{
+	uint64_t value;
+	memcpy(&value, bytes, sizeof(value));
+	return value;
+}
+
+uint64_t hash_round(uint64_t acc, uint64_t input)
+{
+	return rotl(acc + input * PRIME2, 31) * PRIME1;
+}
+
+uint64_t hash_merge(uint64_t acc, uint64_t value)
+{
+	return (acc ^ hash_round(0, value)) * PRIME1 + PRIME4;
+}
+
+/** Hashes a buffer with the xxHash64 algorithm
+ *
+ * \param bytes the buffer to hash
+ * \param size the size of the buffer
+ * \return the hash of the buffer, never UNKNOWN_HASH
+ */
+uint64_t hash(const unsigned char* bytes, size_t size)
+{
+	const unsigned char* end = bytes + size;
+	uint64_t result;
+	if (size >= 32) {
+		uint64_t acc[4] = {PRIME1 + PRIME2, PRIME2, 0, -PRIME1};
+		for (; bytes + 32 <= end; bytes += 32) {
+			for (int lane = 0; lane < 4; ++lane) {
+				acc[lane] = hash_round(acc[lane], read64(bytes + 8 * lane));
+			}
+		}
+		result = rotl(acc[0], 1) + rotl(acc[1], 7) + rotl(acc[2], 12) + rotl(acc[3], 18);
+		for (int lane = 0; lane < 4; ++lane) {
+			result = hash_merge(result, acc[lane]);
+		}
+	} else {
+		result = PRIME5;
+	}
+	result += size;
+	for (; bytes + 8 <= end; bytes += 8) {
+		result = rotl(result ^ hash_round(0, read64(bytes)), 27) * PRIME1 + PRIME4;
+	}
+	if (bytes + 4 <= end) {
+		uint32_t value;
+		memcpy(&value, bytes, sizeof(value));
+		result = rotl(result ^ (value * PRIME1), 23) * PRIME2 + PRIME3;
+		bytes += 4;
+	}
+	for (; bytes < end; ++bytes) {
+		result = rotl(result ^ (*bytes * PRIME5), 11) * PRIME1;
+	}
+	result ^= result >> 33;
+	result *= PRIME2;
+	result ^= result >> 29;
+	result *= PRIME3;
+	result ^= result >> 32;
+	return result == UNKNOWN_HASH ? 1 : result;
+}
+
+/** Names the sidecar dataset storing the chunk hashes of a dataset
+ *
+ * \param dataset_name the name of the dataset
+ * \return the name of the chunk hashes dataset
+ */
+string hashes_name(const string& dataset_name)
+{
+	return dataset_name + "_chunk_hashes";
+}
+
+} // namespace
+
+namespace decl_hdf5 {
+
+bool incremental_write(
+	Context& ctx,
+	hid_t h5_file,
+	const string& dataset_name,
+	hid_t h5_set,
+	bool created,
+	hid_t h5_mem_type,
+	hid_t h5_mem_space,
+	hid_t h5_file_space,
+	hid_t write_lst,
+	const void* data
+)
+{
+	Raii_hid dset_plist = make_raii_hid(H5Dget_create_plist(h5_set), H5Pclose);
+	if (H5Pget_layout(dset_plist) != H5D_CHUNKED) return false;
+	size_t element_size = H5Tget_size(h5_mem_type);
+	if (0 == element_size) handle_hdf5_err();
+
+	// the selection must be a single block aligned on chunks
+	int rank = H5Sget_simple_extent_ndims(h5_file_space);
+	if (0 >= rank) return false;
+	vector<hsize_t> dims(rank);
+	if (0 > H5Sget_simple_extent_dims(h5_file_space, &dims[0], NULL)) handle_hdf5_err();
+	vector<hsize_t> chunk(rank);
+	if (rank != H5Pget_chunk(dset_plist, rank, &chunk[0])) handle_hdf5_err();
+	hssize_t nb_points = H5Sget_select_npoints(h5_file_space);
+	if (0 >= nb_points) return false;
+	vector<hsize_t> start(rank);
+	vector<hsize_t> extent(rank);
+	if (0 > H5Sget_select_bounds(h5_file_space, &start[0], &extent[0])) handle_hdf5_err();
+	hsize_t block_points = 1;
+	for (int dim = 0; dim < rank; ++dim) {
+		extent[dim] = extent[dim] - start[dim] + 1;
+		block_points *= extent[dim];
+		if (start[dim] % chunk[dim]) return false;
+		hsize_t end = start[dim] + extent[dim];
+		if (end % chunk[dim] && end != dims[dim]) return false;
+	}
+	if (block_points != static_cast<hsize_t>(nb_points)) return false;
+
+	// get the selected data as a dense block
+	const unsigned char* block = static_cast<const unsigned char*>(data);
+	vector<unsigned char> gathered;
+	hssize_t mem_extent_points = H5Sget_simple_extent_npoints(h5_mem_space);
+	if (0 > mem_extent_points) handle_hdf5_err();
+	if (mem_extent_points != nb_points) {
+		ctx.logger().trace("Gathering sparse memory selection before hashing");
+		gathered.resize(nb_points * element_size);
+		if (0 > H5Dgather(h5_mem_space, data, h5_mem_type, gathered.size(), gathered.data(), NULL, NULL)) handle_hdf5_err();
+		block = gathered.data();
+	}
+
+	// strides (in elements) of the block, and number of chunks in the block and in the whole dataset
+	vector<hsize_t> nb_chunks(rank);
+	vector<hsize_t> block_stride(rank);
+	vector<hsize_t> grid_stride(rank);
+	hsize_t total_chunks = 1;
+	hsize_t total_grid = 1;
+	for (int dim = rank - 1; dim >= 0; --dim) {
+		nb_chunks[dim] = (extent[dim] + chunk[dim] - 1) / chunk[dim];
+		total_chunks *= nb_chunks[dim];
+		block_stride[dim] = (dim == rank - 1) ? 1 : block_stride[dim + 1] * extent[dim + 1];
+		grid_stride[dim] = total_grid;
+		total_grid *= (dims[dim] + chunk[dim] - 1) / chunk[dim];
+	}
+
+	// load the hashes stored with the dataset, dropping them if the dataset extent changed
+	string hashes_dataset_name = hashes_name(dataset_name);
+	vector<uint64_t> hashes(total_grid, UNKNOWN_HASH);
+	Raii_hid h5_hashes;
+	htri_t hashes_exist = H5Lexists(h5_file, hashes_dataset_name.c_str(), H5P_DEFAULT);
+	if (0 > hashes_exist) handle_hdf5_err();
+	if (hashes_exist) {
+		h5_hashes = make_raii_hid(H5Dopen2(h5_file, hashes_dataset_name.c_str(), H5P_DEFAULT), H5Dclose);
+		Raii_hid h5_hashes_space = make_raii_hid(H5Dget_space(h5_hashes), H5Sclose);
+		hssize_t nb_hashes = H5Sget_simple_extent_npoints(h5_hashes_space);
+		if (0 > nb_hashes) handle_hdf5_err();
+		if (static_cast<hsize_t>(nb_hashes) != total_grid) {
+			ctx.logger().debug("Dropping chunk hashes of `{}': dataset extent changed", dataset_name);
+			h5_hashes = Raii_hid{};
+			if (0 > H5Ldelete(h5_file, hashes_dataset_name.c_str(), H5P_DEFAULT)) handle_hdf5_err();
+			hashes_exist = false;
+		} else if (!created) {
+			if (0 > H5Dread(h5_hashes, H5T_NATIVE_UINT64, H5S_ALL, H5S_ALL, H5P_DEFAULT, hashes.data())) handle_hdf5_err();
+		}
+	}
+	if (!hashes_exist) {
+		Raii_hid h5_hashes_space = make_raii_hid(H5Screate_simple(1, &total_grid, NULL), H5Sclose);
+		h5_hashes = make_raii_hid(
+			H5Dcreate2(h5_file, hashes_dataset_name.c_str(), H5T_STD_U64LE, h5_hashes_space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT),
+			H5Dclose
+		);
+	}
+
+	// position of a chunk in the block from its linear index
+	auto chunk_position = [&](hsize_t chunk_id) {
+		vector<hsize_t> position(rank);
+		for (int dim = rank - 1; dim >= 0; --dim) {
+			position[dim] = (chunk_id % nb_chunks[dim]) * chunk[dim];
+			chunk_id /= nb_chunks[dim];
+		}
+		return position;
+	};
+
+	// copies the chunk rows from the block to a dense buffer, returns the chunk shape
+	vector<unsigned char> raw;
+	auto copy_chunk = [&](const vector<hsize_t>& position) {
+		vector<hsize_t> valid(rank);
+		hsize_t valid_points = 1;
+		for (int dim = 0; dim < rank; ++dim) {
+			valid[dim] = min(chunk[dim], extent[dim] - position[dim]);
+			valid_points *= valid[dim];
+		}
+		raw.resize(valid_points * element_size);
+		size_t row_bytes = valid[rank - 1] * element_size;
+		vector<hsize_t> row(rank, 0);
+		for (unsigned char* to = raw.data();; to += row_bytes) {
+			hsize_t from = 0;
+			for (int dim = 0; dim < rank; ++dim) {
+				from += (position[dim] + row[dim]) * block_stride[dim];
+			}
+			memcpy(to, block + from * element_size, row_bytes);
+			int dim = rank - 2;
+			while (dim >= 0 && ++row[dim] == valid[dim]) {
+				row[dim] = 0;
+				--dim;
+			}
+			if (dim < 0) break;
+		}
+		return valid;
+	};
+
+	// index of a chunk in the whole dataset
+	auto grid_index = [&](const vector<hsize_t>& position) {
+		hsize_t index = 0;
+		for (int dim = 0; dim < rank; ++dim) {
+			index += (start[dim] + position[dim]) / chunk[dim] * grid_stride[dim];
+		}
+		return index;
+	};
+
+	// hash all chunks and list the modified ones
+	vector<hsize_t> modified;
+	vector<uint64_t> new_hashes;
+	for (hsize_t chunk_id = 0; chunk_id < total_chunks; ++chunk_id) {
+		vector<hsize_t> position = chunk_position(chunk_id);
+		copy_chunk(position);
+		uint64_t chunk_hash = hash(raw.data(), raw.size());
+		hsize_t index = grid_index(position);
+		if (hashes[index] != chunk_hash) {
+			modified.emplace_back(chunk_id);
+			new_hashes.emplace_back(chunk_hash);
+			hashes[index] = UNKNOWN_HASH;
+		}
+	}
+	ctx.logger().debug("Writing {} modified chunks out of {} in `{}'", modified.size(), total_chunks, dataset_name);
+	if (modified.empty()) return true;
+
+	// invalidate the hashes of the modified chunks until they are written
+	if (0 > H5Dwrite(h5_hashes, H5T_NATIVE_UINT64, H5S_ALL, H5S_ALL, H5P_DEFAULT, hashes.data())) handle_hdf5_err();
+
+	Raii_hid h5_chunk_space = make_raii_hid(H5Scopy(h5_file_space), H5Sclose);
+	for (size_t modified_id = 0; modified_id < modified.size(); ++modified_id) {
+		vector<hsize_t> position = chunk_position(modified[modified_id]);
+		vector<hsize_t> valid = copy_chunk(position);
+		Raii_hid h5_raw_space = make_raii_hid(H5Screate_simple(rank, &valid[0], NULL), H5Sclose);
+		vector<hsize_t> offset(rank);
+		for (int dim = 0; dim < rank; ++dim) {
+			offset[dim] = start[dim] + position[dim];
+		}
+		if (0 > H5Sselect_hyperslab(h5_chunk_space, H5S_SELECT_SET, &offset[0], NULL, &valid[0], NULL)) handle_hdf5_err();
+		if (0 > H5Dwrite(h5_set, h5_mem_type, h5_raw_space, h5_chunk_space, write_lst, raw.data())) handle_hdf5_err();
+		hashes[grid_index(position)] = new_hashes[modified_id];
+	}
+
+	if (0 > H5Dwrite(h5_hashes, H5T_NATIVE_UINT64, H5S_ALL, H5S_ALL, H5P_DEFAULT, hashes.data())) handle_hdf5_err();
+	return true;
+}
+
+void drop_chunk_hashes(hid_t h5_file, const string& dataset_name)
+{
+	string hashes_dataset_name = hashes_name(dataset_name);
+	htri_t hashes_exist = H5Lexists(h5_file, hashes_dataset_name.c_str(), H5P_DEFAULT);
+	if (0 > hashes_exist) handle_hdf5_err();
+	if (hashes_exist && 0 > H5Ldelete(h5_file, hashes_dataset_name.c_str(), H5P_DEFAULT)) handle_hdf5_err();
+}
+
+} // namespace decl_hdf5
@@ -0,0 +1,87 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef DECL_HDF5_INCREMENTAL_WRITE_H_
+#define DECL_HDF5_INCREMENTAL_WRITE_H_
+
+#include <hdf5.h>
+#ifdef H5_HAVE_PARALLEL
+#include <mpi.h>
+#endif
+
+#include <string>
+
+#include <pdi/pdi_fwd.h>
+
+namespace decl_hdf5 {
+
+/** Writes the chunks of a dataset selection that changed since the last write.
+ *
+ * Each chunk of the selection is hashed and its hash compared to the one
+ * stored for this chunk in the `<dataset>_chunk_hashes` sidecar dataset, only
+ * the chunks whose hash differ are written.
+ * The hashes of the written chunks are invalidated before the chunks are
+ * written and updated afterwards, so that an interrupted write never leaves a
+ * chunk that is considered up to date while it is not.
+ *
+ * This is only possible if the dataset is chunked and if the dataset selection
+ * is a single block aligned on chunks (except at the end of the dataset).
+ *
+ * \param ctx the context in which to operate
+ * \param h5_file the file containing the dataset
+ * \param dataset_name the name of the dataset
+ * \param h5_set the dataset to write
+ * \param created whether the dataset has just been created, i.e. no chunk is up to date
+ * \param h5_mem_type the type of the data in memory
+ * \param h5_mem_space the memory dataspace with the memory selection applied
+ * \param h5_file_space the dataset dataspace with the dataset selection applied
+ * \param write_lst the transfer properties used to write the chunks
+ * \param data the data to write
+ * \return whether the data was written, if false, nothing was done and the
+ *         data must be written with H5Dwrite
+ */
+bool incremental_write(
+	PDI::Context& ctx,
+	hid_t h5_file,
+	const std::string& dataset_name,
+	hid_t h5_set,
+	bool created,
+	hid_t h5_mem_type,
+	hid_t h5_mem_space,
+	hid_t h5_file_space,
+	hid_t write_lst,
+	const void* data
+);
+
+/** Removes the chunk hashes of a dataset, to be called when the dataset is
+ * written without incremental_write
+ *
+ * \param h5_file the file containing the dataset
+ * \param dataset_name the name of the dataset
+ */
+void drop_chunk_hashes(hid_t h5_file, const std::string& dataset_name);
+
+} // namespace decl_hdf5
+
+#endif // DECL_HDF5_INCREMENTAL_WRITE_H_
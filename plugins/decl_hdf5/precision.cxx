@@ -0,0 +1,236 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include <hdf5.h>
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#include <spdlog/spdlog.h>
+
+#include <pdi/context.h>
+#include <pdi/datatype.h>
+#include <pdi/error.h>
+#include <pdi/paraconf_wrapper.h>
+
+#include "precision.h"
+
+using PDI::Config_error;
+using PDI::Context;
+using PDI::Datatype;
+using PDI::each;
+using PDI::Expression;
+using PDI::to_string;
+using PDI::Type_error;
+using PDI::Value_error;
+using std::memcpy;
+using std::numeric_limits;
+using std::string;
+using std::vector;
+
+namespace {
+
+/** Gets an option from the attribute of a dataset type or from the operation
+ *
+ * \param dataset_type the PDI type of the dataset
+ * \param attribute the name of the attribute overriding the option
+ * \param value the option set on the operation
+ * \return the attribute if defined, the operation option otherwise
+ */
+Expression option(const Datatype* dataset_type, const char* attribute, const Expression& value)
+{
+	try {
+		return dataset_type->attribute(attribute);
+	} catch (const Type_error& e) {
+		return value;
+	}
+}
+
+/** Rounds the mantissa of IEEE 754 floating point values to a number of bits,
+ * keeping NaNs and infinities as is.
+ *
+ * The loop is branchless so that it is vectorized by the compiler.
+ *
+ * \tparam Bits the unsigned integer type of the size of the values
+ * \tparam MANTISSA_BITS the number of explicit mantissa bits of the values
+ * \tparam NEAREST whether to round to nearest (ties to even) rather than truncate
+ * \param values the bits of the values to round in place
+ * \param size the number of values
+ * \param keepbits the number of mantissa bits to keep, less than MANTISSA_BITS
+ */
+template <class Bits, int MANTISSA_BITS, bool NEAREST>
+void round_mantissa(Bits* values, size_t size, int keepbits)
+{
+	const int shift = MANTISSA_BITS - keepbits;
+	const Bits mask = ~((Bits{1} << shift) - 1);
+	const Bits half_ulp = (Bits{1} << (shift - 1)) - 1;
+	const Bits abs_mask = numeric_limits<Bits>::max() >> 1;
+	const Bits exponent_mask = abs_mask & ~((Bits{1} << MANTISSA_BITS) - 1);
+	for (size_t idx = 0; idx < size; ++idx) {
+		Bits value = values[idx];
+		Bits rounded = (NEAREST ? value + half_ulp + ((value >> shift) & 1) : value) & mask;
+		values[idx] = ((value & abs_mask) >= exponent_mask) ? value : rounded;
+	}
+}
+
+/** Rounds the mantissa of floating point values to a number of bits
+ *
+ * \tparam Float the type of the values
+ * \tparam Bits the unsigned integer type of the size of the values
+ * \param values the values to round in place
+ * \param size the number of values
+ * \param keepbits the number of mantissa bits to keep, less than that of Float
+ * \param nearest whether to round to nearest rather than truncate
+ */
+template <class Float, class Bits>
+void round_mantissa(void* values, size_t size, int keepbits, bool nearest)
+{
+	static_assert(sizeof(Float) == sizeof(Bits), "Bits must have the size of Float");
+	constexpr int MANTISSA_BITS = numeric_limits<Float>::digits - 1;
+	if (nearest) {
+		round_mantissa<Bits, MANTISSA_BITS, true>(static_cast<Bits*>(values), size, keepbits);
+	} else {
+		round_mantissa<Bits, MANTISSA_BITS, false>(static_cast<Bits*>(values), size, keepbits);
+	}
+}
+
+} // namespace
+
+namespace decl_hdf5 {
+
+Precision::Precision(PC_tree_t tree)
+{
+	each(tree, [&](PC_tree_t key_tree, PC_tree_t value) {
+		string key = to_string(key_tree);
+		if (key == "keepbits") {
+			m_keepbits = to_string(value);
+		} else if (key == "rounding") {
+			m_rounding = to_string(value);
+		} else if (key == "scaleoffset") {
+			m_scaleoffset = to_string(value);
+		} else if (key == "nbit") {
+			m_nbit = to_string(value);
+		} else {
+			throw Config_error{key_tree, "Invalid configuration key in precision: `{}'", key};
+		}
+	});
+}
+
+void Precision::reduce_type(Context& ctx, const Datatype* dataset_type, Raii_hid& h5_file_type) const
+{
+	Expression nbit = option(dataset_type, "decl_hdf5.nbit", m_nbit);
+	if (!nbit) return;
+	long bits = nbit.to_long(ctx);
+	if (H5T_INTEGER != H5Tget_class(h5_file_type)) {
+		throw Value_error{"N-bit filter only applies to integer datasets"};
+	}
+	size_t precision = H5Tget_precision(h5_file_type);
+	if (0 == precision) handle_hdf5_err();
+	if (bits <= 0 || static_cast<size_t>(bits) > precision) {
+		throw Value_error{"Invalid nbit: {} bits stored for a {} bits integer", bits, precision};
+	}
+	Raii_hid h5_reduced_type = make_raii_hid(H5Tcopy(h5_file_type), H5Tclose);
+	if (0 > H5Tset_precision(h5_reduced_type, bits)) handle_hdf5_err();
+	h5_file_type = std::move(h5_reduced_type);
+}
+
+bool Precision::set_filters(Context& ctx, const Datatype* dataset_type, const string& dataset_name, hid_t dset_plist, hid_t h5_file_type) const
+{
+	bool filtered = false;
+
+	Expression scaleoffset = option(dataset_type, "decl_hdf5.scaleoffset", m_scaleoffset);
+	if (scaleoffset) {
+		long factor = scaleoffset.to_long(ctx);
+		H5T_class_t type_class = H5Tget_class(h5_file_type);
+		if (H5T_FLOAT == type_class) {
+			ctx.logger().trace("Setting `{}' dataset scale-offset to {} decimal digits", dataset_name, factor);
+			if (0 > H5Pset_scaleoffset(dset_plist, H5Z_SO_FLOAT_DSCALE, factor)) {
+				handle_hdf5_err(fmt::format("Cannot set `{}' dataset scale-offset", dataset_name).c_str());
+			}
+		} else if (H5T_INTEGER == type_class) {
+			ctx.logger().trace("Setting `{}' dataset scale-offset to {} minimum bits", dataset_name, factor);
+			if (0 > H5Pset_scaleoffset(dset_plist, H5Z_SO_INT, factor ? factor : H5Z_SO_INT_MINBITS_DEFAULT)) {
+				handle_hdf5_err(fmt::format("Cannot set `{}' dataset scale-offset", dataset_name).c_str());
+			}
+		} else {
+			throw Value_error{"Scale-offset filter only applies to integer and floating point datasets"};
+		}
+		filtered = true;
+	}
+
+	if (option(dataset_type, "decl_hdf5.nbit", m_nbit)) {
+		ctx.logger().trace("Setting `{}' dataset N-bit filter", dataset_name);
+		if (0 > H5Pset_nbit(dset_plist)) {
+			handle_hdf5_err(fmt::format("Cannot set `{}' dataset N-bit filter", dataset_name).c_str());
+		}
+		filtered = true;
+	}
+
+	return filtered;
+}
+
+const void* Precision::round(Context& ctx, const Datatype* dataset_type, hid_t h5_mem_type, hid_t h5_mem_space, const void* data)
+{
+	Expression keepbits_expr = option(dataset_type, "decl_hdf5.keepbits", m_keepbits);
+	if (!keepbits_expr) return data;
+	long keepbits = keepbits_expr.to_long(ctx);
+	if (keepbits < 0) {
+		throw Value_error{"Invalid keepbits: {} mantissa bits kept", keepbits};
+	}
+
+	Expression rounding_expr = option(dataset_type, "decl_hdf5.rounding", m_rounding);
+	string rounding = rounding_expr ? rounding_expr.to_string(ctx) : "nearest";
+	if (rounding != "nearest" && rounding != "truncate") {
+		throw Value_error{"Invalid rounding: `{}', expected `nearest' or `truncate'", rounding};
+	}
+
+	htri_t is_float = H5Tequal(h5_mem_type, H5T_NATIVE_FLOAT);
+	if (0 > is_float) handle_hdf5_err();
+	htri_t is_double = H5Tequal(h5_mem_type, H5T_NATIVE_DOUBLE);
+	if (0 > is_double) handle_hdf5_err();
+	if (!is_float && !is_double) {
+		throw Value_error{"Bit-rounding only applies to float and double data"};
+	}
+	int mantissa_bits = is_float ? numeric_limits<float>::digits - 1 : numeric_limits<double>::digits - 1;
+	if (keepbits >= mantissa_bits) return data;
+
+	hssize_t size = H5Sget_simple_extent_npoints(h5_mem_space);
+	if (0 > size) handle_hdf5_err();
+	size_t nbytes = size * H5Tget_size(h5_mem_type);
+	if (m_buffer->size() < nbytes) {
+		m_buffer->resize(nbytes);
+	}
+	memcpy(m_buffer->data(), data, nbytes);
+	ctx.logger().trace("Rounding {} values to {} mantissa bits ({})", size, keepbits, rounding);
+	if (is_float) {
+		round_mantissa<float, uint32_t>(m_buffer->data(), size, keepbits, rounding == "nearest");
+	} else {
+		round_mantissa<double, uint64_t>(m_buffer->data(), size, keepbits, rounding == "nearest");
+	}
+	return m_buffer->data();
+}
+
+} // namespace decl_hdf5
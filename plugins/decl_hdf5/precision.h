@@ -0,0 +1,122 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef DECL_HDF5_PRECISION_H_
+#define DECL_HDF5_PRECISION_H_
+
+#include <hdf5.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <paraconf.h>
+
+#include <pdi/pdi_fwd.h>
+#include <pdi/expression.h>
+
+#include "hdf5_wrapper.h"
+
+namespace decl_hdf5 {
+
+/** A Precision describes the lossy precision reduction applied to a dataset on
+ * write.
+ *
+ * It combines:
+ * - a bit-rounding stage that rounds (or truncates) the mantissa of floating
+ *   point values to a number of bits in a copy of the data before it is
+ *   written, the zeroed low bits making the following deflate far more
+ *   efficient,
+ * - the HDF5 scale-offset filter,
+ * - the HDF5 N-bit filter with a reduced precision of integer datasets.
+ *
+ * Each option can be overriden by the `decl_hdf5.<option>` attribute of the
+ * dataset type.
+ */
+class Precision
+{
+	/// number of mantissa bits kept by the bit-rounding stage
+	PDI::Expression m_keepbits;
+
+	/// `nearest` to round the mantissa, `truncate` to truncate it
+	PDI::Expression m_rounding;
+
+	/// scale factor of the scale-offset filter
+	PDI::Expression m_scaleoffset;
+
+	/// number of bits stored by the N-bit filter
+	PDI::Expression m_nbit;
+
+	/// the rounded values, shared between the copies of this operation to avoid reallocating
+	std::shared_ptr<std::vector<unsigned char>> m_buffer = std::make_shared<std::vector<unsigned char>>();
+
+public:
+	/** Builds an empty Precision, that keeps the data as is
+	 */
+	Precision() = default;
+
+	/** Builds a Precision from its yaml config
+	 *
+	 * \param tree the yaml `precision' map
+	 */
+	Precision(PC_tree_t tree);
+
+	/** Reduces the precision of the type of a dataset stored with the N-bit
+	 * filter
+	 *
+	 * \param ctx the context in which to operate
+	 * \param dataset_type the PDI type of the dataset, whose attributes override the options
+	 * \param h5_file_type the HDF5 type of the dataset, replaced if its precision is reduced
+	 */
+	void reduce_type(PDI::Context& ctx, const PDI::Datatype* dataset_type, Raii_hid& h5_file_type) const;
+
+	/** Adds the scale-offset and N-bit filters to a dataset creation property
+	 * list
+	 *
+	 * \param ctx the context in which to operate
+	 * \param dataset_type the PDI type of the dataset, whose attributes override the options
+	 * \param dataset_name the name of the dataset
+	 * \param dset_plist the dataset creation property list
+	 * \param h5_file_type the HDF5 type of the dataset
+	 * \return whether a filter was added
+	 */
+	bool set_filters(PDI::Context& ctx, const PDI::Datatype* dataset_type, const std::string& dataset_name, hid_t dset_plist, hid_t h5_file_type)
+		const;
+
+	/** Rounds the mantissa of floating point values before they are written
+	 *
+	 * \param ctx the context in which to operate
+	 * \param dataset_type the PDI type of the dataset, whose attributes override the options
+	 * \param h5_mem_type the type of the values in memory
+	 * \param h5_mem_space the memory dataspace, whose extent covers the whole data
+	 * \param data the values in memory
+	 * \return the rounded values, with the same layout as data, or data itself
+	 *         if no rounding applies
+	 */
+	const void* round(PDI::Context& ctx, const PDI::Datatype* dataset_type, hid_t h5_mem_type, hid_t h5_mem_space, const void* data);
+};
+
+} // namespace decl_hdf5
+
+#endif // DECL_HDF5_PRECISION_H_
@@ -0,0 +1,225 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include <hdf5.h>
+#ifdef H5_HAVE_PARALLEL
+#include <mpi.h>
+#endif
+
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "hdf5_wrapper.h"
+
+#include "prefetcher.h"
+
+using std::exception;
+using std::lock_guard;
+using std::memcpy;
+using std::move;
+using std::mutex;
+using std::recursive_mutex;
+using std::string;
+using std::thread;
+using std::unique_lock;
+using std::vector;
+
+namespace {
+
+/** Checks whether two dataspaces have the same extent and the same selection
+ *
+ * \param h5_space1 the first dataspace
+ * \param h5_space2 the second dataspace
+ * \return whether the dataspaces have the same extent and the same selection
+ */
+bool same_selection(hid_t h5_space1, hid_t h5_space2)
+{
+	htri_t same_extent = H5Sextent_equal(h5_space1, h5_space2);
+	if (0 > same_extent) decl_hdf5::handle_hdf5_err();
+	if (!same_extent) return false;
+
+	hssize_t nb_points = H5Sget_select_npoints(h5_space1);
+	if (0 > nb_points) decl_hdf5::handle_hdf5_err();
+	if (nb_points != H5Sget_select_npoints(h5_space2)) return false;
+	if (0 == nb_points) return true;
+
+	int rank = H5Sget_simple_extent_ndims(h5_space1);
+	if (0 > rank) decl_hdf5::handle_hdf5_err();
+	if (0 == rank) return true;
+
+	// same bounds and same shape means the same selection
+	vector<hsize_t> start1(rank), end1(rank), start2(rank), end2(rank);
+	if (0 > H5Sget_select_bounds(h5_space1, &start1[0], &end1[0])) decl_hdf5::handle_hdf5_err();
+	if (0 > H5Sget_select_bounds(h5_space2, &start2[0], &end2[0])) decl_hdf5::handle_hdf5_err();
+	if (start1 != start2 || end1 != end2) return false;
+	htri_t same_shape = H5Sselect_shape_same(h5_space1, h5_space2);
+	if (0 > same_shape) decl_hdf5::handle_hdf5_err();
+	return same_shape;
+}
+
+/** Hands the whole packed data to H5Dscatter at once
+ */
+herr_t packed_data_source(const void** src_buf, size_t* src_buf_bytes_used, void* op_data)
+{
+	const vector<unsigned char>& data = *static_cast<const vector<unsigned char>*>(op_data);
+	*src_buf = data.data();
+	*src_buf_bytes_used = data.size();
+	return 0;
+}
+
+} // namespace
+
+namespace decl_hdf5 {
+
+Prefetcher::Prefetcher()
+{
+	m_thread = thread{&Prefetcher::run, this};
+}
+
+Prefetcher::~Prefetcher()
+{
+	{
+		lock_guard<mutex> request_lock{m_request_mutex};
+		m_stop = true;
+	}
+	m_request_cv.notify_one();
+	m_thread.join();
+
+	lock_guard<recursive_mutex> hdf5_lock{hdf5_mutex()};
+	m_request = Request{};
+	m_result = Result{};
+}
+
+void Prefetcher::run()
+{
+	unique_lock<mutex> request_lock{m_request_mutex};
+	for (;;) {
+		m_request_cv.wait(request_lock, [&] { return m_stop || m_request_pending; });
+		if (m_stop) return;
+		Request request = move(m_request);
+		m_request_pending = false;
+		request_lock.unlock();
+		{
+			lock_guard<recursive_mutex> hdf5_lock{hdf5_mutex()};
+			// a read might have happened in between, making the request useless
+			if (request.m_generation == m_generation) {
+				read(request);
+			}
+			// release the HDF5 ids with the lock held
+			request = Request{};
+		}
+		request_lock.lock();
+	}
+}
+
+void Prefetcher::read(Request& request)
+{
+	m_result.m_valid = false;
+	try {
+		Hdf5_error_handler _;
+		Raii_hid h5_file = make_raii_hid(H5Fopen(request.m_filename.c_str(), H5F_ACC_RDONLY, request.m_file_access_list), H5Fclose);
+		Raii_hid h5_set = make_raii_hid(H5Dopen2(h5_file, request.m_dataset_name.c_str(), H5P_DEFAULT), H5Dclose);
+		Raii_hid h5_set_space = make_raii_hid(H5Dget_space(h5_set), H5Sclose);
+		htri_t same_extent = H5Sextent_equal(h5_set_space, request.m_file_space);
+		if (0 > same_extent) handle_hdf5_err();
+		if (!same_extent) return;
+
+		hssize_t nb_points = H5Sget_select_npoints(request.m_file_space);
+		if (0 > nb_points) handle_hdf5_err();
+		size_t type_size = H5Tget_size(request.m_mem_type);
+		if (0 == type_size) handle_hdf5_err();
+		m_spare.resize(nb_points * type_size);
+		if (0 < nb_points) {
+			hsize_t h5_nb_points = nb_points;
+			Raii_hid h5_packed_space = make_raii_hid(H5Screate_simple(1, &h5_nb_points, NULL), H5Sclose);
+			if (0 > H5Dread(h5_set, request.m_mem_type, h5_packed_space, request.m_file_space, H5P_DEFAULT, m_spare.data())) handle_hdf5_err();
+		}
+
+		m_result.m_data.swap(m_spare);
+		m_result.m_filename = move(request.m_filename);
+		m_result.m_dataset_name = move(request.m_dataset_name);
+		m_result.m_file_space = move(request.m_file_space);
+		m_result.m_mem_type = move(request.m_mem_type);
+		m_result.m_valid = true;
+	} catch (const exception&) {
+		// the guess was wrong (e.g. no such dataset), the read will be done on demand
+	}
+}
+
+void Prefetcher::prefetch(const string& filename, const string& dataset_name, hid_t h5_file_access_list, hid_t h5_file_space, hid_t h5_mem_type)
+{
+	Request request;
+	request.m_filename = filename;
+	request.m_dataset_name = dataset_name;
+	request.m_file_access_list = make_raii_hid(H5Pcopy(h5_file_access_list), H5Pclose);
+	request.m_file_space = make_raii_hid(H5Scopy(h5_file_space), H5Sclose);
+	request.m_mem_type = make_raii_hid(H5Tcopy(h5_mem_type), H5Tclose);
+
+	{
+		lock_guard<mutex> request_lock{m_request_mutex};
+		request.m_generation = ++m_generation;
+		m_request = move(request);
+		m_request_pending = true;
+	}
+	m_request_cv.notify_one();
+}
+
+bool Prefetcher::fetch(const string& filename, const string& dataset_name, hid_t h5_file_space, hid_t h5_mem_type, hid_t h5_mem_space, void* data)
+{
+	{
+		// drop the request not handled yet if any, its data is required now
+		lock_guard<mutex> request_lock{m_request_mutex};
+		++m_generation;
+		m_request_pending = false;
+		m_request = Request{};
+	}
+
+	if (!m_result.m_valid || m_result.m_filename != filename || m_result.m_dataset_name != dataset_name) return false;
+	m_result.m_valid = false;
+
+	htri_t same_type = H5Tequal(m_result.m_mem_type, h5_mem_type);
+	if (0 > same_type) handle_hdf5_err();
+	if (!same_type || !same_selection(m_result.m_file_space, h5_file_space)) return false;
+
+	hssize_t nb_selected = H5Sget_select_npoints(h5_mem_space);
+	if (0 > nb_selected) handle_hdf5_err();
+	hssize_t nb_points = H5Sget_simple_extent_npoints(h5_mem_space);
+	if (0 > nb_points) handle_hdf5_err();
+	if (nb_selected == nb_points) {
+		// the whole memory buffer is selected, its layout is the packed one
+		memcpy(data, m_result.m_data.data(), m_result.m_data.size());
+	} else if (0 < nb_selected) {
+		if (0 > H5Dscatter(packed_data_source, &m_result.m_data, h5_mem_type, h5_mem_space, data)) handle_hdf5_err();
+	}
+	// keep the buffer for the next read
+	m_spare.swap(m_result.m_data);
+	return true;
+}
+
+} // namespace decl_hdf5
@@ -0,0 +1,174 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef DECL_HDF5_PREFETCHER_H_
+#define DECL_HDF5_PREFETCHER_H_
+
+#include <hdf5.h>
+#ifdef H5_HAVE_PARALLEL
+#include <mpi.h>
+#endif
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hdf5_wrapper.h"
+
+namespace decl_hdf5 {
+
+/** A Prefetcher reads a dataset in a background thread so that a later read of
+ * the same dataset selection can be served from memory.
+ *
+ * The background thread holds hdf5_mutex() while reading, the reads are thus
+ * overlapped with the code that runs outside of the plugin.
+ * All member functions must be called with hdf5_mutex() held, except the
+ * constructor and the destructor.
+ */
+class Prefetcher
+{
+	/// A dataset selection to read in the background
+	struct Request {
+		/// the file to read from
+		std::string m_filename;
+
+		/// the dataset to read
+		std::string m_dataset_name;
+
+		/// the file access properties used to open the file
+		Raii_hid m_file_access_list;
+
+		/// the dataset dataspace with the selection to read
+		Raii_hid m_file_space;
+
+		/// the type of the data in memory
+		Raii_hid m_mem_type;
+
+		/// the generation of the request
+		unsigned m_generation = 0;
+	};
+
+	/// The data read in the background, packed in selection order
+	struct Result {
+		/// the file the data was read from
+		std::string m_filename;
+
+		/// the dataset the data was read from
+		std::string m_dataset_name;
+
+		/// the dataset dataspace with the selection that was read
+		Raii_hid m_file_space;
+
+		/// the type of the data in memory
+		Raii_hid m_mem_type;
+
+		/// the data
+		std::vector<unsigned char> m_data;
+
+		/// whether the result holds data
+		bool m_valid = false;
+	};
+
+	/// protects m_request, m_request_pending and m_stop
+	std::mutex m_request_mutex;
+
+	/// notified when a request is posted or when the thread must stop
+	std::condition_variable m_request_cv;
+
+	/// the next request to handle
+	Request m_request;
+
+	/// whether m_request is waiting to be handled
+	bool m_request_pending = false;
+
+	/// whether the thread must stop
+	bool m_stop = false;
+
+	/// the generation of the last request, older requests are dropped
+	std::atomic<unsigned> m_generation{0};
+
+	/// the result of the last request handled, protected by hdf5_mutex()
+	Result m_result;
+
+	/// a buffer kept for the next read to avoid reallocating, protected by hdf5_mutex()
+	std::vector<unsigned char> m_spare;
+
+	/// the background thread
+	std::thread m_thread;
+
+	/** The background thread main loop
+	 */
+	void run();
+
+	/** Reads a request in the background thread, with hdf5_mutex() held
+	 *
+	 * \param request the request to read
+	 */
+	void read(Request& request);
+
+public:
+	/** Creates the Prefetcher and starts its background thread
+	 */
+	Prefetcher();
+
+	Prefetcher(const Prefetcher&) = delete;
+
+	Prefetcher& operator= (const Prefetcher&) = delete;
+
+	/** Stops the background thread, must be called without holding hdf5_mutex()
+	 */
+	~Prefetcher();
+
+	/** Schedules the background read of a dataset selection, replacing any
+	 * request not handled yet
+	 *
+	 * \param filename the file to read from
+	 * \param dataset_name the dataset to read
+	 * \param h5_file_access_list the file access properties used to open the file
+	 * \param h5_file_space a dataspace with the dataset selection to read
+	 * \param h5_mem_type the type of the data in memory
+	 */
+	void prefetch(const std::string& filename, const std::string& dataset_name, hid_t h5_file_access_list, hid_t h5_file_space, hid_t h5_mem_type);
+
+	/** Serves a read from the prefetched data if it matches, drops any pending
+	 * request otherwise
+	 *
+	 * \param filename the file to read from
+	 * \param dataset_name the dataset to read
+	 * \param h5_file_space the dataset dataspace with the dataset selection applied
+	 * \param h5_mem_type the type of the data in memory
+	 * \param h5_mem_space the memory dataspace with the memory selection applied
+	 * \param data where to store the data
+	 * \return whether the data was served, if false, nothing was done and the
+	 *         data must be read with H5Dread
+	 */
+	bool fetch(const std::string& filename, const std::string& dataset_name, hid_t h5_file_space, hid_t h5_mem_type, hid_t h5_mem_space, void* data);
+};
+
+} // namespace decl_hdf5
+
+#endif // DECL_HDF5_PREFETCHER_H_
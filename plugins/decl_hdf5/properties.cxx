@@ -0,0 +1,242 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include <hdf5.h>
+#ifdef H5_HAVE_PARALLEL
+#include <mpi.h>
+#endif
+
+#include <algorithm>
+#include <string>
+
+#include <pdi/context.h>
+#include <pdi/error.h>
+#include <pdi/paraconf_wrapper.h>
+
+#include "hdf5_wrapper.h"
+
+#include "properties.h"
+
+using PDI::Config_error;
+using PDI::Context;
+using PDI::each;
+using PDI::Expression;
+using PDI::to_string;
+using PDI::Value_error;
+using std::find;
+using std::string;
+using std::vector;
+
+namespace {
+
+/// The names of the properties supported in each kind of property list
+const vector<string>& property_names(decl_hdf5::Properties::Kind kind)
+{
+	static const vector<string> FILE_ACCESS_NAMES{
+		"alignment",
+		"alignment_threshold",
+		"meta_block_size",
+		"small_data_block_size",
+		"sieve_buf_size",
+		"page_buffer_size",
+		"chunk_cache_nslots",
+		"chunk_cache_nbytes",
+		"chunk_cache_w0",
+#ifdef H5_HAVE_PARALLEL
+		"all_coll_metadata_ops",
+		"coll_metadata_write",
+#endif
+	};
+	static const vector<string> FILE_CREATION_NAMES{"file_space_strategy", "file_space_persist", "file_space_threshold", "file_space_page_size"};
+	static const vector<string> DATASET_CREATION_NAMES{"fill_time", "alloc_time"};
+	switch (kind) {
+	case decl_hdf5::Properties::FILE_ACCESS:
+		return FILE_ACCESS_NAMES;
+	case decl_hdf5::Properties::FILE_CREATION:
+		return FILE_CREATION_NAMES;
+	case decl_hdf5::Properties::DATASET_CREATION:
+		return DATASET_CREATION_NAMES;
+	default:
+		throw Value_error{"Properties have no fixed names"};
+	}
+}
+
+H5F_fspace_strategy_t to_fspace_strategy(const string& strategy)
+{
+	if (strategy == "FSM_AGGR") return H5F_FSPACE_STRATEGY_FSM_AGGR;
+	if (strategy == "PAGE") return H5F_FSPACE_STRATEGY_PAGE;
+	if (strategy == "AGGR") return H5F_FSPACE_STRATEGY_AGGR;
+	if (strategy == "NONE") return H5F_FSPACE_STRATEGY_NONE;
+	throw Value_error{"Invalid file_space_strategy: `{}'. Expecting FSM_AGGR, PAGE, AGGR or NONE.", strategy};
+}
+
+H5D_fill_time_t to_fill_time(const string& fill_time)
+{
+	if (fill_time == "IFSET") return H5D_FILL_TIME_IFSET;
+	if (fill_time == "ALLOC") return H5D_FILL_TIME_ALLOC;
+	if (fill_time == "NEVER") return H5D_FILL_TIME_NEVER;
+	throw Value_error{"Invalid fill_time: `{}'. Expecting IFSET, ALLOC or NEVER.", fill_time};
+}
+
+H5D_alloc_time_t to_alloc_time(const string& alloc_time)
+{
+	if (alloc_time == "DEFAULT") return H5D_ALLOC_TIME_DEFAULT;
+	if (alloc_time == "EARLY") return H5D_ALLOC_TIME_EARLY;
+	if (alloc_time == "INCR") return H5D_ALLOC_TIME_INCR;
+	if (alloc_time == "LATE") return H5D_ALLOC_TIME_LATE;
+	throw Value_error{"Invalid alloc_time: `{}'. Expecting DEFAULT, EARLY, INCR or LATE.", alloc_time};
+}
+
+} // namespace
+
+namespace decl_hdf5 {
+
+Properties::Properties(Kind kind, PC_tree_t tree)
+	: m_kind{kind}
+{
+	each(tree, [&](PC_tree_t key_tree, PC_tree_t value) {
+		string key = to_string(key_tree);
+		if (m_kind != MPI_INFO) {
+			const vector<string>& names = property_names(m_kind);
+			if (find(names.begin(), names.end(), key) == names.end()) {
+				throw Config_error{key_tree, "Unknown or unsupported HDF5 property: `{}'", key};
+			}
+		}
+		m_values.emplace_back(key, to_string(value));
+	});
+}
+
+Expression Properties::value(const string& name) const
+{
+	for (auto&& name_value: m_values) {
+		if (name_value.first == name) return name_value.second;
+	}
+	return {};
+}
+
+void Properties::merge(const Properties& defaults)
+{
+	if (m_values.empty()) m_kind = defaults.m_kind;
+	for (auto&& name_value: defaults.m_values) {
+		if (!value(name_value.first)) {
+			m_values.emplace_back(name_value);
+		}
+	}
+}
+
+void Properties::apply(Context& ctx, hid_t plist) const
+{
+	if (m_values.empty()) return;
+
+	switch (m_kind) {
+	case FILE_ACCESS: {
+		if (Expression alignment = value("alignment")) {
+			hsize_t threshold = 1;
+			if (Expression threshold_expr = value("alignment_threshold")) threshold = threshold_expr.to_long(ctx);
+			ctx.logger().trace("Setting file alignment to {} for objects larger than {}", alignment.to_long(ctx), threshold);
+			if (0 > H5Pset_alignment(plist, threshold, alignment.to_long(ctx))) handle_hdf5_err("Cannot set file alignment");
+		}
+		if (Expression size = value("meta_block_size")) {
+			if (0 > H5Pset_meta_block_size(plist, size.to_long(ctx))) handle_hdf5_err("Cannot set metadata block size");
+		}
+		if (Expression size = value("small_data_block_size")) {
+			if (0 > H5Pset_small_data_block_size(plist, size.to_long(ctx))) handle_hdf5_err("Cannot set small data block size");
+		}
+		if (Expression size = value("sieve_buf_size")) {
+			if (0 > H5Pset_sieve_buf_size(plist, size.to_long(ctx))) handle_hdf5_err("Cannot set sieve buffer size");
+		}
+		if (Expression size = value("page_buffer_size")) {
+			if (0 > H5Pset_page_buffer_size(plist, size.to_long(ctx), 0, 0)) handle_hdf5_err("Cannot set page buffer size");
+		}
+		Expression nslots = value("chunk_cache_nslots");
+		Expression nbytes = value("chunk_cache_nbytes");
+		Expression w0 = value("chunk_cache_w0");
+		if (nslots || nbytes || w0) {
+			int mdc_nelmts;
+			size_t rdcc_nslots;
+			size_t rdcc_nbytes;
+			double rdcc_w0;
+			if (0 > H5Pget_cache(plist, &mdc_nelmts, &rdcc_nslots, &rdcc_nbytes, &rdcc_w0)) handle_hdf5_err();
+			if (nslots) rdcc_nslots = nslots.to_long(ctx);
+			if (nbytes) rdcc_nbytes = nbytes.to_long(ctx);
+			if (w0) rdcc_w0 = w0.to_double(ctx);
+			if (0 > H5Pset_cache(plist, mdc_nelmts, rdcc_nslots, rdcc_nbytes, rdcc_w0)) handle_hdf5_err("Cannot set chunk cache");
+		}
+#ifdef H5_HAVE_PARALLEL
+		if (Expression coll_ops = value("all_coll_metadata_ops")) {
+			if (0 > H5Pset_all_coll_metadata_ops(plist, coll_ops.to_long(ctx))) handle_hdf5_err("Cannot set collective metadata reads");
+		}
+		if (Expression coll_write = value("coll_metadata_write")) {
+			if (0 > H5Pset_coll_metadata_write(plist, coll_write.to_long(ctx))) handle_hdf5_err("Cannot set collective metadata writes");
+		}
+#endif
+	} break;
+	case FILE_CREATION: {
+		Expression strategy_expr = value("file_space_strategy");
+		Expression persist_expr = value("file_space_persist");
+		Expression threshold_expr = value("file_space_threshold");
+		if (strategy_expr || persist_expr || threshold_expr) {
+			H5F_fspace_strategy_t strategy;
+			hbool_t persist;
+			hsize_t threshold;
+			if (0 > H5Pget_file_space_strategy(plist, &strategy, &persist, &threshold)) handle_hdf5_err();
+			if (strategy_expr) strategy = to_fspace_strategy(strategy_expr.to_string(ctx));
+			if (persist_expr) persist = persist_expr.to_long(ctx);
+			if (threshold_expr) threshold = threshold_expr.to_long(ctx);
+			if (0 > H5Pset_file_space_strategy(plist, strategy, persist, threshold)) handle_hdf5_err("Cannot set file space strategy");
+		}
+		if (Expression page_size = value("file_space_page_size")) {
+			if (0 > H5Pset_file_space_page_size(plist, page_size.to_long(ctx))) handle_hdf5_err("Cannot set file space page size");
+		}
+	} break;
+	case DATASET_CREATION: {
+		if (Expression fill_time = value("fill_time")) {
+			if (0 > H5Pset_fill_time(plist, to_fill_time(fill_time.to_string(ctx)))) handle_hdf5_err("Cannot set fill time");
+		}
+		if (Expression alloc_time = value("alloc_time")) {
+			if (0 > H5Pset_alloc_time(plist, to_alloc_time(alloc_time.to_string(ctx)))) handle_hdf5_err("Cannot set allocation time");
+		}
+	} break;
+	case MPI_INFO:
+		throw Value_error{"MPI-IO hints can not be set in a HDF5 property list"};
+	}
+}
+
+#ifdef H5_HAVE_PARALLEL
+MPI_Info Properties::mpi_info(Context& ctx) const
+{
+	if (m_values.empty()) return MPI_INFO_NULL;
+
+	MPI_Info info;
+	MPI_Info_create(&info);
+	for (auto&& name_value: m_values) {
+		string hint = name_value.second.to_string(ctx);
+		ctx.logger().trace("Setting `{}' MPI-IO hint to `{}'", name_value.first, hint);
+		MPI_Info_set(info, name_value.first.c_str(), hint.c_str());
+	}
+	return info;
+}
+#endif
+
+} // namespace decl_hdf5
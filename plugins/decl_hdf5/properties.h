@@ -0,0 +1,116 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef DECL_HDF5_PROPERTIES_H_
+#define DECL_HDF5_PROPERTIES_H_
+
+#include <hdf5.h>
+#ifdef H5_HAVE_PARALLEL
+#include <mpi.h>
+#endif
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <paraconf.h>
+
+#include <pdi/pdi_fwd.h>
+#include <pdi/expression.h>
+
+namespace decl_hdf5 {
+
+/** A set of HDF5 properties (or MPI-IO hints) read from a yaml mapping.
+ *
+ * Each value is an expression evaluated when the properties are applied.
+ */
+class Properties
+{
+public:
+	/// The property list these properties apply to
+	enum Kind {
+		FILE_ACCESS,
+		FILE_CREATION,
+		DATASET_CREATION,
+		MPI_INFO
+	};
+
+private:
+	/// The property list these properties apply to
+	Kind m_kind = FILE_ACCESS;
+
+	/// The value of each property by name
+	std::vector<std::pair<std::string, PDI::Expression>> m_values;
+
+	/** Accesses the value of a property
+	 *
+	 * \param name the name of the property
+	 * \return the value of the property or a null expression if not set
+	 */
+	PDI::Expression value(const std::string& name) const;
+
+public:
+	/** The default constructor for an empty set of properties
+	 */
+	Properties() = default;
+
+	/** Builds a set of properties from a yaml tree.
+	 *
+	 * \param kind the property list these properties apply to
+	 * \param tree a mapping from property names to $-expressions
+	 */
+	Properties(Kind kind, PC_tree_t tree);
+
+	/** Checks whether no property is set
+	 *
+	 * \return whether no property is set
+	 */
+	bool empty() const { return m_values.empty(); }
+
+	/** Adds properties that are not already set from another set
+	 *
+	 * \param defaults the properties to use when not set in this set
+	 */
+	void merge(const Properties& defaults);
+
+	/** Sets the properties in a HDF5 property list
+	 *
+	 * \param ctx the context in which to evaluate the values
+	 * \param plist the property list to modify
+	 */
+	void apply(PDI::Context& ctx, hid_t plist) const;
+
+#ifdef H5_HAVE_PARALLEL
+	/** Builds an MPI_Info from MPI-IO hints
+	 *
+	 * \param ctx the context in which to evaluate the values
+	 * \return the MPI_Info to free by the caller, MPI_INFO_NULL if empty
+	 */
+	MPI_Info mpi_info(PDI::Context& ctx) const;
+#endif
+};
+
+} // namespace decl_hdf5
+
+#endif // DECL_HDF5_PROPERTIES_H_
@@ -0,0 +1,153 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include <hdf5.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "record_packer.h"
+
+using std::max;
+using std::memcpy;
+
+namespace decl_hdf5 {
+
+namespace {
+
+/// The size of the buffer used to gather the records of a sparse selection
+constexpr size_t GATHER_SIZE = 1 << 20;
+
+} // namespace
+
+bool Record_packer::compile(hid_t h5_mem_type, size_t mem_offset, hid_t h5_file_type, size_t file_offset)
+{
+	int nb_members = H5Tget_nmembers(h5_file_type);
+	if (0 > nb_members) handle_hdf5_err();
+	for (int file_idx = 0; file_idx < nb_members; ++file_idx) {
+		char* name = H5Tget_member_name(h5_file_type, file_idx);
+		if (!name) handle_hdf5_err();
+		int mem_idx = H5Tget_member_index(h5_mem_type, name);
+		H5free_memory(name);
+		// a member missing in memory is left to HDF5 conversion
+		if (0 > mem_idx) return false;
+
+		Raii_hid h5_mem_member = make_raii_hid(H5Tget_member_type(h5_mem_type, mem_idx), H5Tclose);
+		Raii_hid h5_file_member = make_raii_hid(H5Tget_member_type(h5_file_type, file_idx), H5Tclose);
+		size_t src = mem_offset + H5Tget_member_offset(h5_mem_type, mem_idx);
+		size_t dst = file_offset + H5Tget_member_offset(h5_file_type, file_idx);
+
+		if (H5T_COMPOUND == H5Tget_class(h5_mem_member) && H5T_COMPOUND == H5Tget_class(h5_file_member)) {
+			if (!compile(h5_mem_member, src, h5_file_member, dst)) return false;
+			continue;
+		}
+
+		// members that need a conversion of their own are left to HDF5
+		htri_t same_type = H5Tequal(h5_mem_member, h5_file_member);
+		if (0 > same_type) handle_hdf5_err();
+		if (!same_type) return false;
+
+		size_t size = H5Tget_size(h5_file_member);
+		if (!m_plan.empty() && m_plan.back().m_src + m_plan.back().m_size == src && m_plan.back().m_dst + m_plan.back().m_size == dst) {
+			// merge with the previous copy
+			m_plan.back().m_size += size;
+		} else {
+			m_plan.push_back({src, dst, size});
+		}
+	}
+	return true;
+}
+
+void Record_packer::pack(const unsigned char* data, size_t nb_records, size_t first)
+{
+	unsigned char* packed = m_buffer.data() + first * m_file_size;
+	if (m_plan.size() == 1) {
+		const Copy& copy = m_plan.front();
+		for (size_t record = 0; record < nb_records; ++record) {
+			memcpy(packed + record * m_file_size + copy.m_dst, data + record * m_mem_size + copy.m_src, copy.m_size);
+		}
+	} else {
+		for (size_t record = 0; record < nb_records; ++record) {
+			for (auto&& copy: m_plan) {
+				memcpy(packed + record * m_file_size + copy.m_dst, data + record * m_mem_size + copy.m_src, copy.m_size);
+			}
+		}
+	}
+}
+
+const void* Record_packer::pack(hid_t h5_mem_type, hid_t h5_mem_space, hid_t h5_file_type, const void* data)
+{
+	if (H5T_COMPOUND != H5Tget_class(h5_mem_type) || H5T_COMPOUND != H5Tget_class(h5_file_type)) return NULL;
+	htri_t same_type = H5Tequal(h5_mem_type, h5_file_type);
+	if (0 > same_type) handle_hdf5_err();
+	if (same_type) return NULL;
+
+	// the plan is only compiled again when the types change
+	bool compiled = 0 <= m_mem_type;
+	if (compiled) {
+		htri_t same_mem_type = H5Tequal(m_mem_type, h5_mem_type);
+		if (0 > same_mem_type) handle_hdf5_err();
+		htri_t same_file_type = H5Tequal(m_file_type, h5_file_type);
+		if (0 > same_file_type) handle_hdf5_err();
+		compiled = same_mem_type && same_file_type;
+	}
+	if (!compiled) {
+		m_mem_type = make_raii_hid(H5Tcopy(h5_mem_type), H5Tclose);
+		m_file_type = make_raii_hid(H5Tcopy(h5_file_type), H5Tclose);
+		m_mem_size = H5Tget_size(h5_mem_type);
+		m_file_size = H5Tget_size(h5_file_type);
+		m_plan.clear();
+		m_buffer.clear();
+		m_packable = compile(h5_mem_type, 0, h5_file_type, 0);
+	}
+	if (!m_packable) return NULL;
+
+	hssize_t nb_records = H5Sget_select_npoints(h5_mem_space);
+	if (0 > nb_records) handle_hdf5_err();
+	hssize_t nb_space_records = H5Sget_simple_extent_npoints(h5_mem_space);
+	if (0 > nb_space_records) handle_hdf5_err();
+	m_buffer.resize(nb_records * m_file_size);
+
+	if (nb_records == nb_space_records) {
+		pack(static_cast<const unsigned char*>(data), nb_records, 0);
+	} else {
+		// gather the selected records by blocks and pack each block
+		struct Gather_state {
+			Record_packer* m_packer;
+			size_t m_first;
+		} state{this, 0};
+		std::vector<unsigned char> gathered(max(GATHER_SIZE / m_mem_size, size_t{1}) * m_mem_size);
+		H5D_gather_func_t pack_gathered = [](const void* buffer, size_t size, void* op_data) -> herr_t {
+			Gather_state& state = *static_cast<Gather_state*>(op_data);
+			size_t nb_gathered = size / state.m_packer->m_mem_size;
+			state.m_packer->pack(static_cast<const unsigned char*>(buffer), nb_gathered, state.m_first);
+			state.m_first += nb_gathered;
+			return 0;
+		};
+		if (0 > H5Dgather(h5_mem_space, data, h5_mem_type, gathered.size(), gathered.data(), pack_gathered, &state)) handle_hdf5_err();
+	}
+	return m_buffer.data();
+}
+
+} // namespace decl_hdf5
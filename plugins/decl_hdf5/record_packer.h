@@ -0,0 +1,118 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef DECL_HDF5_RECORD_PACKER_H_
+#define DECL_HDF5_RECORD_PACKER_H_
+
+#include <hdf5.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "hdf5_wrapper.h"
+
+namespace decl_hdf5 {
+
+/** A Record_packer converts an array of records from its in-memory layout to
+ * the layout of the dataset in file before it is written.
+ *
+ * When the in-memory compound type and the dataset compound type only differ
+ * by the offsets of their members (padding, order), HDF5 converts the records
+ * one by one through its conversion path buffers.
+ * The Record_packer instead compiles the conversion once into a list of
+ * contiguous copies and applies it to the whole array, the write is then done
+ * with the dataset type in memory and HDF5 conversion is a no-op.
+ *
+ * All member functions must be called with hdf5_mutex() held.
+ */
+class Record_packer
+{
+	/// A contiguous copy from a record in memory to a record in file
+	struct Copy {
+		/// offset of the copied bytes in the in-memory record
+		size_t m_src;
+
+		/// offset of the copied bytes in the file record
+		size_t m_dst;
+
+		/// number of bytes copied
+		size_t m_size;
+	};
+
+	/// the in-memory type the plan was compiled for
+	Raii_hid m_mem_type{-1, nullptr};
+
+	/// the file type the plan was compiled for
+	Raii_hid m_file_type{-1, nullptr};
+
+	/// the size of a record in memory
+	size_t m_mem_size = 0;
+
+	/// the size of a record in file
+	size_t m_file_size = 0;
+
+	/// whether the conversion from m_mem_type to m_file_type can be compiled
+	bool m_packable = false;
+
+	/// the compiled conversion from m_mem_type to m_file_type
+	std::vector<Copy> m_plan;
+
+	/// the packed records, kept between writes to avoid reallocating
+	std::vector<unsigned char> m_buffer;
+
+	/** Compiles the conversion of the members of a compound type
+	 *
+	 * \param h5_mem_type the in-memory compound type
+	 * \param mem_offset the offset of the in-memory compound in the record
+	 * \param h5_file_type the file compound type
+	 * \param file_offset the offset of the file compound in the record
+	 * \return whether the conversion could be compiled
+	 */
+	bool compile(hid_t h5_mem_type, size_t mem_offset, hid_t h5_file_type, size_t file_offset);
+
+	/** Packs contiguous records
+	 *
+	 * \param data the records in memory
+	 * \param nb_records the number of records to pack
+	 * \param first the index of the first record in the packed buffer
+	 */
+	void pack(const unsigned char* data, size_t nb_records, size_t first);
+
+public:
+	/** Packs the selected records of an array if the conversion to the file
+	 * type can be compiled
+	 *
+	 * \param h5_mem_type the type of the records in memory
+	 * \param h5_mem_space the memory dataspace with the memory selection applied
+	 * \param h5_file_type the type of the records in the dataset
+	 * \param data the array of records in memory
+	 * \return the packed records, in selection order and with the file layout,
+	 *         or NULL if the records must be written as is
+	 */
+	const void* pack(hid_t h5_mem_type, hid_t h5_mem_space, hid_t h5_file_type, const void* data);
+};
+
+} // namespace decl_hdf5
+
+#endif // DECL_HDF5_RECORD_PACKER_H_
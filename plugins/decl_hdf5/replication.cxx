@@ -0,0 +1,158 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include <hdf5.h>
+#ifdef H5_HAVE_PARALLEL
+#include <mpi.h>
+#endif
+
+#include <algorithm>
+#include <climits>
+#include <vector>
+
+#include <pdi/context.h>
+#include <pdi/error.h>
+
+#include "hdf5_wrapper.h"
+
+#include "replication.h"
+
+#ifdef H5_HAVE_PARALLEL
+
+using PDI::Context;
+using PDI::System_error;
+using std::min;
+using std::vector;
+
+namespace {
+
+using namespace decl_hdf5;
+
+/** Broadcasts a buffer of any size
+ *
+ * \param buffer the buffer to broadcast
+ * \param size the size of the buffer in bytes
+ * \param comm the communicator to broadcast on, from its first process
+ */
+void broadcast(void* buffer, size_t size, MPI_Comm comm)
+{
+	// MPI counts are limited to int
+	constexpr size_t MAX_COUNT = 1 << 30;
+	unsigned char* bytes = static_cast<unsigned char*>(buffer);
+	for (size_t offset = 0; offset < size; offset += MAX_COUNT) {
+		int count = min(size - offset, MAX_COUNT);
+		if (MPI_SUCCESS != MPI_Bcast(bytes + offset, count, MPI_BYTE, 0, comm)) {
+			throw System_error{"Cannot broadcast replicated data"};
+		}
+	}
+}
+
+/** Hands the whole broadcast data to H5Dscatter at once
+ */
+herr_t broadcast_data_source(const void** src_buf, size_t* src_buf_bytes_used, void* op_data)
+{
+	const vector<unsigned char>& data = *static_cast<const vector<unsigned char>*>(op_data);
+	*src_buf = data.data();
+	*src_buf_bytes_used = data.size();
+	return 0;
+}
+
+} // namespace
+
+namespace decl_hdf5 {
+
+File_communicators::File_communicators(MPI_Comm comm)
+	: m_comm{comm}
+{}
+
+MPI_Comm File_communicators::file_comm()
+{
+	if (m_file_comm == MPI_COMM_NULL && MPI_SUCCESS != MPI_Comm_dup(m_comm, &m_file_comm)) {
+		throw System_error{"Cannot duplicate the file communicator"};
+	}
+	return m_file_comm;
+}
+
+MPI_Comm File_communicators::node_comm()
+{
+	if (m_node_comm == MPI_COMM_NULL && MPI_SUCCESS != MPI_Comm_split_type(file_comm(), MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &m_node_comm)) {
+		throw System_error{"Cannot split the file communicator by node"};
+	}
+	return m_node_comm;
+}
+
+void replicated_read(
+	Context& ctx,
+	File_communicators& comms,
+	hid_t h5_set,
+	hid_t h5_mem_type,
+	hid_t h5_mem_space,
+	hid_t h5_file_space,
+	hid_t read_lst,
+	bool per_node,
+	void* data
+)
+{
+	MPI_Comm group_comm = per_node ? comms.node_comm() : comms.file_comm();
+	int group_rank;
+	MPI_Comm_rank(group_comm, &group_rank);
+	bool reader = (0 == group_rank);
+
+	// the read is collective, the processes that do not read select nothing
+	Raii_hid h5_read_mem_space = make_raii_hid(H5Scopy(h5_mem_space), H5Sclose);
+	Raii_hid h5_read_file_space = make_raii_hid(H5Scopy(h5_file_space), H5Sclose);
+	if (!reader) {
+		if (0 > H5Sselect_none(h5_read_mem_space)) handle_hdf5_err();
+		if (0 > H5Sselect_none(h5_read_file_space)) handle_hdf5_err();
+	}
+	if (0 > H5Dread(h5_set, h5_mem_type, h5_read_mem_space, h5_read_file_space, read_lst, data)) handle_hdf5_err();
+
+	hssize_t nb_selected = H5Sget_select_npoints(h5_mem_space);
+	if (0 > nb_selected) handle_hdf5_err();
+	hssize_t nb_points = H5Sget_simple_extent_npoints(h5_mem_space);
+	if (0 > nb_points) handle_hdf5_err();
+	size_t element_size = H5Tget_size(h5_mem_type);
+	if (0 == element_size) handle_hdf5_err();
+	ctx.logger().trace("Broadcasting {} replicated bytes", nb_selected * element_size);
+	if (nb_selected == nb_points) {
+		// the whole memory buffer is selected, it is broadcast in place
+		broadcast(data, nb_selected * element_size, group_comm);
+	} else if (0 < nb_selected) {
+		vector<unsigned char> packed(nb_selected * element_size);
+		if (reader && 0 > H5Dgather(h5_mem_space, data, h5_mem_type, packed.size(), packed.data(), NULL, NULL)) handle_hdf5_err();
+		broadcast(packed.data(), packed.size(), group_comm);
+		if (!reader && 0 > H5Dscatter(broadcast_data_source, &packed, h5_mem_type, h5_mem_space, data)) handle_hdf5_err();
+	}
+}
+
+bool replicated_owner(File_communicators& comms)
+{
+	int file_rank;
+	MPI_Comm_rank(comms.file_comm(), &file_rank);
+	return 0 == file_rank;
+}
+
+} // namespace decl_hdf5
+
+#endif // H5_HAVE_PARALLEL
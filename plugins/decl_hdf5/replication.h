@@ -0,0 +1,158 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef DECL_HDF5_REPLICATION_H_
+#define DECL_HDF5_REPLICATION_H_
+
+#include <hdf5.h>
+#ifdef H5_HAVE_PARALLEL
+#include <mpi.h>
+#endif
+
+#include <pdi/pdi_fwd.h>
+
+namespace decl_hdf5 {
+
+class File_communicators;
+
+} // namespace decl_hdf5
+
+#ifdef H5_HAVE_PARALLEL
+
+namespace decl_hdf5 {
+
+/** A RAII-style wrapper for MPI communicators
+ */
+class Raii_comm
+{
+	/// the wrapped communicator
+	MPI_Comm m_comm = MPI_COMM_NULL;
+
+public:
+	Raii_comm() = default;
+
+	Raii_comm(const Raii_comm&) = delete;
+
+	Raii_comm& operator= (const Raii_comm&) = delete;
+
+	~Raii_comm()
+	{
+		if (m_comm != MPI_COMM_NULL) MPI_Comm_free(&m_comm);
+	}
+
+	/** Accesses the communicator to set it
+	 *
+	 * \return a pointer to the wrapped communicator
+	 */
+	MPI_Comm* operator& () { return &m_comm; }
+
+	/** Supports using the Raii_comm as a raw MPI_Comm.
+	 */
+	operator MPI_Comm () const { return m_comm; }
+};
+
+/** The communicators used to replicate data over the processes of a file
+ * opened in parallel.
+ *
+ * They are created collectively on first use and kept for all the operations
+ * on the file while it is open.
+ */
+class File_communicators
+{
+	/// the communicator the file is opened with
+	MPI_Comm m_comm;
+
+	/// a duplicate of the file communicator, null until first used
+	Raii_comm m_file_comm;
+
+	/// the processes of the file communicator on the same node, null until first used
+	Raii_comm m_node_comm;
+
+public:
+	/** Builds the communicators of a file
+	 *
+	 * \param comm the communicator the file is opened with
+	 */
+	File_communicators(MPI_Comm comm);
+
+	File_communicators(const File_communicators&) = delete;
+
+	File_communicators& operator= (const File_communicators&) = delete;
+
+	/** Accesses the file communicator, creating it on first use (collective)
+	 *
+	 * \return a duplicate of the communicator the file is opened with
+	 */
+	MPI_Comm file_comm();
+
+	/** Accesses the node communicator, creating it on first use (collective)
+	 *
+	 * \return the processes of the file communicator on the same node
+	 */
+	MPI_Comm node_comm();
+};
+
+/** Reads a dataset selection replicated on all the processes of a file opened
+ * in parallel, the selection is read by a single process and broadcast to the
+ * others.
+ *
+ * The read is collective over the file communicator, only the first process of
+ * each replication group selects the data, the others select none.
+ *
+ * \param ctx the context in which to operate
+ * \param comms the communicators of the file opened in parallel
+ * \param h5_set the dataset to read
+ * \param h5_mem_type the type of the data in memory
+ * \param h5_mem_space the memory dataspace with the memory selection applied
+ * \param h5_file_space the dataset dataspace with the dataset selection applied
+ * \param read_lst the transfer properties used to read
+ * \param per_node whether the data is read once per node instead of once for
+ *        the whole file communicator
+ * \param data where to store the data
+ */
+void replicated_read(
+	PDI::Context& ctx,
+	File_communicators& comms,
+	hid_t h5_set,
+	hid_t h5_mem_type,
+	hid_t h5_mem_space,
+	hid_t h5_file_space,
+	hid_t read_lst,
+	bool per_node,
+	void* data
+);
+
+/** Checks whether this process owns the replicated data of a file opened in
+ * parallel, i.e. whether it is the one that writes it
+ *
+ * \param comms the communicators of the file opened in parallel
+ * \return whether this process is the first of the file communicator
+ */
+bool replicated_owner(File_communicators& comms);
+
+} // namespace decl_hdf5
+
+#endif // H5_HAVE_PARALLEL
+
+#endif // DECL_HDF5_REPLICATION_H_
@@ -28,6 +28,7 @@
 #endif
 
 #include <algorithm>
+#include <array>
 #include <string>
 
 #include <pdi/context.h>
@@ -43,9 +44,40 @@ using PDI::Context;
 using PDI::each;
 using PDI::opt_each;
 using PDI::to_string;
+using std::array;
+using std::copy;
 using std::string;
-using std::transform;
-using std::vector;
+
+namespace {
+
+/** Computes the number of points selected in each dimension of a dataspace
+ *
+ * \param h5_space the dataspace
+ * \param rank the rank of the dataspace
+ * \param shape where to store the number of points selected in each dimension
+ */
+void selected_shape(hid_t h5_space, int rank, hsize_t* shape)
+{
+	array<hsize_t, H5S_MAX_RANK> start;
+	if (H5S_SEL_HYPERSLABS == H5Sget_select_type(h5_space)) {
+		htri_t regular = H5Sis_regular_hyperslab(h5_space);
+		if (0 > regular) decl_hdf5::handle_hdf5_err();
+		if (regular) {
+			array<hsize_t, H5S_MAX_RANK> stride, count, block;
+			if (0 > H5Sget_regular_hyperslab(h5_space, &start[0], &stride[0], &count[0], &block[0])) decl_hdf5::handle_hdf5_err();
+			for (int dim = 0; dim < rank; ++dim) {
+				shape[dim] = count[dim] * block[dim];
+			}
+			return;
+		}
+	}
+	if (0 > H5Sget_select_bounds(h5_space, &start[0], shape)) decl_hdf5::handle_hdf5_err();
+	for (int dim = 0; dim < rank; ++dim) {
+		shape[dim] = shape[dim] - start[dim] + 1;
+	}
+}
+
+} // namespace
 
 namespace decl_hdf5 {
 
@@ -58,58 +90,112 @@ Selection::Selection(PC_tree_t tree)
 			opt_each(value, [&](PC_tree_t size) { m_size.emplace_back(to_string(size)); });
 		} else if (key == "start") {
 			opt_each(value, [&](PC_tree_t start) { m_start.emplace_back(to_string(start)); });
+		} else if (key == "stride") {
+			opt_each(value, [&](PC_tree_t stride) { m_stride.emplace_back(to_string(stride)); });
+		} else if (key == "block") {
+			opt_each(value, [&](PC_tree_t block) { m_block.emplace_back(to_string(block)); });
 		} else {
 			throw Config_error{key_tree, "Invalid configuration key in selection: `{}'", key};
 		}
 	});
 }
 
-void Selection::apply(Context& ctx, hid_t h5_space, hid_t dflt_space) const
+hsize_t Selection::apply(Context& ctx, hid_t h5_space, hid_t dflt_space) const
 {
 	int rank = H5Sget_simple_extent_ndims(h5_space);
 	if (0 > rank) handle_hdf5_err();
-	if (0 == rank) return;
+	if (0 == rank) return 1;
+
+	// the selection is computed in place, without allocation
+	array<hsize_t, H5S_MAX_RANK> h5_start, h5_stride, h5_count, h5_block;
+	if (0 > H5Sget_select_bounds(h5_space, &h5_start[0], &h5_count[0])) handle_hdf5_err();
+	for (int dim = 0; dim < rank; ++dim) {
+		h5_count[dim] = h5_count[dim] - h5_start[dim] + 1;
+		h5_stride[dim] = 1;
+		h5_block[dim] = 1;
+	}
+
+	if (!m_block.empty()) {
+		if (m_block.size() != static_cast<size_t>(rank)) {
+			throw Config_error{PC_get(m_selection_tree, ".block"), "Invalid selection: {} block in {} array", m_block.size(), rank};
+		}
+		for (int dim = 0; dim < rank; ++dim) {
+			long block = m_block[dim].to_long(ctx);
+			if (block < 1) {
+				throw Config_error{PC_get(m_selection_tree, ".block"), "Invalid selection: block {} smaller than 1 in dimension {}", block, dim};
+			}
+			h5_block[dim] = block;
+		}
+	}
 
-	vector<hsize_t> h5_subsize(rank);
-	vector<hsize_t> h5_start(rank);
-	if (0 > H5Sget_select_bounds(h5_space, &h5_start[0], &h5_subsize[0])) handle_hdf5_err();
-	transform(h5_start.begin(), h5_start.end(), h5_subsize.begin(), h5_subsize.begin(), [](hsize_t start, hsize_t end) { return end - start + 1; });
+	if (!m_stride.empty()) {
+		if (m_stride.size() != static_cast<size_t>(rank)) {
+			throw Config_error{PC_get(m_selection_tree, ".stride"), "Invalid selection: {} stride in {} array", m_stride.size(), rank};
+		}
+		for (int dim = 0; dim < rank; ++dim) {
+			long stride = m_stride[dim].to_long(ctx);
+			if (stride < 1) {
+				throw Config_error{PC_get(m_selection_tree, ".stride"), "Invalid selection: stride {} smaller than 1 in dimension {}", stride, dim};
+			}
+			h5_stride[dim] = stride;
+			if (h5_stride[dim] < h5_block[dim]) {
+				throw Config_error{
+					PC_get(m_selection_tree, ".stride"),
+					"Invalid selection: stride {} smaller than block {} in dimension {}",
+					h5_stride[dim],
+					h5_block[dim],
+					dim
+				};
+			}
+		}
+	} else {
+		// contiguous blocks by default
+		copy(h5_block.begin(), h5_block.begin() + rank, h5_stride.begin());
+	}
 
 	if (!m_size.empty()) {
 		if (m_size.size() != static_cast<size_t>(rank)) {
 			throw Config_error{PC_get(m_selection_tree, ".size"), "Invalid selection: {} selection in {} array", m_size.size(), rank};
 		}
-		for (int size_id = 0; size_id < rank; ++size_id) {
-			h5_subsize[size_id] = m_size[size_id].to_long(ctx);
+		for (int dim = 0; dim < rank; ++dim) {
+			h5_count[dim] = m_size[dim].to_long(ctx);
 		}
-	} else if (dflt_space != -1) {
-		int dflt_rank = H5Sget_simple_extent_ndims(dflt_space);
-		if (dflt_rank != rank) {
-			if (H5Sget_select_npoints(h5_space) == H5Sget_select_npoints(dflt_space)) {
-				// if ranks differ but number of elements are the same, select whole dataset
+	} else {
+		if (dflt_space != -1) {
+			int dflt_rank = H5Sget_simple_extent_ndims(dflt_space);
+			if (dflt_rank != rank) {
+				if (H5Sget_select_npoints(h5_space) == H5Sget_select_npoints(dflt_space)) {
+					// if ranks differ but number of elements are the same, select whole dataset
+				} else {
+					throw Config_error{m_selection_tree, "Invalid default selection: {} selection in {} array", dflt_rank, rank};
+				}
 			} else {
-				throw Config_error{m_selection_tree, "Invalid default selection: {} selection in {} array", dflt_rank, rank};
+				// ranks match, get memory size selection as dataset size selection
+				selected_shape(dflt_space, rank, &h5_count[0]);
 			}
-		} else {
-			// ranks match, get memory size selection as dataset size selection
-			vector<hsize_t> dflt_start(rank);
-			if (0 > H5Sget_select_bounds(dflt_space, &dflt_start[0], &h5_subsize[0])) handle_hdf5_err();
-			transform(dflt_start.begin(), dflt_start.end(), h5_subsize.begin(), h5_subsize.begin(), [](hsize_t start, hsize_t end) {
-				return end - start + 1;
-			});
+		}
+		// as many blocks as needed to select the same number of points
+		for (int dim = 0; dim < rank; ++dim) {
+			h5_count[dim] /= h5_block[dim];
 		}
 	}
 
 	if (!m_start.empty()) {
 		if (m_start.size() != static_cast<size_t>(rank)) {
-			throw Config_error{PC_get(m_selection_tree, ".start"), "Invalid selection: {} start in {} array", m_size.size(), rank};
+			throw Config_error{PC_get(m_selection_tree, ".start"), "Invalid selection: {} start in {} array", m_start.size(), rank};
 		}
-		for (int size_id = 0; size_id < rank; ++size_id) {
-			h5_start[size_id] += m_start[size_id].to_long(ctx);
+		for (int dim = 0; dim < rank; ++dim) {
+			h5_start[dim] += m_start[dim].to_long(ctx);
 		}
 	}
 
-	if (0 > H5Sselect_hyperslab(h5_space, H5S_SELECT_SET, &h5_start[0], NULL, &h5_subsize[0], NULL)) handle_hdf5_err();
+	if (0 > H5Sselect_hyperslab(h5_space, H5S_SELECT_SET, &h5_start[0], &h5_stride[0], &h5_count[0], &h5_block[0])) handle_hdf5_err();
+
+	hsize_t nb_points = 1;
+	for (int dim = 0; dim < rank; ++dim) {
+		nb_points *= h5_count[dim] * h5_block[dim];
+	}
+	return nb_points;
 }
 
 } // namespace decl_hdf5
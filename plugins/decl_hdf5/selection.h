@@ -26,6 +26,11 @@
 #ifndef DECL_HDF5_SELECTION_H_
 #define DECL_HDF5_SELECTION_H_
 
+#include <hdf5.h>
+#ifdef H5_HAVE_PARALLEL
+#include <mpi.h>
+#endif
+
 #include <vector>
 
 #include <paraconf.h>
@@ -42,12 +47,18 @@ class Selection
 	/// The tree representing the selection
 	PC_tree_t m_selection_tree;
 
-	/// The size of the selection in each dimension or empty for default
+	/// The number of blocks of the selection in each dimension or empty for default
 	std::vector<PDI::Expression> m_size;
 
 	/// The first included point in each dimension or empty for default
 	std::vector<PDI::Expression> m_start;
 
+	/// The distance between the start of two blocks in each dimension or empty for default
+	std::vector<PDI::Expression> m_stride;
+
+	/// The size of a block in each dimension or empty for default
+	std::vector<PDI::Expression> m_block;
+
 public:
 	/** The default constructor for an empty selection (everything selected)
 	 */
@@ -55,19 +66,21 @@ public:
 
 	/** Builds a selection from a yaml tree.
 	 *
-	 * The tree should be a mapping with two optional keys:
+	 * The tree should be a mapping with four optional keys:
 	 * - size: a list (or scalar in 1D) of expressions or nothing for default
 	 * - start: a list (or scalar in 1D) of expressions or nothing for default
 	 *   if absent
+	 * - stride: a list (or scalar in 1D) of expressions or nothing for default
+	 * - block: a list (or scalar in 1D) of expressions or nothing for default
 	 *
 	 * \param tree the tree representing the selection.
 	 */
 	Selection(PC_tree_t tree);
 
-	/** Accesses the size of the selection in each dimension or nothing for
-	 * default.
+	/** Accesses the number of blocks of the selection in each dimension or
+	 * nothing for default.
 	 *
-	 * \return the size of the selection in each dimension or nothing for default
+	 * \return the number of blocks of the selection in each dimension or nothing for default
 	 */
 	const std::vector<PDI::Expression>& size() const { return m_size; }
 
@@ -78,6 +91,19 @@ public:
 	 */
 	const std::vector<PDI::Expression>& start() const { return m_start; }
 
+	/** Accesses the distance between the start of two blocks in each dimension
+	 * or nothing for default.
+	 *
+	 * \return The distance between the start of two blocks in each dimension or nothing for default
+	 */
+	const std::vector<PDI::Expression>& stride() const { return m_stride; }
+
+	/** Accesses the size of a block in each dimension or nothing for default.
+	 *
+	 * \return The size of a block in each dimension or nothing for default
+	 */
+	const std::vector<PDI::Expression>& block() const { return m_block; }
+
 	/** Accesses the first included point in each dimension or nothing for
 	 * default.
 	 *
@@ -89,8 +115,9 @@ public:
 	 * \param ctx the context in which to operate
 	 * \param h5_space the space to modify
 	 * \param dflt_space a space to match if the selection is empty
+	 * \return the number of points selected
 	 */
-	void apply(PDI::Context& ctx, hid_t h5_space, hid_t dflt_space = -1) const;
+	hsize_t apply(PDI::Context& ctx, hid_t h5_space, hid_t dflt_space = -1) const;
 };
 
 } // namespace decl_hdf5
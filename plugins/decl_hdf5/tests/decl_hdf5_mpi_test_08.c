@@ -0,0 +1,139 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include <mpi.h>
+#include <paraconf.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <pdi.h>
+
+#define IMX 5
+#define JMX 4
+#define DIM 2
+
+const char* CONFIG_YAML
+	= "logging: trace                                                      \n"
+	  "metadata:                                                           \n"
+	  "  ni: int                                                           \n"
+	  "  nj: int                                                           \n"
+	  "  istart: int                                                       \n"
+	  "  jstart: int                                                       \n"
+	  "  rank: int                                                         \n"
+	  "data:                                                               \n"
+	  "  values: { type: array, subtype: int, size: [$nj, $ni] }           \n"
+	  "  global_values: { type: array, subtype: int, size: [8, 10] }       \n"
+	  "plugins:                                                            \n"
+	  "  mpi:                                                              \n"
+	  "  decl_hdf5:                                                        \n"
+	  "   - file: decl_hdf5_mpi_test_08_C_${rank}.h5                       \n"
+	  "     collision_policy: replace                                       \n"
+	  "     on_event: write                                                 \n"
+	  "     write:                                                          \n"
+	  "       values:                                                       \n"
+	  "         virtual_dataset:                                            \n"
+	  "           file: vds/decl_hdf5_mpi_test_08_C.h5                      \n"
+	  "           communicator: $MPI_COMM_WORLD                             \n"
+	  "           start: [$jstart, $istart]                                 \n"
+	  "   - file: decl_hdf5_mpi_test_08_C.h5                                \n"
+	  "     on_event: read                                                  \n"
+	  "     read:                                                           \n"
+	  "       global_values: { dataset: values }                            \n";
+
+int main(int argc, char* argv[])
+{
+	int ni = IMX, nj = JMX;
+	int values[JMX][IMX];
+	int global_values[2 * JMX][2 * IMX];
+	int dims[DIM] = {2, 2}, coord[DIM], periodic[DIM] = {0, 0};
+	MPI_Comm comm2D;
+
+	MPI_Init(&argc, &argv);
+	PC_tree_t conf = PC_parse_string(CONFIG_YAML);
+	PDI_init(conf);
+	int rank, size;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+	if (size != 4) {
+		printf("Run on 4 procs only.");
+		MPI_Abort(MPI_COMM_WORLD, -1);
+	}
+	MPI_Cart_create(MPI_COMM_WORLD, DIM, dims, periodic, 0, &comm2D);
+	MPI_Cart_coords(comm2D, rank, DIM, coord);
+	int istart = coord[1] * ni;
+	int jstart = coord[0] * nj;
+
+	// the virtual dataset is read from its own directory, its sources must be found from there
+	if (rank == 0) {
+		mkdir("vds", 0755);
+	}
+	MPI_Barrier(MPI_COMM_WORLD);
+
+	PDI_expose("rank", &rank, PDI_OUT);
+	PDI_expose("ni", &ni, PDI_OUT);
+	PDI_expose("nj", &nj, PDI_OUT);
+	PDI_expose("istart", &istart, PDI_OUT);
+	PDI_expose("jstart", &jstart, PDI_OUT);
+
+	// the virtual dataset is only built on the first iteration, the decomposition does not change
+	for (int iteration = 0; iteration < 2; ++iteration) {
+		for (int j = 0; j < nj; ++j) {
+			for (int i = 0; i < ni; ++i) {
+				values[j][i] = iteration * 1000 + (jstart + j) * 100 + istart + i;
+			}
+		}
+		PDI_multi_expose("write", "values", values, PDI_OUT, NULL);
+
+		// wait for the virtual dataset and all the sources
+		MPI_Barrier(MPI_COMM_WORLD);
+		for (int j = 0; j < 2 * nj; ++j) {
+			for (int i = 0; i < 2 * ni; ++i) {
+				global_values[j][i] = -1;
+			}
+		}
+		if (chdir("vds")) {
+			perror("vds");
+			MPI_Abort(MPI_COMM_WORLD, -1);
+		}
+		PDI_multi_expose("read", "global_values", global_values, PDI_IN, NULL);
+		if (chdir("..")) {
+			perror("..");
+			MPI_Abort(MPI_COMM_WORLD, -1);
+		}
+		for (int j = 0; j < 2 * nj; ++j) {
+			for (int i = 0; i < 2 * ni; ++i) {
+				if (global_values[j][i] != iteration * 1000 + j * 100 + i) {
+					fprintf(stderr, "[%d, %d] expected %d, got %d\n", j, i, iteration * 1000 + j * 100 + i, global_values[j][i]);
+					MPI_Abort(MPI_COMM_WORLD, -1);
+				}
+			}
+		}
+		// the sources are rewritten by the next iteration
+		MPI_Barrier(MPI_COMM_WORLD);
+	}
+
+	PDI_finalize();
+	PC_tree_destroy(&conf);
+	MPI_Finalize();
+}
@@ -0,0 +1,96 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+#include <mpi.h>
+#include <paraconf.h>
+#include <stdio.h>
+#include <pdi.h>
+
+#define SIZE 16
+
+const char* CONFIG_YAML
+	= "logging: trace                                                      \n"
+	  "data:                                                               \n"
+	  "  table: { type: array, subtype: double, size: 16 }                 \n"
+	  "  table_read: { type: array, subtype: double, size: 20 }            \n"
+	  "  table_node: { type: array, subtype: double, size: 16 }            \n"
+	  "plugins:                                                            \n"
+	  "  mpi:                                                              \n"
+	  "  decl_hdf5:                                                        \n"
+	  "   - file: decl_hdf5_mpi_test_09_C.h5                                \n"
+	  "     communicator: $MPI_COMM_WORLD                                   \n"
+	  "     collision_policy: replace                                       \n"
+	  "     on_event: write                                                 \n"
+	  "     write: [table]                                                  \n"
+	  "   - file: decl_hdf5_mpi_test_09_C.h5                                \n"
+	  "     communicator: $MPI_COMM_WORLD                                   \n"
+	  "     on_event: read                                                  \n"
+	  "     read:                                                           \n"
+	  "       table_read:                                                   \n"
+	  "         dataset: table                                              \n"
+	  "         replicated: true                                            \n"
+	  "         memory_selection: { size: 16, start: 2 }                    \n"
+	  "       table_node: { dataset: table, replicated: node }              \n";
+
+int main(int argc, char* argv[])
+{
+	double table[SIZE];
+	double table_read[SIZE + 4];
+	double table_node[SIZE];
+
+	MPI_Init(&argc, &argv);
+	PC_tree_t conf = PC_parse_string(CONFIG_YAML);
+	PDI_init(conf);
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	for (int i = 0; i < SIZE; ++i) {
+		table[i] = i * 1.5;
+	}
+	PDI_multi_expose("write", "table", table, PDI_OUT, NULL);
+
+	for (int i = 0; i < SIZE + 4; ++i) {
+		table_read[i] = -1;
+	}
+	for (int i = 0; i < SIZE; ++i) {
+		table_node[i] = -1;
+	}
+	PDI_multi_expose("read", "table_read", table_read, PDI_IN, "table_node", table_node, PDI_IN, NULL);
+	for (int i = 0; i < SIZE + 4; ++i) {
+		double expected = (i < 2 || i >= SIZE + 2) ? -1 : (i - 2) * 1.5;
+		if (table_read[i] != expected) {
+			fprintf(stderr, "[%d] table_read[%d] expected %f, got %f\n", rank, i, expected, table_read[i]);
+			MPI_Abort(MPI_COMM_WORLD, -1);
+		}
+	}
+	for (int i = 0; i < SIZE; ++i) {
+		if (table_node[i] != i * 1.5) {
+			fprintf(stderr, "[%d] table_node[%d] expected %f, got %f\n", rank, i, i * 1.5, table_node[i]);
+			MPI_Abort(MPI_COMM_WORLD, -1);
+		}
+	}
+
+	PDI_finalize();
+	PC_tree_destroy(&conf);
+	MPI_Finalize();
+}
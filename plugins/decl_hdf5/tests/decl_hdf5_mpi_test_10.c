@@ -0,0 +1,88 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+#include <mpi.h>
+#include <paraconf.h>
+#include <stdio.h>
+#include <pdi.h>
+
+#define SIZE 8
+
+const char* CONFIG_YAML
+	= "logging: trace                                                      \n"
+	  "data:                                                               \n"
+	  "  time: double                                                      \n"
+	  "  params: { type: array, subtype: int, size: 8 }                    \n"
+	  "plugins:                                                            \n"
+	  "  mpi:                                                              \n"
+	  "  decl_hdf5:                                                        \n"
+	  "   - file: decl_hdf5_mpi_test_10_C.h5                                \n"
+	  "     communicator: $MPI_COMM_WORLD                                   \n"
+	  "     collision_policy: replace                                       \n"
+	  "     on_event: write                                                 \n"
+	  "     write:                                                          \n"
+	  "       time: { replicated: true }                                    \n"
+	  "       params: { replicated: true }                                  \n"
+	  "   - file: decl_hdf5_mpi_test_10_C.h5                                \n"
+	  "     communicator: $MPI_COMM_WORLD                                   \n"
+	  "     on_event: read                                                  \n"
+	  "     read: [time, params]                                            \n";
+
+int main(int argc, char* argv[])
+{
+	double time;
+	int params[SIZE];
+
+	MPI_Init(&argc, &argv);
+	PC_tree_t conf = PC_parse_string(CONFIG_YAML);
+	PDI_init(conf);
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	// only the values of the first process are written
+	time = 1.5 + rank;
+	for (int i = 0; i < SIZE; ++i) {
+		params[i] = rank * 100 + i;
+	}
+	PDI_multi_expose("write", "time", &time, PDI_OUT, "params", params, PDI_OUT, NULL);
+
+	time = -1;
+	for (int i = 0; i < SIZE; ++i) {
+		params[i] = -1;
+	}
+	PDI_multi_expose("read", "time", &time, PDI_IN, "params", params, PDI_IN, NULL);
+	if (time != 1.5) {
+		fprintf(stderr, "[%d] time expected 1.5, got %f\n", rank, time);
+		MPI_Abort(MPI_COMM_WORLD, -1);
+	}
+	for (int i = 0; i < SIZE; ++i) {
+		if (params[i] != i) {
+			fprintf(stderr, "[%d] params[%d] expected %d, got %d\n", rank, i, i, params[i]);
+			MPI_Abort(MPI_COMM_WORLD, -1);
+		}
+	}
+
+	PDI_finalize();
+	PC_tree_destroy(&conf);
+	MPI_Finalize();
+}
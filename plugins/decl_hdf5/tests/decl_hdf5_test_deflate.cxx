@@ -22,11 +22,15 @@
  * THE SOFTWARE.
  ******************************************************************************/
 
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <gtest/gtest.h>
 #include <hdf5.h>
 #include <paraconf.h>
 #include <time.h>
 #include <unistd.h>
+#include <vector>
 #include <pdi.h>
 
 TEST(decl_hdf5_deflate, no_deflate)
@@ -266,3 +270,340 @@ TEST(decl_hdf5_deflate, deflate_level9)
 	H5Dclose(dataset_id);
 	H5Fclose(file_id);
 }
+
+TEST(decl_hdf5_deflate, deflate_auto_chunking)
+{
+	const char* CONFIG_YAML
+		= "logging: trace                                                          \n"
+		  "metadata:                                                               \n"
+		  "  pb_size: int                                                          \n"
+		  "data:                                                                   \n"
+		  "  matrix_data:                                                          \n"
+		  "    size: ['$pb_size','$pb_size']                                       \n"
+		  "    type: array                                                         \n"
+		  "    subtype: double                                                     \n"
+		  "plugins:                                                                \n"
+		  "  decl_hdf5:                                                            \n"
+		  "    - file: decl_hdf5_test_comp_auto.h5                                 \n"
+		  "      deflate: 1                                                        \n"
+		  "      write:                                                            \n"
+		  "        matrix_data:                                                    \n"
+		  "          - dataset: default_target                                     \n"
+		  "          - dataset: small_target                                       \n"
+		  "            chunking: auto                                              \n"
+		  "            chunking_target_size: 65536                                 \n";
+
+	remove("decl_hdf5_test_comp_auto.h5");
+
+	PC_tree_t conf = PC_parse_string(CONFIG_YAML);
+	PDI_init(conf);
+	size_t N = 1000;
+	PDI_expose("pb_size", &N, PDI_OUT);
+
+	double* matrix_data = new double[N * N];
+	for (int i = 0; i < N * N; i++) {
+		matrix_data[i] = i;
+	}
+	PDI_expose("matrix_data", matrix_data, PDI_OUT);
+
+	PDI_finalize();
+	PC_tree_destroy(&conf);
+
+	delete[] matrix_data;
+
+	hid_t file_id = H5Fopen("decl_hdf5_test_comp_auto.h5", H5F_ACC_RDONLY, H5P_DEFAULT);
+
+	// 1000x1000 doubles halved down to 1MiB
+	hid_t dataset_id = H5Dopen2(file_id, "default_target", H5P_DEFAULT);
+	hid_t plist_id = H5Dget_create_plist(dataset_id);
+	unsigned int compression_level;
+	size_t cd_nelmts = 1;
+	herr_t status = H5Pget_filter_by_id2(plist_id, H5Z_FILTER_DEFLATE, NULL, &cd_nelmts, &compression_level, 0, NULL, NULL);
+	ASSERT_GE(status, 0);
+	ASSERT_EQ(compression_level, 1);
+	ASSERT_EQ(H5Pget_layout(plist_id), H5D_CHUNKED);
+	hsize_t chunk[2];
+	ASSERT_EQ(H5Pget_chunk(plist_id, 2, chunk), 2);
+	EXPECT_EQ(chunk[0], 250);
+	EXPECT_EQ(chunk[1], 500);
+	H5Pclose(plist_id);
+	H5Dclose(dataset_id);
+
+	// 1000x1000 doubles halved down to 64KiB
+	dataset_id = H5Dopen2(file_id, "small_target", H5P_DEFAULT);
+	plist_id = H5Dget_create_plist(dataset_id);
+	ASSERT_EQ(H5Pget_chunk(plist_id, 2, chunk), 2);
+	EXPECT_EQ(chunk[0], 63);
+	EXPECT_EQ(chunk[1], 125);
+	H5Pclose(plist_id);
+	H5Dclose(dataset_id);
+
+	H5Fclose(file_id);
+}
+
+TEST(decl_hdf5_deflate, deflate_shuffle_threads)
+{
+	const char* CONFIG_YAML
+		= "logging: trace                                                          \n"
+		  "metadata:                                                               \n"
+		  "  pb_size: int                                                          \n"
+		  "data:                                                                   \n"
+		  "  matrix_data:                                                          \n"
+		  "    size: ['$pb_size','$pb_size']                                       \n"
+		  "    type: array                                                         \n"
+		  "    subtype: double                                                     \n"
+		  "plugins:                                                                \n"
+		  "  decl_hdf5:                                                            \n"
+		  "    - file: decl_hdf5_test_comp_threads.h5                              \n"
+		  "      deflate: 6                                                        \n"
+		  "      shuffle: 1                                                        \n"
+		  "      write:                                                            \n"
+		  "        matrix_data:                                                    \n"
+		  "          - dataset: hdf5_compressed                                    \n"
+		  "            chunking: [256, 256]                                        \n"
+		  "          - dataset: threads_compressed                                 \n"
+		  "            chunking: [256, 256]                                        \n"
+		  "            compression_threads: 4                                      \n";
+
+	remove("decl_hdf5_test_comp_threads.h5");
+
+	PC_tree_t conf = PC_parse_string(CONFIG_YAML);
+	PDI_init(conf);
+	size_t N = 1000;
+	PDI_expose("pb_size", &N, PDI_OUT);
+
+	double* matrix_data = new double[N * N];
+	for (int i = 0; i < N * N; i++) {
+		matrix_data[i] = i % 1234;
+	}
+	PDI_expose("matrix_data", matrix_data, PDI_OUT);
+	// the second write reuses the compression threads of the first one
+	PDI_expose("matrix_data", matrix_data, PDI_OUT);
+
+	PDI_finalize();
+	PC_tree_destroy(&conf);
+
+	hid_t file_id = H5Fopen("decl_hdf5_test_comp_threads.h5", H5F_ACC_RDONLY, H5P_DEFAULT);
+	hid_t hdf5_set = H5Dopen2(file_id, "hdf5_compressed", H5P_DEFAULT);
+	hid_t threads_set = H5Dopen2(file_id, "threads_compressed", H5P_DEFAULT);
+
+	hid_t plist_id = H5Dget_create_plist(threads_set);
+	ASSERT_EQ(H5Pget_nfilters(plist_id), 2);
+	ASSERT_EQ(H5Pget_filter2(plist_id, 0, NULL, NULL, NULL, 0, NULL, NULL), H5Z_FILTER_SHUFFLE);
+	ASSERT_EQ(H5Pget_filter2(plist_id, 1, NULL, NULL, NULL, 0, NULL, NULL), H5Z_FILTER_DEFLATE);
+	H5Pclose(plist_id);
+
+	// chunks (including the partial edge ones) are byte-identical to the HDF5 compressed ones
+	hsize_t offsets[][2] = {{0, 0}, {256, 512}, {768, 768}};
+	for (auto&& offset: offsets) {
+		hsize_t hdf5_size, threads_size;
+		ASSERT_GE(H5Dget_chunk_storage_size(hdf5_set, offset, &hdf5_size), 0);
+		ASSERT_GE(H5Dget_chunk_storage_size(threads_set, offset, &threads_size), 0);
+		ASSERT_EQ(hdf5_size, threads_size);
+		std::vector<unsigned char> hdf5_chunk(hdf5_size), threads_chunk(threads_size);
+		uint32_t filter_mask;
+		ASSERT_GE(H5Dread_chunk(hdf5_set, H5P_DEFAULT, offset, &filter_mask, hdf5_chunk.data()), 0);
+		ASSERT_GE(H5Dread_chunk(threads_set, H5P_DEFAULT, offset, &filter_mask, threads_chunk.data()), 0);
+		ASSERT_EQ(filter_mask, 0);
+		ASSERT_EQ(hdf5_chunk, threads_chunk);
+	}
+
+	// and the data can be read back by HDF5
+	double* read_data = new double[N * N];
+	ASSERT_GE(H5Dread(threads_set, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, read_data), 0);
+	for (int i = 0; i < N * N; i++) {
+		ASSERT_EQ(read_data[i], matrix_data[i]);
+	}
+
+	delete[] read_data;
+	delete[] matrix_data;
+	H5Dclose(threads_set);
+	H5Dclose(hdf5_set);
+	H5Fclose(file_id);
+}
+
+TEST(decl_hdf5_deflate, negative_threads)
+{
+	const char* CONFIG_YAML
+		= "logging: trace                                                          \n"
+		  "data:                                                                   \n"
+		  "  matrix_data: { size: [16, 16], type: array, subtype: double }         \n"
+		  "plugins:                                                                \n"
+		  "  decl_hdf5:                                                            \n"
+		  "    - file: decl_hdf5_test_comp_negative_threads.h5                     \n"
+		  "      deflate: 6                                                        \n"
+		  "      compression_threads: -1                                           \n"
+		  "      write:                                                            \n"
+		  "        matrix_data:                                                    \n"
+		  "          chunking: [8, 8]                                              \n";
+
+	remove("decl_hdf5_test_comp_negative_threads.h5");
+
+	PC_tree_t conf = PC_parse_string(CONFIG_YAML);
+	PDI_init(conf);
+
+	double matrix_data[16][16] = {};
+	PDI_errhandler(PDI_NULL_HANDLER);
+	EXPECT_EQ(PDI_ERR_VALUE, PDI_expose("matrix_data", matrix_data, PDI_OUT));
+	PDI_errhandler(PDI_ASSERT_HANDLER);
+
+	PDI_finalize();
+	PC_tree_destroy(&conf);
+}
+
+TEST(decl_hdf5_deflate, precision_keepbits)
+{
+	const char* CONFIG_YAML
+		= "logging: trace                                                          \n"
+		  "metadata:                                                               \n"
+		  "  pb_size: int                                                          \n"
+		  "data:                                                                   \n"
+		  "  matrix_data:                                                          \n"
+		  "    size: ['$pb_size','$pb_size']                                       \n"
+		  "    type: array                                                         \n"
+		  "    subtype: double                                                     \n"
+		  "  float_data:                                                           \n"
+		  "    size: ['$pb_size','$pb_size']                                       \n"
+		  "    type: array                                                         \n"
+		  "    subtype: float                                                      \n"
+		  "    +decl_hdf5.keepbits: 7                                              \n"
+		  "    +decl_hdf5.rounding: truncate                                       \n"
+		  "plugins:                                                                \n"
+		  "  decl_hdf5:                                                            \n"
+		  "    - file: decl_hdf5_test_keepbits.h5                                  \n"
+		  "      deflate: 6                                                        \n"
+		  "      write:                                                            \n"
+		  "        matrix_data:                                                    \n"
+		  "          - dataset: full                                               \n"
+		  "          - dataset: rounded                                            \n"
+		  "            precision: { keepbits: 10 }                                 \n"
+		  "        float_data:                                                     \n";
+
+	remove("decl_hdf5_test_keepbits.h5");
+
+	PC_tree_t conf = PC_parse_string(CONFIG_YAML);
+	PDI_init(conf);
+	size_t N = 500;
+	PDI_expose("pb_size", &N, PDI_OUT);
+
+	std::vector<double> matrix_data(N * N);
+	std::vector<float> float_data(N * N);
+	for (int i = 0; i < N * N; i++) {
+		matrix_data[i] = 1.0 / (i + 1) - 1e-3 * i;
+		float_data[i] = matrix_data[i];
+	}
+	PDI_expose("matrix_data", matrix_data.data(), PDI_OUT);
+	PDI_expose("float_data", float_data.data(), PDI_OUT);
+
+	PDI_finalize();
+	PC_tree_destroy(&conf);
+
+	hid_t file_id = H5Fopen("decl_hdf5_test_keepbits.h5", H5F_ACC_RDONLY, H5P_DEFAULT);
+	hid_t full_set = H5Dopen2(file_id, "full", H5P_DEFAULT);
+	hid_t rounded_set = H5Dopen2(file_id, "rounded", H5P_DEFAULT);
+	hid_t float_set = H5Dopen2(file_id, "float_data", H5P_DEFAULT);
+
+	// the zeroed low bits are deflated
+	ASSERT_LT(H5Dget_storage_size(rounded_set) * 2, H5Dget_storage_size(full_set));
+
+	// double values are rounded to nearest on 10 mantissa bits
+	std::vector<double> rounded(N * N);
+	ASSERT_GE(H5Dread(rounded_set, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, rounded.data()), 0);
+	for (int i = 0; i < N * N; i++) {
+		uint64_t bits;
+		memcpy(&bits, &rounded[i], sizeof(bits));
+		ASSERT_EQ(bits & ((uint64_t{1} << 42) - 1), 0);
+		ASSERT_LE(std::fabs(rounded[i] - matrix_data[i]), std::fabs(matrix_data[i]) * std::ldexp(1.0, -11));
+	}
+
+	// float values are truncated on 7 mantissa bits
+	std::vector<float> truncated(N * N);
+	ASSERT_GE(H5Dread(float_set, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, truncated.data()), 0);
+	for (int i = 0; i < N * N; i++) {
+		uint32_t bits;
+		memcpy(&bits, &truncated[i], sizeof(bits));
+		ASSERT_EQ(bits & ((uint32_t{1} << 16) - 1), 0);
+		ASSERT_LE(std::fabs(truncated[i]), std::fabs(float_data[i]));
+		ASSERT_LE(std::fabs(truncated[i] - float_data[i]), std::fabs(float_data[i]) * std::ldexp(1.0, -7));
+	}
+
+	H5Dclose(float_set);
+	H5Dclose(rounded_set);
+	H5Dclose(full_set);
+	H5Fclose(file_id);
+}
+
+TEST(decl_hdf5_deflate, precision_filters)
+{
+	const char* CONFIG_YAML
+		= "logging: trace                                                          \n"
+		  "metadata:                                                               \n"
+		  "  pb_size: int                                                          \n"
+		  "data:                                                                   \n"
+		  "  int_data:                                                             \n"
+		  "    size: '$pb_size'                                                    \n"
+		  "    type: array                                                         \n"
+		  "    subtype: int                                                        \n"
+		  "  double_data:                                                          \n"
+		  "    size: '$pb_size'                                                    \n"
+		  "    type: array                                                         \n"
+		  "    subtype: double                                                     \n"
+		  "    +decl_hdf5.scaleoffset: 2                                           \n"
+		  "plugins:                                                                \n"
+		  "  decl_hdf5:                                                            \n"
+		  "    - file: decl_hdf5_test_precision.h5                                 \n"
+		  "      write:                                                            \n"
+		  "        int_data:                                                       \n"
+		  "          precision: { nbit: 12 }                                       \n"
+		  "        double_data:                                                    \n";
+
+	remove("decl_hdf5_test_precision.h5");
+
+	PC_tree_t conf = PC_parse_string(CONFIG_YAML);
+	PDI_init(conf);
+	int N = 1000;
+	PDI_expose("pb_size", &N, PDI_OUT);
+
+	std::vector<int> int_data(N);
+	std::vector<double> double_data(N);
+	for (int i = 0; i < N; i++) {
+		int_data[i] = i - 500;
+		double_data[i] = i * 0.123456;
+	}
+	PDI_expose("int_data", int_data.data(), PDI_OUT);
+	PDI_expose("double_data", double_data.data(), PDI_OUT);
+
+	PDI_finalize();
+	PC_tree_destroy(&conf);
+
+	hid_t file_id = H5Fopen("decl_hdf5_test_precision.h5", H5F_ACC_RDONLY, H5P_DEFAULT);
+
+	// integers are stored on 12 bits with the N-bit filter
+	hid_t int_set = H5Dopen2(file_id, "int_data", H5P_DEFAULT);
+	hid_t plist_id = H5Dget_create_plist(int_set);
+	ASSERT_EQ(H5Pget_nfilters(plist_id), 1);
+	ASSERT_EQ(H5Pget_filter2(plist_id, 0, NULL, NULL, NULL, 0, NULL, NULL), H5Z_FILTER_NBIT);
+	H5Pclose(plist_id);
+	hid_t type_id = H5Dget_type(int_set);
+	ASSERT_EQ(H5Tget_precision(type_id), 12);
+	H5Tclose(type_id);
+	std::vector<int> read_ints(N);
+	ASSERT_GE(H5Dread(int_set, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, read_ints.data()), 0);
+	ASSERT_EQ(read_ints, int_data);
+	H5Dclose(int_set);
+
+	// doubles are stored with 2 decimal digits with the scale-offset filter
+	hid_t double_set = H5Dopen2(file_id, "double_data", H5P_DEFAULT);
+	plist_id = H5Dget_create_plist(double_set);
+	ASSERT_EQ(H5Pget_nfilters(plist_id), 1);
+	ASSERT_EQ(H5Pget_filter2(plist_id, 0, NULL, NULL, NULL, 0, NULL, NULL), H5Z_FILTER_SCALEOFFSET);
+	H5Pclose(plist_id);
+	std::vector<double> read_doubles(N);
+	ASSERT_GE(H5Dread(double_set, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, read_doubles.data()), 0);
+	for (int i = 0; i < N; i++) {
+		ASSERT_NEAR(read_doubles[i], double_data[i], 0.005);
+	}
+	H5Dclose(double_set);
+
+	H5Fclose(file_id);
+}
@@ -0,0 +1,251 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/* The Prefetcher is driven directly here: all the HDF5 calls of the test are
+ * made with hdf5_mutex() held, so its background thread runs even when HDF5
+ * is not thread-safe, which the plugin does not allow.
+ */
+
+#include <chrono>
+#include <gtest/gtest.h>
+#include <hdf5.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hdf5_wrapper.h"
+#include "prefetcher.h"
+
+using decl_hdf5::hdf5_mutex;
+using decl_hdf5::make_raii_hid;
+using decl_hdf5::Prefetcher;
+using decl_hdf5::Raii_hid;
+
+namespace {
+
+/// The file of the running test, a file per test since they can run concurrently
+std::string filename()
+{
+	return std::string{"decl_hdf5_test_prefetcher_"} + ::testing::UnitTest::GetInstance()->current_test_info()->name() + ".h5";
+}
+
+/// Writes `data' as a 1D int dataset named `name', replacing the file if `create'
+void write_dataset(const char* name, const std::vector<int>& data, bool create)
+{
+	std::lock_guard<std::recursive_mutex> lock{hdf5_mutex()};
+	Raii_hid file = create ? make_raii_hid(H5Fcreate(filename().c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT), H5Fclose)
+	                       : make_raii_hid(H5Fopen(filename().c_str(), H5F_ACC_RDWR, H5P_DEFAULT), H5Fclose);
+	hsize_t size = data.size();
+	Raii_hid space = make_raii_hid(H5Screate_simple(1, &size, NULL), H5Sclose);
+	htri_t exists = H5Lexists(file, name, H5P_DEFAULT);
+	Raii_hid dataset = exists > 0 ? make_raii_hid(H5Dopen2(file, name, H5P_DEFAULT), H5Dclose)
+	                              : make_raii_hid(H5Dcreate2(file, name, H5T_NATIVE_INT, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT), H5Dclose);
+	ASSERT_LE(0, H5Dwrite(dataset, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, data.data()));
+}
+
+/// Creates the dataspace of a 1D dataset of `size' elements with `count' elements selected from `start' every `stride'
+Raii_hid selection(hsize_t size, hsize_t start, hsize_t stride, hsize_t count)
+{
+	Raii_hid space = make_raii_hid(H5Screate_simple(1, &size, NULL), H5Sclose);
+	H5Sselect_hyperslab(space, H5S_SELECT_SET, &start, &stride, &count, NULL);
+	return space;
+}
+
+/** Prefetches `name' with the `file_space' selection and fetches it back,
+ * retrying with longer waits until the background read is done
+ *
+ * \return whether the data was served from the prefetched data
+ */
+bool prefetch_and_fetch(Prefetcher& prefetcher, const char* name, hid_t file_space, hid_t mem_space, void* data)
+{
+	Raii_hid fapl = make_raii_hid(H5Pcreate(H5P_FILE_ACCESS), H5Pclose);
+	for (int attempt = 1; attempt <= 10; ++attempt) {
+		{
+			std::lock_guard<std::recursive_mutex> lock{hdf5_mutex()};
+			prefetcher.prefetch(filename(), name, fapl, file_space, H5T_NATIVE_INT);
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10 * attempt * attempt));
+		std::lock_guard<std::recursive_mutex> lock{hdf5_mutex()};
+		if (prefetcher.fetch(filename(), name, file_space, H5T_NATIVE_INT, mem_space, data)) return true;
+	}
+	return false;
+}
+
+} // namespace
+
+/*
+ * Name:                decl_hdf5_prefetcher.whole_buffer
+ *
+ * Description:         a prefetched selection is served to a fully selected buffer
+ */
+TEST(decl_hdf5_prefetcher, whole_buffer)
+{
+	std::vector<int> data(100);
+	for (int i = 0; i < 100; ++i) {
+		data[i] = i;
+	}
+	write_dataset("data", data, true);
+
+	Prefetcher prefetcher;
+	Raii_hid file_space = selection(100, 10, 2, 20);
+	Raii_hid mem_space = selection(20, 0, 1, 20);
+	std::vector<int> read(20, -1);
+	ASSERT_TRUE(prefetch_and_fetch(prefetcher, "data", file_space, mem_space, read.data()));
+	for (int i = 0; i < 20; ++i) {
+		EXPECT_EQ(10 + 2 * i, read[i]);
+	}
+
+	// the result is consumed by the fetch
+	std::lock_guard<std::recursive_mutex> lock{hdf5_mutex()};
+	EXPECT_FALSE(prefetcher.fetch(filename(), "data", file_space, H5T_NATIVE_INT, mem_space, read.data()));
+}
+
+/*
+ * Name:                decl_hdf5_prefetcher.scatter
+ *
+ * Description:         a prefetched selection is scattered to a partially selected buffer
+ */
+TEST(decl_hdf5_prefetcher, scatter)
+{
+	std::vector<int> data(100);
+	for (int i = 0; i < 100; ++i) {
+		data[i] = i;
+	}
+	write_dataset("data", data, true);
+
+	Prefetcher prefetcher;
+	Raii_hid file_space = selection(100, 50, 1, 10);
+	Raii_hid mem_space = selection(21, 1, 2, 10);
+	std::vector<int> read(21, -1);
+	ASSERT_TRUE(prefetch_and_fetch(prefetcher, "data", file_space, mem_space, read.data()));
+	for (int i = 0; i < 21; ++i) {
+		EXPECT_EQ(i % 2 ? 50 + i / 2 : -1, read[i]);
+	}
+}
+
+/*
+ * Name:                decl_hdf5_prefetcher.reuse
+ *
+ * Description:         consecutive prefetches read the current file content, the buffer being reused
+ */
+TEST(decl_hdf5_prefetcher, reuse)
+{
+	std::vector<int> data(100);
+	Prefetcher prefetcher;
+	Raii_hid file_space = selection(100, 0, 1, 100);
+	Raii_hid mem_space = selection(100, 0, 1, 100);
+	for (int step = 0; step < 3; ++step) {
+		for (int i = 0; i < 100; ++i) {
+			data[i] = 1000 * step + i;
+		}
+		write_dataset("data", data, step == 0);
+		std::vector<int> read(100, -1);
+		ASSERT_TRUE(prefetch_and_fetch(prefetcher, "data", file_space, mem_space, read.data()));
+		EXPECT_EQ(data, read);
+	}
+}
+
+/*
+ * Name:                decl_hdf5_prefetcher.mismatch
+ *
+ * Description:         a read of another dataset, selection or type is not served
+ */
+TEST(decl_hdf5_prefetcher, mismatch)
+{
+	std::vector<int> data(100, 1);
+	write_dataset("data", data, true);
+	write_dataset("other", data, false);
+
+	Prefetcher prefetcher;
+	Raii_hid fapl = make_raii_hid(H5Pcreate(H5P_FILE_ACCESS), H5Pclose);
+	Raii_hid file_space = selection(100, 0, 1, 10);
+	Raii_hid other_space = selection(100, 1, 1, 10);
+	Raii_hid mem_space = selection(10, 0, 1, 10);
+	std::vector<int> read(10, -1);
+
+	// a read of another dataset keeps the prefetched data
+	bool served = false;
+	for (int attempt = 1; !served && attempt <= 10; ++attempt) {
+		{
+			std::lock_guard<std::recursive_mutex> lock{hdf5_mutex()};
+			prefetcher.prefetch(filename(), "data", fapl, file_space, H5T_NATIVE_INT);
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10 * attempt * attempt));
+		std::lock_guard<std::recursive_mutex> lock{hdf5_mutex()};
+		EXPECT_FALSE(prefetcher.fetch(filename(), "other", file_space, H5T_NATIVE_INT, mem_space, read.data()));
+		served = prefetcher.fetch(filename(), "data", file_space, H5T_NATIVE_INT, mem_space, read.data());
+	}
+	ASSERT_TRUE(served);
+
+	// a read of the same dataset with another selection or type drops it
+	std::vector<int> unread(10, -1);
+	for (hid_t mem_type: {H5T_NATIVE_INT, H5T_NATIVE_LONG}) {
+		{
+			std::lock_guard<std::recursive_mutex> lock{hdf5_mutex()};
+			prefetcher.prefetch(filename(), "data", fapl, file_space, H5T_NATIVE_INT);
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		std::lock_guard<std::recursive_mutex> lock{hdf5_mutex()};
+		hid_t space = mem_type == H5T_NATIVE_INT ? other_space : file_space;
+		EXPECT_FALSE(prefetcher.fetch(filename(), "data", space, mem_type, mem_space, unread.data()));
+		EXPECT_FALSE(prefetcher.fetch(filename(), "data", file_space, H5T_NATIVE_INT, mem_space, unread.data()));
+	}
+	EXPECT_EQ(std::vector<int>(10, 1), read);
+	EXPECT_EQ(std::vector<int>(10, -1), unread);
+}
+
+/*
+ * Name:                decl_hdf5_prefetcher.replaced
+ *
+ * Description:         a request replaced before it is handled is never served
+ */
+TEST(decl_hdf5_prefetcher, replaced)
+{
+	std::vector<int> data(10);
+	for (int i = 0; i < 10; ++i) {
+		data[i] = i;
+	}
+	write_dataset("first", data, true);
+	write_dataset("second", data, false);
+
+	Prefetcher prefetcher;
+	Raii_hid fapl = make_raii_hid(H5Pcreate(H5P_FILE_ACCESS), H5Pclose);
+	Raii_hid space = selection(10, 0, 1, 10);
+	std::vector<int> read(10, -1);
+	bool served = false;
+	for (int attempt = 1; !served && attempt <= 10; ++attempt) {
+		{
+			std::lock_guard<std::recursive_mutex> lock{hdf5_mutex()};
+			prefetcher.prefetch(filename(), "first", fapl, space, H5T_NATIVE_INT);
+			prefetcher.prefetch(filename(), "second", fapl, space, H5T_NATIVE_INT);
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10 * attempt * attempt));
+		std::lock_guard<std::recursive_mutex> lock{hdf5_mutex()};
+		EXPECT_FALSE(prefetcher.fetch(filename(), "first", space, H5T_NATIVE_INT, space, read.data()));
+		served = prefetcher.fetch(filename(), "second", space, H5T_NATIVE_INT, space, read.data());
+	}
+	ASSERT_TRUE(served);
+	EXPECT_EQ(data, read);
+}
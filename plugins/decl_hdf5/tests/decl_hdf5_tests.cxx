@@ -23,6 +23,7 @@
  * THE SOFTWARE.
  ******************************************************************************/
 
+#include <string>
 #include <gtest/gtest.h>
 #include <unistd.h>
 #include <pdi.h>
@@ -950,3 +951,596 @@ TEST(decl_hdf5_test, 08)
 	PDI_finalize();
 	PC_tree_destroy(&conf);
 }
+
+/*
+ * Name:                decl_hdf5_test.09
+ *
+ * Description:         append records to an extensible dataset
+ */
+TEST(decl_hdf5_test, 09)
+{
+	const char* CONFIG_YAML
+		= "logging: trace                                                 \n"
+		  "data:                                                          \n"
+		  "  record: { size: [2, 3], type: array, subtype: int }          \n"
+		  "  all_records: { size: [3, 2, 3], type: array, subtype: int }  \n"
+		  "plugins:                                                       \n"
+		  "  decl_hdf5:                                                   \n"
+		  "    - file: decl_hdf5_test_09.h5                               \n"
+		  "      on_event: write                                          \n"
+		  "      write:                                                   \n"
+		  "        record:                                                \n"
+		  "          dataset: series                                      \n"
+		  "          append: 1                                            \n"
+		  "    - file: decl_hdf5_test_09.h5                               \n"
+		  "      on_event: read                                           \n"
+		  "      read:                                                    \n"
+		  "        all_records:                                           \n"
+		  "          dataset: series                                      \n";
+
+	remove("decl_hdf5_test_09.h5");
+
+	PC_tree_t conf = PC_parse_string(CONFIG_YAML);
+	PDI_init(conf);
+
+	int record[2][3];
+	for (int step = 0; step < 3; step++) {
+		for (int i = 0; i < 2; i++) {
+			for (int j = 0; j < 3; j++) {
+				record[i][j] = step * 100 + i * 10 + j;
+			}
+		}
+		PDI_multi_expose("write", "record", record, PDI_OUT, NULL);
+	}
+
+	int all_records[3][2][3];
+	for (int step = 0; step < 3; step++) {
+		for (int i = 0; i < 2; i++) {
+			for (int j = 0; j < 3; j++) {
+				all_records[step][i][j] = -1;
+			}
+		}
+	}
+	PDI_multi_expose("read", "all_records", all_records, PDI_IN, NULL);
+	for (int step = 0; step < 3; step++) {
+		for (int i = 0; i < 2; i++) {
+			for (int j = 0; j < 3; j++) {
+				EXPECT_EQ(all_records[step][i][j], step * 100 + i * 10 + j);
+			}
+		}
+	}
+
+	PDI_finalize();
+	PC_tree_destroy(&conf);
+}
+
+/*
+ * Name:                decl_hdf5_test.10
+ *
+ * Description:         write and read with custom HDF5 property lists
+ */
+TEST(decl_hdf5_test, 10)
+{
+	const char* CONFIG_YAML
+		= "logging: trace                                                 \n"
+		  "data:                                                          \n"
+		  "  array_data: { size: [8, 8], type: array, subtype: int }      \n"
+		  "plugins:                                                       \n"
+		  "  decl_hdf5:                                                   \n"
+		  "    - file: decl_hdf5_test_10.h5                               \n"
+		  "      on_event: write                                          \n"
+		  "      file_access_properties:                                  \n"
+		  "        alignment: 4096                                        \n"
+		  "        alignment_threshold: 1                                 \n"
+		  "        sieve_buf_size: 65536                                  \n"
+		  "      file_creation_properties:                                \n"
+		  "        file_space_strategy: PAGE                              \n"
+		  "        file_space_page_size: 4096                             \n"
+		  "      dataset_creation_properties:                             \n"
+		  "        fill_time: NEVER                                       \n"
+		  "        alloc_time: LATE                                       \n"
+		  "      write:                                                   \n"
+		  "        array_data:                                            \n"
+		  "          dataset_creation_properties:                         \n"
+		  "            alloc_time: EARLY                                  \n"
+		  "    - file: decl_hdf5_test_10.h5                               \n"
+		  "      on_event: read                                           \n"
+		  "      file_access_properties:                                  \n"
+		  "        chunk_cache_nbytes: 1048576                            \n"
+		  "      read: [array_data]                                       \n";
+
+	remove("decl_hdf5_test_10.h5");
+
+	PC_tree_t conf = PC_parse_string(CONFIG_YAML);
+	PDI_init(conf);
+
+	int array_data[8][8];
+	for (int i = 0; i < 8; i++) {
+		for (int j = 0; j < 8; j++) {
+			array_data[i][j] = i * 8 + j;
+		}
+	}
+	PDI_multi_expose("write", "array_data", array_data, PDI_OUT, NULL);
+
+	for (int i = 0; i < 8; i++) {
+		for (int j = 0; j < 8; j++) {
+			array_data[i][j] = -1;
+		}
+	}
+	PDI_multi_expose("read", "array_data", array_data, PDI_IN, NULL);
+	for (int i = 0; i < 8; i++) {
+		for (int j = 0; j < 8; j++) {
+			EXPECT_EQ(array_data[i][j], i * 8 + j);
+		}
+	}
+
+	PDI_finalize();
+	PC_tree_destroy(&conf);
+}
+
+/*
+ * Name:                decl_hdf5_test.11
+ *
+ * Description:         read a series of datasets with prefetching
+ */
+TEST(decl_hdf5_test, 11)
+{
+	const char* CONFIG_YAML
+		= "logging: trace                                                 \n"
+		  "metadata:                                                      \n"
+		  "  iter: int                                                    \n"
+		  "data:                                                          \n"
+		  "  field: { size: [4, 5], type: array, subtype: double }        \n"
+		  "  sub_field:                                                   \n"
+		  "    type: array                                                \n"
+		  "    subtype: double                                            \n"
+		  "    size: [4, 7]                                               \n"
+		  "    subsize: [4, 5]                                            \n"
+		  "    start: [0, 1]                                              \n"
+		  "plugins:                                                       \n"
+		  "  decl_hdf5:                                                   \n"
+		  "    - file: decl_hdf5_test_11.h5                               \n"
+		  "      on_event: write                                          \n"
+		  "      write:                                                   \n"
+		  "        field: { dataset: 'step_${iter}' }                     \n"
+		  "    - file: decl_hdf5_test_11.h5                               \n"
+		  "      on_event: read                                           \n"
+		  "      read:                                                    \n"
+		  "        field:                                                 \n"
+		  "          dataset: 'step_${iter}'                              \n"
+		  "          prefetch: 'step_$($iter+1)'                          \n"
+		  "        sub_field:                                             \n"
+		  "          dataset: 'step_${iter}'                              \n"
+		  "          prefetch: 'step_$($iter+1)'                          \n";
+
+	remove("decl_hdf5_test_11.h5");
+
+	PC_tree_t conf = PC_parse_string(CONFIG_YAML);
+	PDI_init(conf);
+
+	double field[4][5];
+	for (int iter = 0; iter < 4; iter++) {
+		for (int i = 0; i < 4; i++) {
+			for (int j = 0; j < 5; j++) {
+				field[i][j] = iter * 100 + i * 10 + j;
+			}
+		}
+		PDI_multi_expose("write", "iter", &iter, PDI_OUT, "field", field, PDI_OUT, NULL);
+	}
+
+	double sub_field[4][7];
+	for (int iter = 0; iter < 4; iter++) {
+		for (int i = 0; i < 4; i++) {
+			for (int j = 0; j < 5; j++) {
+				field[i][j] = -1;
+			}
+			for (int j = 0; j < 7; j++) {
+				sub_field[i][j] = -1;
+			}
+		}
+		PDI_multi_expose("read", "iter", &iter, PDI_OUT, "field", field, PDI_IN, "sub_field", sub_field, PDI_IN, NULL);
+		for (int i = 0; i < 4; i++) {
+			for (int j = 0; j < 5; j++) {
+				EXPECT_EQ(field[i][j], iter * 100 + i * 10 + j);
+				EXPECT_EQ(sub_field[i][j + 1], iter * 100 + i * 10 + j);
+			}
+			EXPECT_EQ(sub_field[i][0], -1);
+			EXPECT_EQ(sub_field[i][6], -1);
+		}
+	}
+
+	PDI_finalize();
+	PC_tree_destroy(&conf);
+}
+
+/*
+ * Name:                decl_hdf5_test.12
+ *
+ * Description:         strided memory and dataset selections
+ */
+TEST(decl_hdf5_test, 12)
+{
+	const char* CONFIG_YAML
+		= "logging: trace                                                 \n"
+		  "data:                                                          \n"
+		  "  interleaved: { size: [4, 6], type: array, subtype: int }     \n"
+		  "  blocks: { size: [4, 2], type: array, subtype: int }          \n"
+		  "plugins:                                                       \n"
+		  "  decl_hdf5:                                                   \n"
+		  "    - file: decl_hdf5_test_12.h5                               \n"
+		  "      on_event: write                                          \n"
+		  "      datasets:                                                \n"
+		  "        even: { size: [4, 3], type: array, subtype: int }      \n"
+		  "      write:                                                   \n"
+		  "        interleaved:                                           \n"
+		  "          dataset: even                                        \n"
+		  "          memory_selection: { size: [4, 3], stride: [1, 2] }   \n"
+		  "    - file: decl_hdf5_test_12.h5                               \n"
+		  "      on_event: read                                           \n"
+		  "      read:                                                    \n"
+		  "        blocks:                                                \n"
+		  "          dataset: even                                        \n"
+		  "          dataset_selection:                                   \n"
+		  "            size: [2, 2]                                       \n"
+		  "            stride: [2, 2]                                     \n"
+		  "            block: [2, 1]                                      \n"
+		  "    - file: decl_hdf5_test_12.h5                               \n"
+		  "      on_event: read_empty_block                               \n"
+		  "      read:                                                    \n"
+		  "        blocks:                                                \n"
+		  "          dataset: even                                        \n"
+		  "          dataset_selection: { block: [0, 1] }                 \n"
+		  "    - file: decl_hdf5_test_12.h5                               \n"
+		  "      on_event: read_negative_stride                           \n"
+		  "      read:                                                    \n"
+		  "        blocks:                                                \n"
+		  "          dataset: even                                        \n"
+		  "          dataset_selection: { stride: [-1, 1] }               \n";
+
+	remove("decl_hdf5_test_12.h5");
+
+	PC_tree_t conf = PC_parse_string(CONFIG_YAML);
+	PDI_init(conf);
+
+	int interleaved[4][6];
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 6; j++) {
+			interleaved[i][j] = i * 10 + j;
+		}
+	}
+	PDI_multi_expose("write", "interleaved", interleaved, PDI_OUT, NULL);
+
+	int blocks[4][2];
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 2; j++) {
+			blocks[i][j] = -1;
+		}
+	}
+	PDI_multi_expose("read", "blocks", blocks, PDI_IN, NULL);
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 2; j++) {
+			EXPECT_EQ(blocks[i][j], i * 10 + 4 * j);
+		}
+	}
+
+	// blocks and strides must be at least 1
+	PDI_errhandler(PDI_NULL_HANDLER);
+	EXPECT_EQ(PDI_ERR_CONFIG, PDI_multi_expose("read_empty_block", "blocks", blocks, PDI_IN, NULL));
+	EXPECT_EQ(PDI_ERR_CONFIG, PDI_multi_expose("read_negative_stride", "blocks", blocks, PDI_IN, NULL));
+	PDI_errhandler(PDI_ASSERT_HANDLER);
+
+	PDI_finalize();
+	PC_tree_destroy(&conf);
+}
+
+/*
+ * Name:                decl_hdf5_test.13
+ *
+ * Description:         write a file staged in memory and read it back staged,
+ *                      without collision since it is only read
+ */
+TEST(decl_hdf5_test, 13)
+{
+	const char* WRITE_YAML
+		= "logging: trace                                                 \n"
+		  "metadata:                                                      \n"
+		  "  iter: int                                                    \n"
+		  "data:                                                          \n"
+		  "  diag: { size: 8, type: array, subtype: double }              \n"
+		  "plugins:                                                       \n"
+		  "  decl_hdf5:                                                   \n"
+		  "    - file: decl_hdf5_test_13.h5                               \n"
+		  "      on_event: write                                          \n"
+		  "      staging: { mode: memory, flush_every: 2, flush_on: sync }\n"
+		  "      write:                                                   \n"
+		  "        diag: { dataset: 'diag_${iter}' }                      \n";
+	const char* READ_YAML
+		= "logging: trace                                                 \n"
+		  "metadata:                                                      \n"
+		  "  iter: int                                                    \n"
+		  "data:                                                          \n"
+		  "  diag: { size: 8, type: array, subtype: double }              \n"
+		  "plugins:                                                       \n"
+		  "  decl_hdf5:                                                   \n"
+		  "    - file: decl_hdf5_test_13.h5                               \n"
+		  "      on_event: read                                           \n"
+		  "      collision_policy: replace                                \n"
+		  "      staging: memory                                          \n"
+		  "      read:                                                    \n"
+		  "        diag: { dataset: 'diag_${iter}' }                      \n";
+
+	remove("decl_hdf5_test_13.h5");
+
+	PC_tree_t conf = PC_parse_string(WRITE_YAML);
+	PDI_init(conf);
+	double diag[8];
+	for (int iter = 0; iter < 5; iter++) {
+		for (int i = 0; i < 8; i++) {
+			diag[i] = iter * 10 + i;
+		}
+		PDI_multi_expose("write", "iter", &iter, PDI_OUT, "diag", diag, PDI_OUT, NULL);
+		if (iter == 2) {
+			PDI_event("sync");
+		}
+	}
+	// the last write is only flushed at finalization
+	PDI_finalize();
+	PC_tree_destroy(&conf);
+
+	conf = PC_parse_string(READ_YAML);
+	PDI_init(conf);
+	for (int iter = 0; iter < 5; iter++) {
+		for (int i = 0; i < 8; i++) {
+			diag[i] = -1;
+		}
+		PDI_multi_expose("read", "iter", &iter, PDI_OUT, "diag", diag, PDI_IN, NULL);
+		for (int i = 0; i < 8; i++) {
+			EXPECT_EQ(diag[i], iter * 10 + i);
+		}
+	}
+	PDI_finalize();
+	PC_tree_destroy(&conf);
+}
+
+/*
+ * Name:                decl_hdf5_test.14
+ *
+ * Description:         Tests the packed write of padded records, contiguous and
+ *                      with a sparse memory selection
+ */
+TEST(decl_hdf5_test, 14)
+{
+	const char* CONFIG_YAML
+		= "logging: trace                                               \n"
+		  "metadata:                                                    \n"
+		  "  input: int                                                 \n"
+		  "types:                                                       \n"
+		  "  padded:                                                    \n"
+		  "    type: struct                                             \n"
+		  "    members: [ {c: char}, {d: double}, {i: int} ]            \n"
+		  "data:                                                        \n"
+		  "  records: { type: array, size: 6, subtype: padded }         \n"
+		  "  records_read: { type: array, size: 4, subtype: padded }    \n"
+		  "plugins:                                                     \n"
+		  "  decl_hdf5:                                                 \n"
+		  "    - file: decl_hdf5_test_14.h5                             \n"
+		  "      when: $input=0                                         \n"
+		  "      datasets:                                              \n"
+		  "        sparse_records: { type: array, size: 4, subtype: padded }\n"
+		  "      write:                                                 \n"
+		  "        records:                                             \n"
+		  "          - pack: 1                                          \n"
+		  "          - dataset: sparse_records                          \n"
+		  "            pack: 1                                          \n"
+		  "            memory_selection: { size: 4, start: 1 }          \n"
+		  "    - file: decl_hdf5_test_14.h5                             \n"
+		  "      when: $input=1                                         \n"
+		  "      read:                                                  \n"
+		  "        records: ~                                           \n"
+		  "        records_read: { dataset: sparse_records }            \n";
+
+	struct Padded {
+		char c;
+		double d;
+		int i;
+	};
+
+	remove("decl_hdf5_test_14.h5");
+
+	PC_tree_t conf = PC_parse_string(CONFIG_YAML);
+	PDI_init(conf);
+	Padded records[6];
+	for (int i = 0; i < 6; i++) {
+		records[i].c = 'a' + i;
+		records[i].d = i * 1.5;
+		records[i].i = i * 10;
+	}
+	int input = 0;
+	PDI_expose("input", &input, PDI_OUT);
+	PDI_expose("records", records, PDI_OUT);
+
+	for (int i = 0; i < 6; i++) {
+		records[i] = Padded{0, -1, -1};
+	}
+	Padded records_read[4];
+	input = 1;
+	PDI_expose("input", &input, PDI_OUT);
+	PDI_expose("records", records, PDI_IN);
+	PDI_expose("records_read", records_read, PDI_IN);
+	for (int i = 0; i < 6; i++) {
+		EXPECT_EQ(records[i].c, 'a' + i);
+		EXPECT_EQ(records[i].d, i * 1.5);
+		EXPECT_EQ(records[i].i, i * 10);
+	}
+	for (int i = 0; i < 4; i++) {
+		EXPECT_EQ(records_read[i].c, 'a' + i + 1);
+		EXPECT_EQ(records_read[i].d, (i + 1) * 1.5);
+		EXPECT_EQ(records_read[i].i, (i + 1) * 10);
+	}
+	PDI_finalize();
+	PC_tree_destroy(&conf);
+}
+
+/*
+ * Name:                decl_hdf5_test.15
+ *
+ * Description:         Tests the incremental write of the modified chunks of a
+ *                      dataset
+ */
+TEST(decl_hdf5_test, 15)
+{
+	const char* CONFIG_YAML
+		= "logging: trace                                                 \n"
+		  "metadata:                                                      \n"
+		  "  input: int                                                   \n"
+		  "data:                                                          \n"
+		  "  matrix: { size: [8, 8], type: array, subtype: double }       \n"
+		  "  hashes: { size: 4, type: array, subtype: uint64 }            \n"
+		  "plugins:                                                       \n"
+		  "  decl_hdf5:                                                   \n"
+		  "    - file: decl_hdf5_test_15.h5                               \n"
+		  "      collision_policy: write_into                             \n"
+		  "      when: $input=0                                           \n"
+		  "      write:                                                   \n"
+		  "        matrix: { chunking: [4, 4], incremental: true }        \n"
+		  "    - file: decl_hdf5_test_15.h5                               \n"
+		  "      when: $input=1                                           \n"
+		  "      read:                                                    \n"
+		  "        matrix: ~                                              \n"
+		  "        hashes: { dataset: matrix_chunk_hashes }               \n";
+
+	remove("decl_hdf5_test_15.h5");
+
+	PC_tree_t conf = PC_parse_string(CONFIG_YAML);
+	PDI_init(conf);
+	double matrix[8][8];
+	uint64_t first_hashes[4];
+	uint64_t hashes[4];
+	for (int i = 0; i < 8; i++) {
+		for (int j = 0; j < 8; j++) {
+			matrix[i][j] = i * 8 + j;
+		}
+	}
+	int input = 0;
+	PDI_expose("input", &input, PDI_OUT);
+	PDI_expose("matrix", matrix, PDI_OUT);
+	input = 1;
+	PDI_expose("input", &input, PDI_OUT);
+	PDI_expose("hashes", first_hashes, PDI_IN);
+
+	// only modify the bottom left chunk
+	matrix[5][2] = -1;
+	input = 0;
+	PDI_expose("input", &input, PDI_OUT);
+	PDI_expose("matrix", matrix, PDI_OUT);
+
+	for (int i = 0; i < 8; i++) {
+		for (int j = 0; j < 8; j++) {
+			matrix[i][j] = 0;
+		}
+	}
+	input = 1;
+	PDI_expose("input", &input, PDI_OUT);
+	PDI_expose("matrix", matrix, PDI_IN);
+	PDI_expose("hashes", hashes, PDI_IN);
+	for (int i = 0; i < 8; i++) {
+		for (int j = 0; j < 8; j++) {
+			EXPECT_EQ(matrix[i][j], (i == 5 && j == 2) ? -1 : i * 8 + j);
+		}
+	}
+	for (int chunk = 0; chunk < 4; chunk++) {
+		EXPECT_NE(hashes[chunk], 0);
+		if (chunk == 2) {
+			EXPECT_NE(hashes[chunk], first_hashes[chunk]);
+		} else {
+			EXPECT_EQ(hashes[chunk], first_hashes[chunk]);
+		}
+	}
+	PDI_finalize();
+	PC_tree_destroy(&conf);
+}
+
+/*
+ * Name:                decl_hdf5_test.16
+ *
+ * Description:         Tests checkpoints written to a local tier, drained to a
+ *                      global tier and read from the freshest valid tier
+ */
+TEST(decl_hdf5_test, 16)
+{
+	const char* WRITE_YAML
+		= "logging: trace                                                 \n"
+		  "metadata:                                                      \n"
+		  "  iter: int                                                    \n"
+		  "data:                                                          \n"
+		  "  field: { size: 8, type: array, subtype: double }             \n"
+		  "plugins:                                                       \n"
+		  "  decl_hdf5:                                                   \n"
+		  "    - file: 'ckpt_${iter}.h5'                                  \n"
+		  "      on_event: checkpoint                                     \n"
+		  "      checkpoint:                                              \n"
+		  "        local_path: decl_hdf5_test_16_local                    \n"
+		  "        global_path: decl_hdf5_test_16_global                  \n"
+		  "        drain_every: 2                                         \n"
+		  "        local_retention: 2                                     \n"
+		  "        global_retention: 1                                    \n"
+		  "      write: [field]                                           \n";
+	const char* READ_YAML
+		= "logging: trace                                                 \n"
+		  "metadata:                                                      \n"
+		  "  iter: int                                                    \n"
+		  "data:                                                          \n"
+		  "  field: { size: 8, type: array, subtype: double }             \n"
+		  "plugins:                                                       \n"
+		  "  decl_hdf5:                                                   \n"
+		  "    - file: 'ckpt_${iter}.h5'                                  \n"
+		  "      on_event: restart                                        \n"
+		  "      checkpoint:                                              \n"
+		  "        local_path: decl_hdf5_test_16_local                    \n"
+		  "        global_path: decl_hdf5_test_16_global                  \n"
+		  "      read: [field]                                            \n";
+
+	for (int iter = 0; iter < 5; iter++) {
+		std::string filename = "ckpt_" + std::to_string(iter) + ".h5";
+		remove(("decl_hdf5_test_16_local/" + filename).c_str());
+		remove(("decl_hdf5_test_16_global/" + filename).c_str());
+	}
+	remove("decl_hdf5_test_16_global/checkpoint.manifest");
+
+	PC_tree_t conf = PC_parse_string(WRITE_YAML);
+	PDI_init(conf);
+	double field[8];
+	for (int iter = 0; iter < 5; iter++) {
+		for (int i = 0; i < 8; i++) {
+			field[i] = iter * 10 + i;
+		}
+		PDI_multi_expose("checkpoint", "iter", &iter, PDI_OUT, "field", field, PDI_OUT, NULL);
+	}
+	// waits for the pending drains
+	PDI_finalize();
+	PC_tree_destroy(&conf);
+
+	// 2 files kept locally, the 2nd and 4th are drained and only the last drained is kept
+	for (int iter = 0; iter < 5; iter++) {
+		std::string filename = "ckpt_" + std::to_string(iter) + ".h5";
+		EXPECT_EQ(access(("decl_hdf5_test_16_local/" + filename).c_str(), F_OK) == 0, iter >= 3) << filename;
+		EXPECT_EQ(access(("decl_hdf5_test_16_global/" + filename).c_str(), F_OK) == 0, iter == 3) << filename;
+	}
+	EXPECT_EQ(access("decl_hdf5_test_16_global/checkpoint.manifest", F_OK), 0);
+
+	// the 4th checkpoint is lost locally and read from the global tier
+	remove("decl_hdf5_test_16_local/ckpt_3.h5");
+	conf = PC_parse_string(READ_YAML);
+	PDI_init(conf);
+	for (int iter = 3; iter < 5; iter++) {
+		for (int i = 0; i < 8; i++) {
+			field[i] = -1;
+		}
+		PDI_multi_expose("restart", "iter", &iter, PDI_OUT, "field", field, PDI_IN, NULL);
+		for (int i = 0; i < 8; i++) {
+			EXPECT_EQ(field[i], iter * 10 + i);
+		}
+	}
+	PDI_finalize();
+	PC_tree_destroy(&conf);
+}
@@ -0,0 +1,334 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include <hdf5.h>
+#ifdef H5_HAVE_PARALLEL
+#include <mpi.h>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <pdi/context.h>
+#include <pdi/error.h>
+#include <pdi/paraconf_wrapper.h>
+#include <pdi/ref_any.h>
+
+#include "hdf5_wrapper.h"
+
+#include "virtual_dataset.h"
+
+#ifdef H5_HAVE_PARALLEL
+
+namespace fs = std::filesystem;
+
+using PDI::Config_error;
+using PDI::Context;
+using PDI::each;
+using PDI::opt_each;
+using PDI::Ref_r;
+using PDI::System_error;
+using PDI::to_string;
+using PDI::Value_error;
+using std::error_code;
+using std::max;
+using std::string;
+using std::strlen;
+using std::vector;
+
+namespace {
+
+static_assert(sizeof(hsize_t) == sizeof(uint64_t), "hsize_t is exchanged as MPI_UINT64_T");
+
+/// The offset in a mapping of each of its parts, each one H5S_MAX_RANK long
+enum Mapping_part {
+	DIMS = 1,
+	START = DIMS + H5S_MAX_RANK,
+	STRIDE = START + H5S_MAX_RANK,
+	COUNT = STRIDE + H5S_MAX_RANK,
+	BLOCK = COUNT + H5S_MAX_RANK,
+	OFFSET = BLOCK + H5S_MAX_RANK,
+	MAPPING_SIZE = OFFSET + H5S_MAX_RANK
+};
+
+/** Describes the written part of a source dataset and its place in the virtual
+ * dataset as a fixed size array of integers: the rank, then the dataset
+ * dimensions, the hyperslab start, stride, count and block and the offset in
+ * the virtual dataset.
+ *
+ * \param h5_file_space the source dataset dataspace with the written selection
+ * \param offset the offset of the source dataset in the virtual dataset
+ * \param dataset_name the name of the source dataset
+ * \return the mapping
+ */
+vector<hsize_t> local_mapping(hid_t h5_file_space, const vector<hsize_t>& offset, const string& dataset_name)
+{
+	int rank = H5Sget_simple_extent_ndims(h5_file_space);
+	if (0 > rank) decl_hdf5::handle_hdf5_err();
+	if (0 == rank) throw Value_error{"Cannot map scalar `{}' dataset in a virtual dataset", dataset_name};
+	if (!offset.empty() && offset.size() != static_cast<size_t>(rank)) {
+		throw Value_error{"Cannot map `{}' dataset in a virtual dataset: {} start in {} array", dataset_name, offset.size(), rank};
+	}
+
+	vector<hsize_t> mapping(MAPPING_SIZE, 0);
+	mapping[0] = rank;
+	if (0 > H5Sget_simple_extent_dims(h5_file_space, &mapping[DIMS], NULL)) decl_hdf5::handle_hdf5_err();
+	switch (H5Sget_select_type(h5_file_space)) {
+	case H5S_SEL_NONE:
+		// nothing written, nothing mapped
+		break;
+	case H5S_SEL_ALL:
+		for (int dim = 0; dim < rank; ++dim) {
+			mapping[STRIDE + dim] = 1;
+			mapping[COUNT + dim] = mapping[DIMS + dim];
+			mapping[BLOCK + dim] = 1;
+		}
+		break;
+	case H5S_SEL_HYPERSLABS: {
+		htri_t regular = H5Sis_regular_hyperslab(h5_file_space);
+		if (0 > regular) decl_hdf5::handle_hdf5_err();
+		if (!regular) {
+			throw Value_error{"Cannot map `{}' dataset in a virtual dataset: only regular hyperslab selections are supported", dataset_name};
+		}
+		if (0 > H5Sget_regular_hyperslab(h5_file_space, &mapping[START], &mapping[STRIDE], &mapping[COUNT], &mapping[BLOCK])) {
+			decl_hdf5::handle_hdf5_err();
+		}
+	} break;
+	default:
+		throw Value_error{"Cannot map `{}' dataset in a virtual dataset: only regular hyperslab selections are supported", dataset_name};
+	}
+	for (size_t dim = 0; dim < offset.size(); ++dim) {
+		mapping[OFFSET + dim] = offset[dim];
+	}
+	return mapping;
+}
+
+/** Names a source file for the virtual dataset, HDF5 resolving relative names
+ * from the directory of the virtual dataset file
+ *
+ * \param h5_file the source file
+ * \param vds_file the file of the virtual dataset
+ * \return "." for the virtual dataset file itself, the source file path
+ *         relative to the virtual dataset file directory otherwise
+ */
+string source_file_name(hid_t h5_file, const string& vds_file)
+{
+	ssize_t filename_size = H5Fget_name(h5_file, NULL, 0);
+	if (0 > filename_size) decl_hdf5::handle_hdf5_err();
+	string filename(filename_size + 1, '\0');
+	if (0 > H5Fget_name(h5_file, &filename[0], filename.size())) decl_hdf5::handle_hdf5_err();
+	filename.resize(filename_size);
+
+	error_code ec;
+	fs::path source_path = fs::weakly_canonical(fs::absolute(filename), ec);
+	fs::path vds_path = fs::weakly_canonical(fs::absolute(vds_file), ec);
+	if (ec) return filename;
+	if (source_path == vds_path) return ".";
+	fs::path relative_path = source_path.lexically_relative(vds_path.parent_path());
+	return relative_path.empty() ? source_path.string() : relative_path.string();
+}
+
+/** Creates a virtual dataset, replacing any existing one
+ *
+ * \param vds_file the file of the virtual dataset
+ * \param vds_dataset the name of the virtual dataset
+ * \param h5_type the type of the virtual dataset
+ * \param mappings the mappings of all sources, MAPPING_SIZE each
+ * \param names the file and dataset names of all sources, '\0' terminated
+ * \param names_start the offset in names of the names of each source
+ * \return the number of sources mapped
+ */
+size_t create_virtual_dataset(
+	const string& vds_file,
+	const string& vds_dataset,
+	hid_t h5_type,
+	const vector<hsize_t>& mappings,
+	const vector<char>& names,
+	const vector<int>& names_start
+)
+{
+	using namespace decl_hdf5;
+
+	hsize_t rank = mappings[0];
+	vector<hsize_t> vds_dims(rank, 0);
+	for (size_t source = 0; source < names_start.size(); ++source) {
+		const hsize_t* mapping = &mappings[source * MAPPING_SIZE];
+		if (mapping[0] != rank) {
+			throw Value_error{"Cannot build `{}' virtual dataset: sources of rank {} and {}", vds_dataset, rank, mapping[0]};
+		}
+		for (hsize_t dim = 0; dim < rank; ++dim) {
+			vds_dims[dim] = max(vds_dims[dim], mapping[OFFSET + dim] + mapping[DIMS + dim]);
+		}
+	}
+
+	Raii_hid h5_vds_space = make_raii_hid(H5Screate_simple(rank, &vds_dims[0], NULL), H5Sclose);
+	Raii_hid vds_plist = make_raii_hid(H5Pcreate(H5P_DATASET_CREATE), H5Pclose);
+	size_t nb_mapped = 0;
+	for (size_t source = 0; source < names_start.size(); ++source) {
+		const hsize_t* mapping = &mappings[source * MAPPING_SIZE];
+		bool empty = false;
+		vector<hsize_t> vds_start(rank);
+		for (hsize_t dim = 0; dim < rank; ++dim) {
+			empty = empty || !mapping[COUNT + dim] || !mapping[BLOCK + dim];
+			vds_start[dim] = mapping[OFFSET + dim] + mapping[START + dim];
+		}
+		if (empty) continue;
+
+		const char* source_file = &names[names_start[source]];
+		const char* source_dataset = source_file + strlen(source_file) + 1;
+		Raii_hid h5_source_space = make_raii_hid(H5Screate_simple(rank, &mapping[DIMS], NULL), H5Sclose);
+		if (0 > H5Sselect_hyperslab(h5_source_space, H5S_SELECT_SET, &mapping[START], &mapping[STRIDE], &mapping[COUNT], &mapping[BLOCK])) {
+			handle_hdf5_err();
+		}
+		if (0 > H5Sselect_hyperslab(h5_vds_space, H5S_SELECT_SET, &vds_start[0], &mapping[STRIDE], &mapping[COUNT], &mapping[BLOCK])) {
+			handle_hdf5_err();
+		}
+		if (0 > H5Pset_virtual(vds_plist, h5_vds_space, source_file, source_dataset, h5_source_space)) handle_hdf5_err();
+		++nb_mapped;
+	}
+	if (0 > H5Sselect_all(h5_vds_space)) handle_hdf5_err();
+
+	hid_t h5_vds_file_raw = H5Fopen(vds_file.c_str(), H5F_ACC_RDWR, H5P_DEFAULT);
+	if (0 > h5_vds_file_raw) {
+		h5_vds_file_raw = H5Fcreate(vds_file.c_str(), H5F_ACC_EXCL, H5P_DEFAULT, H5P_DEFAULT);
+	}
+	Raii_hid h5_vds_file = make_raii_hid(h5_vds_file_raw, H5Fclose, ("Cannot open `" + vds_file + "' virtual dataset file").c_str());
+	if (0 < H5Lexists(h5_vds_file, vds_dataset.c_str(), H5P_DEFAULT)) {
+		if (0 > H5Ldelete(h5_vds_file, vds_dataset.c_str(), H5P_DEFAULT)) handle_hdf5_err();
+	}
+	Raii_hid link_plist = make_raii_hid(H5Pcreate(H5P_LINK_CREATE), H5Pclose);
+	if (0 > H5Pset_create_intermediate_group(link_plist, 1)) handle_hdf5_err();
+	make_raii_hid(
+		H5Dcreate2(h5_vds_file, vds_dataset.c_str(), h5_type, h5_vds_space, link_plist, vds_plist, H5P_DEFAULT),
+		H5Dclose,
+		("Cannot create `" + vds_dataset + "' virtual dataset").c_str()
+	);
+	return nb_mapped;
+}
+
+} // namespace
+
+namespace decl_hdf5 {
+
+Virtual_dataset::Virtual_dataset(PC_tree_t tree)
+	: m_tree{tree}
+{
+	each(tree, [&](PC_tree_t key_tree, PC_tree_t value) {
+		string key = to_string(key_tree);
+		if (key == "file") {
+			m_file = to_string(value);
+		} else if (key == "dataset") {
+			m_dataset = to_string(value);
+		} else if (key == "communicator") {
+			m_communicator = to_string(value);
+		} else if (key == "aggregator") {
+			m_aggregator = to_string(value);
+		} else if (key == "start") {
+			opt_each(value, [&](PC_tree_t start) { m_start.emplace_back(to_string(start)); });
+		} else {
+			throw Config_error{key_tree, "Unknown key for HDF5 virtual dataset configuration: `{}'", key};
+		}
+	});
+	if (!m_file) {
+		throw Config_error{tree, "Virtual dataset requires a `file'"};
+	}
+	if (!m_communicator) {
+		throw Config_error{tree, "Virtual dataset requires a `communicator'"};
+	}
+}
+
+void Virtual_dataset::update(Context& ctx, hid_t h5_file, const string& dataset_name, hid_t h5_file_space, hid_t h5_file_type)
+{
+	MPI_Comm comm = *(static_cast<const MPI_Comm*>(Ref_r{m_communicator.to_ref(ctx)}.get()));
+	int aggregator = m_aggregator.to_long(ctx);
+	string vds_file = m_file.to_string(ctx);
+	string vds_dataset = m_dataset ? m_dataset.to_string(ctx) : dataset_name;
+
+	vector<hsize_t> offset;
+	for (auto&& start: m_start) {
+		offset.emplace_back(start.to_long(ctx));
+	}
+	vector<hsize_t> mapping = local_mapping(h5_file_space, offset, dataset_name);
+
+	string names = source_file_name(h5_file, vds_file);
+	names += '\0';
+	names += dataset_name;
+	names += '\0';
+
+	// only rebuild the virtual dataset if any process changed its mapping
+	int changed = mapping != m_mapping || names != m_names || vds_file + '\0' + vds_dataset != m_vds_names;
+	if (MPI_SUCCESS != MPI_Allreduce(MPI_IN_PLACE, &changed, 1, MPI_INT, MPI_LOR, comm)) {
+		throw System_error{"Cannot check the mappings of `{}' virtual dataset", vds_dataset};
+	}
+	if (!changed) {
+		ctx.logger().trace("Mappings of `{}' virtual dataset unchanged", vds_dataset);
+		return;
+	}
+	m_mapping = mapping;
+	m_names = names;
+	m_vds_names = vds_file + '\0' + vds_dataset;
+
+	int rank, size;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &size);
+	vector<hsize_t> mappings;
+	vector<int> names_size;
+	if (rank == aggregator) {
+		mappings.resize(size * MAPPING_SIZE);
+		names_size.resize(size);
+	}
+	int local_names_size = names.size();
+	if (MPI_SUCCESS != MPI_Gather(&mapping[0], MAPPING_SIZE, MPI_UINT64_T, mappings.data(), MAPPING_SIZE, MPI_UINT64_T, aggregator, comm)
+	    || MPI_SUCCESS != MPI_Gather(&local_names_size, 1, MPI_INT, names_size.data(), 1, MPI_INT, aggregator, comm))
+	{
+		throw System_error{"Cannot gather the mappings of `{}' virtual dataset", vds_dataset};
+	}
+	vector<int> names_start(names_size.size(), 0);
+	for (size_t source = 1; source < names_size.size(); ++source) {
+		names_start[source] = names_start[source - 1] + names_size[source - 1];
+	}
+	vector<char> all_names;
+	if (rank == aggregator) {
+		all_names.resize(names_start.back() + names_size.back());
+	}
+	if (MPI_SUCCESS
+	    != MPI_Gatherv(&names[0], local_names_size, MPI_CHAR, all_names.data(), names_size.data(), names_start.data(), MPI_CHAR, aggregator, comm))
+	{
+		throw System_error{"Cannot gather the mappings of `{}' virtual dataset", vds_dataset};
+	}
+	if (rank != aggregator) return;
+
+	ctx.logger().trace("Building `{}' virtual dataset in `{}'", vds_dataset, vds_file);
+	size_t nb_mapped = create_virtual_dataset(vds_file, vds_dataset, h5_file_type, mappings, all_names, names_start);
+	ctx.logger().debug("`{}' virtual dataset built in `{}' from {} sources", vds_dataset, vds_file, nb_mapped);
+}
+
+} // namespace decl_hdf5
+
+#endif // H5_HAVE_PARALLEL
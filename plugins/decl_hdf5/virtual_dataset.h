@@ -0,0 +1,108 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef DECL_HDF5_VIRTUAL_DATASET_H_
+#define DECL_HDF5_VIRTUAL_DATASET_H_
+
+#include <hdf5.h>
+#ifdef H5_HAVE_PARALLEL
+#include <mpi.h>
+#endif
+
+#include <string>
+#include <vector>
+
+#include <paraconf.h>
+
+#include <pdi/pdi_fwd.h>
+#include <pdi/expression.h>
+
+#ifdef H5_HAVE_PARALLEL
+
+namespace decl_hdf5 {
+
+/** A Virtual_dataset maintains an HDF5 virtual dataset (VDS) that gives a
+ * global view over the datasets written by a set of processes in their own
+ * files.
+ *
+ * Each process contributes the dataset selection it has written, shifted by an
+ * optional offset, and the mappings are gathered on an aggregator process that
+ * (re)creates the VDS when they change.
+ */
+class Virtual_dataset
+{
+	/// The tree representing the virtual dataset
+	PC_tree_t m_tree;
+
+	/// the file of the virtual dataset
+	PDI::Expression m_file;
+
+	/// the name of the virtual dataset (the written dataset name if null)
+	PDI::Expression m_dataset;
+
+	/// the communicator of the processes contributing to the virtual dataset
+	PDI::Expression m_communicator;
+
+	/// the rank of the process that creates the virtual dataset
+	PDI::Expression m_aggregator = 0L;
+
+	/// the offset of the local data in the virtual dataset or empty for 0
+	std::vector<PDI::Expression> m_start;
+
+	/// the local mapping used to build the current virtual dataset
+	std::vector<hsize_t> m_mapping;
+
+	/// the local file and dataset names used to build the current virtual dataset
+	std::string m_names;
+
+	/// the file and dataset names of the current virtual dataset
+	std::string m_vds_names;
+
+public:
+	/** Builds a Virtual_dataset from its yaml config
+	 *
+	 * \param tree the configuration tree
+	 */
+	Virtual_dataset(PC_tree_t tree);
+
+	/** Updates the virtual dataset after a write of one of its sources, this is
+	 * collective over the communicator
+	 *
+	 * The virtual dataset is only rebuilt when a mapping changed on any
+	 * process.
+	 *
+	 * \param ctx the context in which to operate
+	 * \param h5_file the file where the source dataset was written
+	 * \param dataset_name the name of the source dataset
+	 * \param h5_file_space the source dataset dataspace with the written selection
+	 * \param h5_file_type the source dataset HDF5 type
+	 */
+	void update(PDI::Context& ctx, hid_t h5_file, const std::string& dataset_name, hid_t h5_file_space, hid_t h5_file_type);
+};
+
+} // namespace decl_hdf5
+
+#endif // H5_HAVE_PARALLEL
+
+#endif // DECL_HDF5_VIRTUAL_DATASET_H_
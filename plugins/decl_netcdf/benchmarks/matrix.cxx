@@ -0,0 +1,164 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <benchmark/benchmark.h>
+#include <netcdf.h>
+
+#include <paraconf.h>
+#include <pdi.h>
+
+namespace {
+
+void nc_check(int status)
+{
+	if (status != NC_NOERR) {
+		fprintf(stderr, "NetCDF error: %s\n", nc_strerror(status));
+		exit(1);
+	}
+}
+
+std::unique_ptr<double[]> make_matrix(int64_t size)
+{
+	std::unique_ptr<double[]> matrix{new double[size * size]};
+	for (int64_t i = 0; i < size * size; i++) {
+		matrix[i] = i * 1.2345;
+	}
+	return matrix;
+}
+
+/* Creates the `matrix_data` variable of `size`x`size` doubles in a new file */
+void create_matrix_file(const char* file_name, const double* matrix, int64_t size)
+{
+	int file_id;
+	nc_check(nc_create(file_name, NC_CLOBBER | NC_NETCDF4, &file_id));
+	int dim_ids[2];
+	nc_check(nc_def_dim(file_id, "matrix_data_dim_0", size, &dim_ids[0]));
+	nc_check(nc_def_dim(file_id, "matrix_data_dim_1", size, &dim_ids[1]));
+	int var_id;
+	nc_check(nc_def_var(file_id, "matrix_data", NC_DOUBLE, 2, dim_ids, &var_id));
+	nc_check(nc_enddef(file_id));
+	nc_check(nc_put_var_double(file_id, var_id, matrix));
+	nc_check(nc_close(file_id));
+}
+
+const char* CONFIG_YAML
+	= "logging: off                                                  \n"
+	  "metadata:                                                     \n"
+	  "  matrix_size: { size: 2, type: array, subtype: int64 }       \n"
+	  "  input: int                                                  \n"
+	  "data:                                                         \n"
+	  "  matrix_data:                                                \n"
+	  "    type: array                                               \n"
+	  "    subtype: double                                           \n"
+	  "    size: ['${matrix_size[0]}', '${matrix_size[1]}']          \n"
+	  "plugins:                                                      \n"
+	  "  decl_netcdf:                                                \n"
+	  "    - file: matrix_data.nc                                    \n"
+	  "      when: '${input}=0'                                      \n"
+	  "      write: [matrix_data]                                    \n"
+	  "    - file: matrix_data.nc                                    \n"
+	  "      when: '${input}=1'                                      \n"
+	  "      read: [matrix_data]                                     \n";
+
+} // namespace
+
+/* Writes a matrix in an existing file, the file being defined by the first
+ * write
+ */
+static void PDI_write(benchmark::State& state)
+{
+	int64_t matrix_size[2] = {state.range(0), state.range(0)};
+	std::unique_ptr<double[]> matrix = make_matrix(state.range(0));
+	remove("matrix_data.nc");
+	PDI_init(PC_parse_string(CONFIG_YAML));
+	int input = 0;
+	PDI_multi_expose("init", "matrix_size", matrix_size, PDI_OUT, "input", &input, PDI_OUT, NULL);
+	for (auto _: state) {
+		PDI_expose("matrix_data", matrix.get(), PDI_OUT);
+	}
+	PDI_finalize();
+	state.SetBytesProcessed(state.iterations() * matrix_size[0] * matrix_size[1] * sizeof(double));
+}
+
+BENCHMARK(PDI_write)->Name("Decl_netcdf_matrix/PDI_write")->RangeMultiplier(4)->Range(256, 256 << 4)->Unit(benchmark::kMillisecond);
+
+static void NetCDF_write(benchmark::State& state)
+{
+	int64_t size = state.range(0);
+	std::unique_ptr<double[]> matrix = make_matrix(size);
+	create_matrix_file("matrix_data.nc", matrix.get(), size);
+
+	for (auto _: state) {
+		int file_id;
+		nc_check(nc_open("matrix_data.nc", NC_WRITE | NC_NETCDF4, &file_id));
+		int var_id;
+		nc_check(nc_inq_varid(file_id, "matrix_data", &var_id));
+		nc_check(nc_put_var_double(file_id, var_id, matrix.get()));
+		nc_check(nc_close(file_id));
+	}
+	state.SetBytesProcessed(state.iterations() * size * size * sizeof(double));
+}
+
+BENCHMARK(NetCDF_write)->Name("Decl_netcdf_matrix/NetCDF_write")->RangeMultiplier(4)->Range(256, 256 << 4)->Unit(benchmark::kMillisecond);
+
+static void PDI_read(benchmark::State& state)
+{
+	int64_t matrix_size[2] = {state.range(0), state.range(0)};
+	std::unique_ptr<double[]> matrix = make_matrix(state.range(0));
+	create_matrix_file("matrix_data.nc", matrix.get(), state.range(0));
+
+	PDI_init(PC_parse_string(CONFIG_YAML));
+	int input = 1;
+	PDI_multi_expose("init", "matrix_size", matrix_size, PDI_OUT, "input", &input, PDI_OUT, NULL);
+	for (auto _: state) {
+		PDI_expose("matrix_data", matrix.get(), PDI_IN);
+	}
+	PDI_finalize();
+	state.SetBytesProcessed(state.iterations() * matrix_size[0] * matrix_size[1] * sizeof(double));
+}
+
+BENCHMARK(PDI_read)->Name("Decl_netcdf_matrix/PDI_read")->RangeMultiplier(4)->Range(256, 256 << 4)->Unit(benchmark::kMillisecond);
+
+static void NetCDF_read(benchmark::State& state)
+{
+	int64_t size = state.range(0);
+	std::unique_ptr<double[]> matrix = make_matrix(size);
+	create_matrix_file("matrix_data.nc", matrix.get(), size);
+
+	for (auto _: state) {
+		int file_id;
+		nc_check(nc_open("matrix_data.nc", NC_NOWRITE | NC_NETCDF4, &file_id));
+		int var_id;
+		nc_check(nc_inq_varid(file_id, "matrix_data", &var_id));
+		nc_check(nc_get_var_double(file_id, var_id, matrix.get()));
+		nc_check(nc_close(file_id));
+	}
+	state.SetBytesProcessed(state.iterations() * size * size * sizeof(double));
+}
+
+BENCHMARK(NetCDF_read)->Name("Decl_netcdf_matrix/NetCDF_read")->RangeMultiplier(4)->Range(256, 256 << 4)->Unit(benchmark::kMillisecond);
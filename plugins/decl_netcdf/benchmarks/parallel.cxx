@@ -0,0 +1,337 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include <mpi.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include <netcdf.h>
+#include <netcdf_par.h>
+
+#include <paraconf.h>
+#include <pdi.h>
+
+/* Every benchmark of this file is run by all the processes of MPI_COMM_WORLD,
+ * the time of an iteration being that of the slowest process so that all
+ * processes agree on the number of iterations to run. Only the first process
+ * reports the results.
+ */
+
+namespace {
+
+int world_rank()
+{
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	return rank;
+}
+
+int world_size()
+{
+	int size;
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+	return size;
+}
+
+void nc_check(int status)
+{
+	if (status != NC_NOERR) {
+		fprintf(stderr, "NetCDF error: %s\n", nc_strerror(status));
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+}
+
+/* Runs the benchmark loop, timing each iteration from a barrier to the end of
+ * the slowest process and reporting the bytes written by all processes
+ */
+template <class Io>
+void timed_loop(benchmark::State& state, int64_t bytes_per_process, Io&& io)
+{
+	for (auto _: state) {
+		MPI_Barrier(MPI_COMM_WORLD);
+		double start = MPI_Wtime();
+		io();
+		double elapsed = MPI_Wtime() - start;
+		MPI_Allreduce(MPI_IN_PLACE, &elapsed, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+		state.SetIterationTime(elapsed);
+	}
+	state.SetBytesProcessed(state.iterations() * bytes_per_process * world_size());
+}
+
+std::vector<double> make_field(int64_t n)
+{
+	std::vector<double> field(n);
+	for (int64_t i = 0; i < n; i++) {
+		field[i] = (world_rank() * n + i) * 1.2345;
+	}
+	return field;
+}
+
+/* The PDI configuration header shared by all PDI benchmarks, with a `field` of
+ * `n` doubles per process
+ */
+std::string pdi_header()
+{
+	return "logging: off                                                  \n"
+	       "metadata:                                                     \n"
+	       "  rank: int                                                   \n"
+	       "  size: int                                                   \n"
+	       "  n: int64                                                    \n"
+	       "  input: int                                                  \n"
+	       "data:                                                         \n"
+	       "  field: { type: array, subtype: double, size: $n }           \n"
+	       "plugins:                                                      \n"
+	       "  mpi:                                                        \n"
+	       "  decl_netcdf:                                                \n";
+}
+
+/* The configuration of a file shared by all processes, with the `field` of each
+ * process at its place in the `field` variable
+ */
+std::string pdi_shared_config()
+{
+	return pdi_header()
+		+ "    - file: shared_field.nc                                    \n"
+		  "      communicator: $MPI_COMM_WORLD                            \n"
+		  "      when: '${input}=0'                                       \n"
+		  "      variables:                                               \n"
+		  "        field: { type: array, subtype: double, size: '$size*$n' }\n"
+		  "      write:                                                   \n"
+		  "        field:                                                 \n"
+		  "          variable_selection: { start: ['$rank*$n'], subsize: ['$n'] }\n"
+		  "    - file: shared_field.nc                                    \n"
+		  "      communicator: $MPI_COMM_WORLD                            \n"
+		  "      when: '${input}=1'                                       \n"
+		  "      variables:                                               \n"
+		  "        field: { type: array, subtype: double, size: '$size*$n' }\n"
+		  "      read:                                                    \n"
+		  "        field:                                                 \n"
+		  "          variable_selection: { start: ['$rank*$n'], subsize: ['$n'] }\n";
+}
+
+void pdi_init(const std::string& config_yaml, int64_t n, int input)
+{
+	PDI_init(PC_parse_string(config_yaml.c_str()));
+	int rank = world_rank();
+	int size = world_size();
+	PDI_multi_expose("init", "rank", &rank, PDI_OUT, "size", &size, PDI_OUT, "n", &n, PDI_OUT, "input", &input, PDI_OUT, NULL);
+}
+
+/* Creates a file shared by all processes of MPI_COMM_WORLD with the `field`
+ * variable of `n` doubles per process
+ */
+void create_shared_file(const char* name, int64_t n)
+{
+	int file_id;
+	nc_check(nc_create_par(name, NC_CLOBBER | NC_NETCDF4, MPI_COMM_WORLD, MPI_INFO_NULL, &file_id));
+	int dim_id;
+	nc_check(nc_def_dim(file_id, "field_dim_0", n * world_size(), &dim_id));
+	int var_id;
+	nc_check(nc_def_var(file_id, "field", NC_DOUBLE, 1, &dim_id, &var_id));
+	nc_check(nc_close(file_id));
+}
+
+/* Writes or reads the `n` doubles of each process at its place in the `field`
+ * variable of a file shared by all processes
+ */
+void access_shared(const char* name, double* data, int64_t n, bool write)
+{
+	int file_id;
+	nc_check(nc_open_par(name, (write ? NC_WRITE : NC_NOWRITE) | NC_NETCDF4, MPI_COMM_WORLD, MPI_INFO_NULL, &file_id));
+	int var_id;
+	nc_check(nc_inq_varid(file_id, "field", &var_id));
+	nc_check(nc_var_par_access(file_id, var_id, NC_COLLECTIVE));
+	size_t start = n * world_rank();
+	size_t count = n;
+	if (write) {
+		nc_check(nc_put_vara_double(file_id, var_id, &start, &count, data));
+	} else {
+		nc_check(nc_get_vara_double(file_id, var_id, &start, &count, data));
+	}
+	nc_check(nc_close(file_id));
+}
+
+/* A reporter for the processes other than the first one */
+class Null_reporter: public benchmark::BenchmarkReporter
+{
+public:
+	bool ReportContext(const Context&) override { return true; }
+
+	void ReportRuns(const std::vector<Run>&) override {}
+};
+
+} // namespace
+
+/* Writes the field of each process in a single file shared by all processes
+ * with collective transfers, the file being defined by the first write
+ */
+static void PDI_write_shared(benchmark::State& state)
+{
+	int64_t n = state.range(0);
+	std::vector<double> field = make_field(n);
+	if (world_rank() == 0) remove("shared_field.nc");
+	MPI_Barrier(MPI_COMM_WORLD);
+	pdi_init(pdi_shared_config(), n, 0);
+	timed_loop(state, n * sizeof(double), [&]() { PDI_expose("field", field.data(), PDI_OUT); });
+	PDI_finalize();
+}
+
+BENCHMARK(PDI_write_shared)
+	->Name("Decl_netcdf_parallel/PDI_write_shared")
+	->Arg(1 << 16)
+	->Arg(1 << 20)
+	->Unit(benchmark::kMillisecond)
+	->UseManualTime();
+
+static void NetCDF_write_shared(benchmark::State& state)
+{
+	int64_t n = state.range(0);
+	std::vector<double> field = make_field(n);
+	create_shared_file("shared_field.nc", n);
+	timed_loop(state, n * sizeof(double), [&]() { access_shared("shared_field.nc", field.data(), n, true); });
+}
+
+BENCHMARK(NetCDF_write_shared)
+	->Name("Decl_netcdf_parallel/NetCDF_write_shared")
+	->Arg(1 << 16)
+	->Arg(1 << 20)
+	->Unit(benchmark::kMillisecond)
+	->UseManualTime();
+
+static void PDI_read_shared(benchmark::State& state)
+{
+	int64_t n = state.range(0);
+	std::vector<double> field = make_field(n);
+	create_shared_file("shared_field.nc", n);
+	access_shared("shared_field.nc", field.data(), n, true);
+	pdi_init(pdi_shared_config(), n, 1);
+	timed_loop(state, n * sizeof(double), [&]() { PDI_expose("field", field.data(), PDI_IN); });
+	PDI_finalize();
+}
+
+BENCHMARK(PDI_read_shared)
+	->Name("Decl_netcdf_parallel/PDI_read_shared")
+	->Arg(1 << 16)
+	->Arg(1 << 20)
+	->Unit(benchmark::kMillisecond)
+	->UseManualTime();
+
+static void NetCDF_read_shared(benchmark::State& state)
+{
+	int64_t n = state.range(0);
+	std::vector<double> field = make_field(n);
+	create_shared_file("shared_field.nc", n);
+	access_shared("shared_field.nc", field.data(), n, true);
+	timed_loop(state, n * sizeof(double), [&]() { access_shared("shared_field.nc", field.data(), n, false); });
+}
+
+BENCHMARK(NetCDF_read_shared)
+	->Name("Decl_netcdf_parallel/NetCDF_read_shared")
+	->Arg(1 << 16)
+	->Arg(1 << 20)
+	->Unit(benchmark::kMillisecond)
+	->UseManualTime();
+
+/* Writes the field of each process in its own file */
+static void PDI_write_file_per_process(benchmark::State& state)
+{
+	std::string config_yaml = pdi_header()
+		+ "    file: field_${rank}.nc                                     \n"
+		  "    write: [field]                                             \n";
+
+	int64_t n = state.range(0);
+	std::vector<double> field = make_field(n);
+	std::string file_name = "field_" + std::to_string(world_rank()) + ".nc";
+	remove(file_name.c_str());
+	pdi_init(config_yaml, n, 0);
+	timed_loop(state, n * sizeof(double), [&]() { PDI_expose("field", field.data(), PDI_OUT); });
+	PDI_finalize();
+}
+
+BENCHMARK(PDI_write_file_per_process)
+	->Name("Decl_netcdf_parallel/PDI_write_file_per_process")
+	->Arg(1 << 16)
+	->Arg(1 << 20)
+	->Unit(benchmark::kMillisecond)
+	->UseManualTime();
+
+static void NetCDF_write_file_per_process(benchmark::State& state)
+{
+	int64_t n = state.range(0);
+	std::vector<double> field = make_field(n);
+	std::string file_name = "field_" + std::to_string(world_rank()) + ".nc";
+	int file_id;
+	nc_check(nc_create(file_name.c_str(), NC_CLOBBER | NC_NETCDF4, &file_id));
+	int dim_id;
+	nc_check(nc_def_dim(file_id, "field_dim_0", n, &dim_id));
+	int var_id;
+	nc_check(nc_def_var(file_id, "field", NC_DOUBLE, 1, &dim_id, &var_id));
+	nc_check(nc_close(file_id));
+	timed_loop(state, n * sizeof(double), [&]() {
+		nc_check(nc_open(file_name.c_str(), NC_WRITE | NC_NETCDF4, &file_id));
+		nc_check(nc_inq_varid(file_id, "field", &var_id));
+		nc_check(nc_put_var_double(file_id, var_id, field.data()));
+		nc_check(nc_close(file_id));
+	});
+}
+
+BENCHMARK(NetCDF_write_file_per_process)
+	->Name("Decl_netcdf_parallel/NetCDF_write_file_per_process")
+	->Arg(1 << 16)
+	->Arg(1 << 20)
+	->Unit(benchmark::kMillisecond)
+	->UseManualTime();
+
+int main(int argc, char* argv[])
+{
+	MPI_Init(&argc, &argv);
+	if (world_rank() != 0) {
+		// only the first process writes the result file
+		int kept = 1;
+		for (int arg = 1; arg < argc; arg++) {
+			if (strncmp(argv[arg], "--benchmark_out", strlen("--benchmark_out"))) {
+				argv[kept++] = argv[arg];
+			}
+		}
+		argc = kept;
+	}
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+		MPI_Finalize();
+		return 1;
+	}
+	if (world_rank() == 0) {
+		benchmark::RunSpecifiedBenchmarks();
+	} else {
+		Null_reporter null_reporter;
+		benchmark::RunSpecifiedBenchmarks(&null_reporter);
+	}
+	benchmark::Shutdown();
+	MPI_Finalize();
+	return 0;
+}
@@ -0,0 +1,198 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <benchmark/benchmark.h>
+#include <netcdf.h>
+
+#include <paraconf.h>
+#include <pdi.h>
+
+namespace {
+
+const size_t data_size = 256;
+
+struct Record_type {
+	int size;
+	double data[data_size];
+};
+
+void nc_check(int status)
+{
+	if (status != NC_NOERR) {
+		fprintf(stderr, "NetCDF error: %s\n", nc_strerror(status));
+		exit(1);
+	}
+}
+
+std::unique_ptr<Record_type[]> make_records(int64_t nb_records)
+{
+	std::unique_ptr<Record_type[]> records{new Record_type[nb_records]};
+	for (int64_t record = 0; record < nb_records; record++) {
+		records[record].size = data_size;
+		for (size_t i = 0; i < data_size; i++) {
+			records[record].data[i] = (record * data_size + i) * 1.23;
+		}
+	}
+	return records;
+}
+
+/* Defines the NetCDF compound type matching `Record_type` */
+int define_record_type(int file_id)
+{
+	int record_type_id;
+	nc_check(nc_def_compound(file_id, sizeof(Record_type), "record_type", &record_type_id));
+	nc_check(nc_insert_compound(file_id, record_type_id, "size", offsetof(Record_type, size), NC_INT));
+	int dim_size = data_size;
+	nc_check(nc_insert_array_compound(file_id, record_type_id, "data", offsetof(Record_type, data), NC_DOUBLE, 1, &dim_size));
+	return record_type_id;
+}
+
+/* Creates the `record_data` variable of `nb_records` records in a new file */
+void create_record_file(const char* file_name, const Record_type* records, int64_t nb_records)
+{
+	int file_id;
+	nc_check(nc_create(file_name, NC_CLOBBER | NC_NETCDF4, &file_id));
+	int record_type_id = define_record_type(file_id);
+	int dim_id;
+	nc_check(nc_def_dim(file_id, "record_data_dim_0", nb_records, &dim_id));
+	int var_id;
+	nc_check(nc_def_var(file_id, "record_data", record_type_id, 1, &dim_id, &var_id));
+	nc_check(nc_enddef(file_id));
+	nc_check(nc_put_var(file_id, var_id, records));
+	nc_check(nc_close(file_id));
+}
+
+const char* CONFIG_YAML
+	= "logging: off                                                  \n"
+	  "metadata:                                                     \n"
+	  "  nb_records: int64                                           \n"
+	  "  size: int                                                   \n"
+	  "  input: int                                                  \n"
+	  "data:                                                         \n"
+	  "  record_data:                                                \n"
+	  "    type: array                                               \n"
+	  "    size: $nb_records                                         \n"
+	  "    subtype:                                                  \n"
+	  "      type: struct                                            \n"
+	  "      +decl_netcdf.type: record_type                          \n"
+	  "      members:                                                \n"
+	  "        - size: int                                           \n"
+	  "        - data:                                               \n"
+	  "            type: array                                       \n"
+	  "            subtype: double                                   \n"
+	  "            size: $size                                       \n"
+	  "plugins:                                                      \n"
+	  "  decl_netcdf:                                                \n"
+	  "    - file: record_data.nc                                    \n"
+	  "      when: '${input}=0'                                      \n"
+	  "      write: [record_data]                                    \n"
+	  "    - file: record_data.nc                                    \n"
+	  "      when: '${input}=1'                                      \n"
+	  "      read: [record_data]                                     \n";
+
+void pdi_init(int64_t nb_records, int input)
+{
+	PDI_init(PC_parse_string(CONFIG_YAML));
+	int size = data_size;
+	PDI_multi_expose("init", "nb_records", &nb_records, PDI_OUT, "size", &size, PDI_OUT, "input", &input, PDI_OUT, NULL);
+}
+
+} // namespace
+
+/* Writes an array of records in an existing file, the file and its compound
+ * type being defined by the first write
+ */
+static void PDI_write(benchmark::State& state)
+{
+	int64_t nb_records = state.range(0);
+	std::unique_ptr<Record_type[]> records = make_records(nb_records);
+	remove("record_data.nc");
+	pdi_init(nb_records, 0);
+	for (auto _: state) {
+		PDI_expose("record_data", records.get(), PDI_OUT);
+	}
+	PDI_finalize();
+	state.SetBytesProcessed(state.iterations() * nb_records * sizeof(Record_type));
+}
+
+BENCHMARK(PDI_write)->Name("Decl_netcdf_struct/PDI_write")->Arg(1)->Arg(1 << 10)->Arg(1 << 14);
+
+static void NetCDF_write(benchmark::State& state)
+{
+	int64_t nb_records = state.range(0);
+	std::unique_ptr<Record_type[]> records = make_records(nb_records);
+	create_record_file("record_data.nc", records.get(), nb_records);
+
+	for (auto _: state) {
+		int file_id;
+		nc_check(nc_open("record_data.nc", NC_WRITE | NC_NETCDF4, &file_id));
+		int var_id;
+		nc_check(nc_inq_varid(file_id, "record_data", &var_id));
+		nc_check(nc_put_var(file_id, var_id, records.get()));
+		nc_check(nc_close(file_id));
+	}
+	state.SetBytesProcessed(state.iterations() * nb_records * sizeof(Record_type));
+}
+
+BENCHMARK(NetCDF_write)->Name("Decl_netcdf_struct/NetCDF_write")->Arg(1)->Arg(1 << 10)->Arg(1 << 14);
+
+static void PDI_read(benchmark::State& state)
+{
+	int64_t nb_records = state.range(0);
+	std::unique_ptr<Record_type[]> records = make_records(nb_records);
+	create_record_file("record_data.nc", records.get(), nb_records);
+
+	pdi_init(nb_records, 1);
+	for (auto _: state) {
+		PDI_expose("record_data", records.get(), PDI_IN);
+	}
+	PDI_finalize();
+	state.SetBytesProcessed(state.iterations() * nb_records * sizeof(Record_type));
+}
+
+BENCHMARK(PDI_read)->Name("Decl_netcdf_struct/PDI_read")->Arg(1)->Arg(1 << 10)->Arg(1 << 14);
+
+static void NetCDF_read(benchmark::State& state)
+{
+	int64_t nb_records = state.range(0);
+	std::unique_ptr<Record_type[]> records = make_records(nb_records);
+	create_record_file("record_data.nc", records.get(), nb_records);
+
+	for (auto _: state) {
+		int file_id;
+		nc_check(nc_open("record_data.nc", NC_NOWRITE | NC_NETCDF4, &file_id));
+		int var_id;
+		nc_check(nc_inq_varid(file_id, "record_data", &var_id));
+		nc_check(nc_get_var(file_id, var_id, records.get()));
+		nc_check(nc_close(file_id));
+	}
+	state.SetBytesProcessed(state.iterations() * nb_records * sizeof(Record_type));
+}
+
+BENCHMARK(NetCDF_read)->Name("Decl_netcdf_struct/NetCDF_read")->Arg(1)->Arg(1 << 10)->Arg(1 << 14);
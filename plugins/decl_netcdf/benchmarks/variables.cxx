@@ -0,0 +1,226 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include <netcdf.h>
+
+#include <paraconf.h>
+#include <pdi.h>
+
+namespace {
+
+void nc_check(int status)
+{
+	if (status != NC_NOERR) {
+		fprintf(stderr, "NetCDF error: %s\n", nc_strerror(status));
+		exit(1);
+	}
+}
+
+std::vector<double> make_field(int64_t n)
+{
+	std::vector<double> field(n);
+	for (int64_t i = 0; i < n; i++) {
+		field[i] = i * 1.2345;
+	}
+	return field;
+}
+
+/* The PDI configuration header shared by all PDI benchmarks, with a `field` of
+ * `n` doubles, the file being opened for each write or kept open until the
+ * `close` event
+ */
+std::string pdi_header(bool persistent)
+{
+	return std::string{"logging: off                                                  \n"
+	                   "metadata:                                                     \n"
+	                   "  n: int64                                                    \n"
+	                   "  index: int                                                  \n"
+	                   "data:                                                         \n"
+	                   "  field: { type: array, subtype: double, size: $n }           \n"
+	                   "plugins:                                                      \n"
+	                   "  decl_netcdf:                                                \n"}
+	     + (persistent ? "    persistent: true                                           \n"
+	                     "    close_on: close                                            \n"
+	                   : "");
+}
+
+} // namespace
+
+/* Writes the same amount of data split in a given number of variables of a
+ * file, the file being opened for each variable or kept open for all of them
+ */
+static void PDI_write_variables(benchmark::State& state)
+{
+	int64_t count = state.range(1);
+	bool persistent = state.range(2);
+	std::string config_yaml = pdi_header(persistent)
+		+ "    file: variables.nc                                         \n"
+		  "    on_event: write_variable                                   \n"
+		  "    write:                                                     \n"
+		  "      field:                                                   \n"
+		  "        variable: 'var_${index}'                               \n";
+
+	int64_t n = state.range(0) / count;
+	std::vector<double> field = make_field(n);
+	remove("variables.nc");
+	PDI_init(PC_parse_string(config_yaml.c_str()));
+	PDI_expose("n", &n, PDI_OUT);
+	for (auto _: state) {
+		for (int index = 0; index < count; index++) {
+			PDI_multi_expose("write_variable", "index", &index, PDI_OUT, "field", field.data(), PDI_OUT, NULL);
+		}
+		PDI_event("close");
+	}
+	PDI_finalize();
+	state.SetBytesProcessed(state.iterations() * count * n * sizeof(double));
+}
+
+BENCHMARK(PDI_write_variables)
+	->Name("Decl_netcdf_variables/PDI_write_variables")
+	->ArgsProduct({{1 << 20}, {1, 16, 64}, {0, 1}})
+	->Unit(benchmark::kMillisecond);
+
+static void NetCDF_write_variables(benchmark::State& state)
+{
+	int64_t count = state.range(1);
+	bool persistent = state.range(2);
+	int64_t n = state.range(0) / count;
+	std::vector<double> field = make_field(n);
+
+	// define all variables
+	int file_id;
+	nc_check(nc_create("variables.nc", NC_CLOBBER | NC_NETCDF4, &file_id));
+	std::vector<int> var_ids(count);
+	for (int64_t index = 0; index < count; index++) {
+		std::string name = "var_" + std::to_string(index);
+		int dim_id;
+		nc_check(nc_def_dim(file_id, (name + "_dim_0").c_str(), n, &dim_id));
+		nc_check(nc_def_var(file_id, name.c_str(), NC_DOUBLE, 1, &dim_id, &var_ids[index]));
+	}
+	nc_check(nc_close(file_id));
+
+	for (auto _: state) {
+		if (persistent) {
+			nc_check(nc_open("variables.nc", NC_WRITE | NC_NETCDF4, &file_id));
+		}
+		for (int64_t index = 0; index < count; index++) {
+			std::string name = "var_" + std::to_string(index);
+			if (!persistent) {
+				nc_check(nc_open("variables.nc", NC_WRITE | NC_NETCDF4, &file_id));
+			}
+			int var_id;
+			nc_check(nc_inq_varid(file_id, name.c_str(), &var_id));
+			nc_check(nc_put_var_double(file_id, var_id, field.data()));
+			if (!persistent) {
+				nc_check(nc_close(file_id));
+			}
+		}
+		if (persistent) {
+			nc_check(nc_close(file_id));
+		}
+	}
+	state.SetBytesProcessed(state.iterations() * count * n * sizeof(double));
+}
+
+BENCHMARK(NetCDF_write_variables)
+	->Name("Decl_netcdf_variables/NetCDF_write_variables")
+	->ArgsProduct({{1 << 20}, {1, 16, 64}, {0, 1}})
+	->Unit(benchmark::kMillisecond);
+
+/* Appends a row to a variable with an unlimited dimension on each step, the
+ * file being opened for each step or kept open for all of them
+ */
+static void PDI_append(benchmark::State& state)
+{
+	bool persistent = state.range(1);
+	std::string config_yaml = pdi_header(persistent)
+		+ "    file: append.nc                                            \n"
+		  "    variables:                                                 \n"
+		  "      rows:                                                    \n"
+		  "        type: array                                            \n"
+		  "        subtype: double                                        \n"
+		  "        size: [0, $n]                                          \n"
+		  "        dimensions: [time, x]                                  \n"
+		  "    write:                                                     \n"
+		  "      field: { variable: rows }                                \n";
+
+	int64_t n = state.range(0);
+	std::vector<double> field = make_field(n);
+	remove("append.nc");
+	PDI_init(PC_parse_string(config_yaml.c_str()));
+	PDI_expose("n", &n, PDI_OUT);
+	for (auto _: state) {
+		PDI_expose("field", field.data(), PDI_OUT);
+	}
+	PDI_event("close");
+	PDI_finalize();
+	state.SetBytesProcessed(state.iterations() * n * sizeof(double));
+}
+
+BENCHMARK(PDI_append)->Name("Decl_netcdf_append/PDI_append")->ArgsProduct({{1 << 8, 1 << 14}, {0, 1}})->Iterations(256);
+
+static void NetCDF_append(benchmark::State& state)
+{
+	bool persistent = state.range(1);
+	int64_t n = state.range(0);
+	std::vector<double> field = make_field(n);
+
+	int file_id;
+	nc_check(nc_create("append.nc", NC_CLOBBER | NC_NETCDF4, &file_id));
+	int dim_ids[2];
+	nc_check(nc_def_dim(file_id, "time", NC_UNLIMITED, &dim_ids[0]));
+	nc_check(nc_def_dim(file_id, "x", n, &dim_ids[1]));
+	int var_id;
+	nc_check(nc_def_var(file_id, "rows", NC_DOUBLE, 2, dim_ids, &var_id));
+	nc_check(nc_enddef(file_id));
+	if (!persistent) {
+		nc_check(nc_close(file_id));
+	}
+
+	size_t step = 0;
+	for (auto _: state) {
+		if (!persistent) {
+			nc_check(nc_open("append.nc", NC_WRITE | NC_NETCDF4, &file_id));
+			nc_check(nc_inq_varid(file_id, "rows", &var_id));
+		}
+		size_t start[2] = {step, 0};
+		size_t count[2] = {1, static_cast<size_t>(n)};
+		nc_check(nc_put_vara_double(file_id, var_id, start, count, field.data()));
+		if (!persistent) {
+			nc_check(nc_close(file_id));
+		}
+		++step;
+	}
+	if (persistent) {
+		nc_check(nc_close(file_id));
+	}
+	state.SetBytesProcessed(state.iterations() * n * sizeof(double));
+}
+
+BENCHMARK(NetCDF_append)->Name("Decl_netcdf_append/NetCDF_append")->ArgsProduct({{1 << 8, 1 << 14}, {0, 1}})->Iterations(256);
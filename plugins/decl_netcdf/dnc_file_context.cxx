@@ -23,6 +23,7 @@
  * THE SOFTWARE.
  ******************************************************************************/
 
+#include <algorithm>
 #include <set>
 #include <netcdf.h>
 
@@ -32,6 +33,49 @@
 
 namespace decl_netcdf {
 
+namespace {
+
+/** Reads a list of events names from a single name or an array of names
+ *
+ * \param ctx context used for logging
+ * \param events_node the node to read events names from
+ * \return the events names
+ */
+std::vector<std::string> events_names(PDI::Context& ctx, PC_tree_t events_node)
+{
+	std::vector<std::string> events;
+	if (!PC_status(events_node)) {
+		if (PDI::is_list(events_node)) {
+			int len = PDI::len(events_node);
+			for (int i = 0; i < len; i++) {
+				std::string event_name = PDI::to_string(PC_get(events_node, "[%d]", i));
+				events.emplace_back(event_name);
+				ctx.logger().trace("Adding to trigger list a new event: {}", event_name);
+			}
+		} else {
+			std::string event_name = PDI::to_string(events_node);
+			events.emplace_back(event_name);
+			ctx.logger().trace("Adding to trigger list a new event: {}", event_name);
+		}
+	}
+	return events;
+}
+
+/** Returns the type of a variable in file for data of a given in-memory type
+ *
+ * \param type in-memory type of the data
+ * \return the dense version of the type (the type itself if dense, to keep its attributes)
+ */
+PDI::Datatype_sptr file_type(PDI::Datatype_sptr type)
+{
+	if (type->dense()) {
+		return type;
+	}
+	return type->densify();
+}
+
+} // namespace
+
 Dnc_file_context::Dnc_file_context(PDI::Context& ctx, PC_tree_t config)
 	: m_ctx{ctx}
 {
@@ -48,21 +92,13 @@ Dnc_file_context::Dnc_file_context(PDI::Context& ctx, PC_tree_t config)
 		m_ctx.logger().trace("Communicator defined");
 	}
 
-	std::vector<std::string> events;
-	PC_tree_t on_event_node = PC_get(config, ".on_event");
-	if (!PC_status(on_event_node)) {
-		if (PDI::is_list(on_event_node)) {
-			int len = PDI::len(on_event_node);
-			for (int i = 0; i < len; i++) {
-				std::string event_name = PDI::to_string(PC_get(on_event_node, "[%d]", i));
-				events.emplace_back(event_name);
-				m_ctx.logger().trace("Adding to trigger list a new event: {}", event_name);
-			}
-		} else {
-			std::string event_name = PDI::to_string(on_event_node);
-			events.emplace_back(event_name);
-			m_ctx.logger().trace("Adding to trigger list a new event: {}", event_name);
-		}
+	std::vector<std::string> events = events_names(m_ctx, PC_get(config, ".on_event"));
+
+	m_persistent = PDI::to_bool(PC_get(config, ".persistent"), false);
+	std::vector<std::string> sync_events = events_names(m_ctx, PC_get(config, ".sync_on"));
+	std::vector<std::string> close_events = events_names(m_ctx, PC_get(config, ".close_on"));
+	if (!m_persistent && (!sync_events.empty() || !close_events.empty())) {
+		throw PDI::Error{PDI_ERR_CONFIG, "Decl_netcdf plugin: `sync_on' and `close_on' require `persistent: true'"};
 	}
 
 	PC_tree_t when_node = PC_get(config, ".when");
@@ -151,6 +187,21 @@ Dnc_file_context::Dnc_file_context(PDI::Context& ctx, PC_tree_t config)
 		m_ctx.callbacks().add_event_callback([this](const std::string&) { this->execute(); }, event);
 	}
 
+	for (auto&& event: sync_events) {
+		m_ctx.callbacks().add_event_callback(
+			[this](const std::string&) {
+				if (this->m_nc_file) {
+					this->m_nc_file->sync();
+				}
+			},
+			event
+		);
+	}
+
+	for (auto&& event: close_events) {
+		m_ctx.callbacks().add_event_callback([this](const std::string&) { this->m_nc_file.reset(); }, event);
+	}
+
 	if (events.empty()) {
 		m_ctx.logger().debug("No on_event event defined, triggering on data share");
 		std::set<std::string> desc_triggers;
@@ -178,8 +229,48 @@ Dnc_file_context::Dnc_file_context(Dnc_file_context&& other) noexcept
 	, m_variables{std::move(other.m_variables)}
 	, m_read{std::move(other.m_read)}
 	, m_write{std::move(other.m_write)}
+	, m_sizeof{std::move(other.m_sizeof)}
+	, m_persistent{other.m_persistent}
+	, m_nc_file{std::move(other.m_nc_file)}
+	, m_records_file{std::move(other.m_records_file)}
+	, m_next_records{std::move(other.m_next_records)}
 {}
 
+Dnc_netcdf_file& Dnc_file_context::file(int rights_flag, std::unique_ptr<Dnc_netcdf_file>& file_holder)
+{
+	std::string file_path = m_file_path.to_string(m_ctx);
+	if (file_path != m_records_file) {
+		// records are counted again in the new file
+		m_next_records.clear();
+		m_records_file = file_path;
+	}
+
+	if (!m_persistent) {
+		file_holder.reset(new Dnc_netcdf_file{m_ctx, file_path, rights_flag, m_communicator});
+		return *file_holder;
+	}
+
+	if (m_nc_file && m_nc_file->filename() != file_path) {
+		m_ctx.logger().debug("File path changed from `{}' to `{}', closing persistent file", m_nc_file->filename(), file_path);
+		m_nc_file.reset();
+	}
+	if (!m_nc_file) {
+		// open with write rights only if this file is ever written, so that read-only files can be shared
+		m_nc_file.reset(new Dnc_netcdf_file{m_ctx, file_path, m_write.empty() ? NC_NOWRITE : NC_WRITE, m_communicator});
+	}
+	return *m_nc_file;
+}
+
+void Dnc_file_context::put_variable(Dnc_netcdf_file& nc_file, const Dnc_variable& variable, const Dnc_io& write, PDI::Ref_r ref_r)
+{
+	auto record_it = m_next_records.find(variable.path());
+	if (record_it == m_next_records.end()) {
+		// first write of this variable, append after the records already in the file
+		record_it = m_next_records.emplace(variable.path(), nc_file.record_count(variable)).first;
+	}
+	record_it->second = nc_file.put_variable(variable, write, ref_r, record_it->second);
+}
+
 Dnc_variable* Dnc_file_context::variable(const std::string& desc_name, const std::string& variable_path, std::list<Dnc_variable>& variables_holder)
 {
 	auto it = m_variables.find(variable_path);
@@ -209,12 +300,8 @@ void Dnc_file_context::execute(const std::string& desc_name, PDI::Ref ref)
 
 		auto write_it = m_write.find(desc_name);
 		if (write_it != m_write.end() && write_it->second.when()) {
-			Dnc_netcdf_file nc_file{m_ctx, m_file_path.to_string(m_ctx), NC_WRITE, m_communicator};
-
-			// define all groups
-			for (auto&& group: m_groups) {
-				nc_file.define_group(group.second);
-			}
+			std::unique_ptr<Dnc_netcdf_file> file_holder;
+			Dnc_netcdf_file& nc_file = file(NC_WRITE, file_holder);
 
 			// get variable of shared descriptor
 			Dnc_variable* variable = this->variable(write_it->first, write_it->second.variable_path(), variables_holder);
@@ -222,22 +309,34 @@ void Dnc_file_context::execute(const std::string& desc_name, PDI::Ref ref)
 			// ensure that variable has a type
 			if (!variable->type()) {
 				// TODO: undo the type for defined variables
-				variable->type(ref.type());
+				variable->type(file_type(ref.type()));
 			}
 
-			// define variable
-			nc_file.define_variable(*variable);
+			// a persistent file stays in data mode once its variable is defined
+			if (!nc_file.has_variable(variable->path())) {
+				// define all groups
+				for (auto&& group: m_groups) {
+					nc_file.define_group(group.second);
+				}
+
+				// define variable
+				nc_file.define_variable(*variable);
+			} else {
+				// the attributes $-expressions might have changed since the definition
+				nc_file.update_variable_attributes(*variable);
+			}
 
 			// end NetCDF definition mode
 			nc_file.enddef();
 
 			// execute write
-			nc_file.put_variable(*variable, write_it->second, ref);
+			put_variable(nc_file, *variable, write_it->second, ref);
 		}
 
 		auto read_it = m_read.find(desc_name);
 		if (read_it != m_read.end() && read_it->second.when()) {
-			Dnc_netcdf_file nc_file{m_ctx, m_file_path.to_string(m_ctx), NC_NOWRITE, m_communicator};
+			std::unique_ptr<Dnc_netcdf_file> file_holder;
+			Dnc_netcdf_file& nc_file = file(NC_NOWRITE, file_holder);
 
 			// read all groups
 			for (auto&& group: m_groups) {
@@ -250,19 +349,23 @@ void Dnc_file_context::execute(const std::string& desc_name, PDI::Ref ref)
 			// ensure that variable has a type
 			if (!variable->type()) {
 				// TODO: undo the type for defined variables
-				variable->type(ref.type());
+				variable->type(file_type(ref.type()));
 			}
 
 			// read variable (could be done in get_variable, but we want to be coherent with write)
 			nc_file.read_variable(*variable);
 
+			// a persistent file opened to write might still be in define mode
+			nc_file.enddef();
+
 			// execute read
 			nc_file.get_variable(*variable, read_it->second, ref);
 		}
 
 		auto size_it = m_sizeof.find(desc_name);
 		if (size_it != m_sizeof.end() && size_it->second.when()) {
-			Dnc_netcdf_file nc_file{m_ctx, m_file_path.to_string(m_ctx), NC_NOWRITE, m_communicator};
+			std::unique_ptr<Dnc_netcdf_file> file_holder;
+			Dnc_netcdf_file& nc_file = file(NC_NOWRITE, file_holder);
 			std::string dataset_name = size_it->second.variable_path();
 			m_ctx.logger().trace("Getting size of `{}' dataset", dataset_name);
 			nc_file.get_sizeof_variable(size_it->first, dataset_name, ref);
@@ -277,13 +380,12 @@ void Dnc_file_context::execute()
 		std::vector<Dnc_variable*> variables_to_get;
 		std::vector<Dnc_variable*> variables_to_put;
 
-		std::unique_ptr<Dnc_netcdf_file> nc_file;
+		std::unique_ptr<Dnc_netcdf_file> file_holder;
+		Dnc_netcdf_file& nc_file = file(m_write.empty() ? NC_NOWRITE : NC_WRITE, file_holder);
 		if (m_write.empty()) {
-			nc_file.reset(new Dnc_netcdf_file{m_ctx, m_file_path.to_string(m_ctx), NC_NOWRITE, m_communicator});
-
 			// read all groups
 			for (auto&& group: m_groups) {
-				nc_file->read_group(group.second);
+				nc_file.read_group(group.second);
 			}
 
 			// read all variables
@@ -294,25 +396,17 @@ void Dnc_file_context::execute()
 				// ensure that variable has a type
 				if (!variable->type()) {
 					// TODO: undo the type for defined variables
-					variable->type(m_ctx.desc(read.first).ref().type());
+					variable->type(file_type(m_ctx.desc(read.first).ref().type()));
 				}
 
 				// read this variable
-				nc_file->read_variable(*variable);
+				nc_file.read_variable(*variable);
 			}
 
 			for (auto&& size_of: m_sizeof) {
-				nc_file->get_sizeof_variable(size_of.first, size_of.second.variable_path(), m_ctx.desc(size_of.first).ref());
+				nc_file.get_sizeof_variable(size_of.first, size_of.second.variable_path(), m_ctx.desc(size_of.first).ref());
 			}
 		} else {
-			nc_file.reset(new Dnc_netcdf_file{m_ctx, m_file_path.to_string(m_ctx), NC_WRITE, m_communicator});
-
-			// define all groups
-			for (auto&& group: m_groups) {
-				nc_file->define_group(group.second);
-			}
-
-			// define all variables
 			for (auto&& write: m_write) {
 				Dnc_variable* variable = this->variable(write.first, write.second.variable_path(), variables_holder);
 				variables_to_put.emplace_back(variable);
@@ -320,29 +414,47 @@ void Dnc_file_context::execute()
 				// ensure that variable has a type
 				if (!variable->type()) {
 					// TODO: undo the type for defined variables
-					variable->type(m_ctx.desc(write.first).ref().type());
+					variable->type(file_type(m_ctx.desc(write.first).ref().type()));
 				}
-
-				// define this variable
-				nc_file->define_variable(*variable);
 			}
 
-			// end NetCDF definition mode
-			nc_file->enddef();
+			// a persistent file stays in data mode once all its variables are defined
+			bool all_defined = std::all_of(variables_to_put.begin(), variables_to_put.end(), [&nc_file](Dnc_variable* variable) {
+				return nc_file.has_variable(variable->path());
+			});
+			if (!all_defined) {
+				// define all groups
+				for (auto&& group: m_groups) {
+					nc_file.define_group(group.second);
+				}
+
+				// define all variables
+				for (auto&& variable: variables_to_put) {
+					nc_file.define_variable(*variable);
+				}
+			} else {
+				// the attributes $-expressions might have changed since the definition
+				for (auto&& variable: variables_to_put) {
+					nc_file.update_variable_attributes(*variable);
+				}
+			}
 		}
 
+		// end NetCDF definition mode
+		nc_file.enddef();
+
 		int i = 0;
 		for (auto&& write: m_write) {
 			Dnc_variable* variable = variables_to_put[i]; // order of loop iteration is the same as was on define loop
 			m_ctx.logger().trace("{}: Putting desc `{}' to variable `{}'", i, write.first, variables_to_put[i]->path());
-			nc_file->put_variable(*variable, write.second, m_ctx.desc(write.first).ref());
+			put_variable(nc_file, *variable, write.second, m_ctx.desc(write.first).ref());
 			i++;
 		}
 
 		i = 0;
 		for (auto&& read: m_read) {
 			Dnc_variable* variable = variables_to_get[i]; // order of loop iteration is the same as was on define loop
-			nc_file->get_variable(*variable, read.second, m_ctx.desc(read.first).ref());
+			nc_file.get_variable(*variable, read.second, m_ctx.desc(read.first).ref());
 			i++;
 		}
 	}
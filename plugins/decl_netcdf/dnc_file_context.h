@@ -28,6 +28,7 @@
 
 #include <list>
 #include <map>
+#include <memory>
 
 #include <pdi/pdi_fwd.h>
 #include <pdi/expression.h>
@@ -35,6 +36,7 @@
 
 #include "dnc_group.h"
 #include "dnc_io.h"
+#include "dnc_netcdf_file.h"
 #include "dnc_variable.h"
 
 namespace decl_netcdf {
@@ -69,6 +71,38 @@ class Dnc_file_context
 	/// Map of desc name to Size_of operation on NetCDF file
 	std::unordered_map<std::string, Dnc_io > m_sizeof;
 
+	/// Whether the file is kept open across triggers
+	bool m_persistent = false;
+
+	/// The file kept open across triggers in persistent mode, null when closed
+	std::unique_ptr<Dnc_netcdf_file> m_nc_file;
+
+	/// Path of the file the records counts of m_next_records refer to
+	std::string m_records_file;
+
+	/// Map of variable path to the index of the next record to append in its unlimited dimension
+	std::unordered_map<std::string, size_t> m_next_records;
+
+	/** Returns the file to operate on
+	 *
+	 * In persistent mode, this is the file kept open across triggers (opened if needed), otherwise the file is opened
+	 * and owned by `file_holder` for the duration of the operation.
+	 *
+	 * \param rights_flag right flag used to open the file when not in persistent mode
+	 * \param file_holder holder of the file opened when not in persistent mode
+	 * \return the file to operate on
+	 */
+	Dnc_netcdf_file& file(int rights_flag, std::unique_ptr<Dnc_netcdf_file>& file_holder);
+
+	/** Puts variable to the file, appending to its unlimited dimension after the previously written records
+	 *
+	 * \param nc_file file to write to
+	 * \param variable variable to put
+	 * \param write Dnc_io that deteremines the write operation
+	 * \param ref_r reference where from get data to put
+	 */
+	void put_variable(Dnc_netcdf_file& nc_file, const Dnc_variable& variable, const Dnc_io& write, PDI::Ref_r ref_r);
+
 	/** Execute all I/O operations (called on event)
 	 *
 	 */
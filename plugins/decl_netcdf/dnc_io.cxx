@@ -83,6 +83,16 @@ bool Dnc_io::when() const
 	}
 }
 
+bool Dnc_io::has_start() const
+{
+	return !m_start.empty();
+}
+
+bool Dnc_io::has_subsize() const
+{
+	return !m_subsize.empty();
+}
+
 std::vector<size_t> Dnc_io::get_dims_start(const std::vector<size_t>& var_stride) const
 {
 	std::vector<size_t> var_start;
@@ -72,6 +72,18 @@ public:
 	 */
 	bool when() const;
 
+	/** Checks whether the start of the hyperslab is defined
+	 *
+	 * \return true if `start' is defined in the variable selection
+	 */
+	bool has_start() const;
+
+	/** Checks whether the count of the hyperslab is defined
+	 *
+	 * \return true if `subsize' is defined in the variable selection
+	 */
+	bool has_subsize() const;
+
 	/** Creates vector with start for variable hyperslab
 	 *
 	 * \param stride vector with stride of variable
@@ -29,6 +29,8 @@
 #include <mpi.h>
 #include <netcdf_par.h>
 #endif
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -98,6 +100,44 @@ const PDI::Datatype_sptr get_variable_stride(PDI::Datatype_sptr type, std::vecto
 	return type;
 }
 
+/** Computes where the selected data of an in-memory type starts when it is contiguous
+ *
+ * The selection is contiguous if, from the innermost dimension, once a dimension is partially selected all outer
+ * dimensions select a single element.
+ *
+ * \param[in] type in-memory type of the data
+ * \param[out] offset offset in bytes of the first selected element
+ *
+ * \return true if the selected data is contiguous
+ */
+bool contiguous_selection(PDI::Datatype_sptr type, size_t& offset)
+{
+	std::vector<std::shared_ptr<const PDI::Array_datatype>> array_types;
+	while (auto&& array_type = std::dynamic_pointer_cast<const PDI::Array_datatype>(type)) {
+		array_types.emplace_back(array_type);
+		type = array_type->subtype();
+	}
+	if (!type->dense()) {
+		return false;
+	}
+
+	offset = 0;
+	size_t element_size = type->buffersize();
+	bool partial = false;
+	for (auto array_it = array_types.rbegin(); array_it != array_types.rend(); ++array_it) {
+		auto&& array_type = *array_it;
+		if (partial && array_type->subsize() != 1) {
+			return false;
+		}
+		if (array_type->subsize() != array_type->size()) {
+			partial = true;
+		}
+		offset += array_type->start() * element_size;
+		element_size *= array_type->size();
+	}
+	return true;
+}
+
 /** Wraps the calling of netcdf call with status checking
  *
  * \param status status returned from netcdf call
@@ -169,10 +209,7 @@ Dnc_netcdf_file::Dnc_netcdf_file(PDI::Context& ctx, const std::string& filename,
 				"Cannot open or create file: {}",
 				m_filename
 			);
-		} else {
-			if (rights_flag == NC_WRITE) {
-				nc_try(nc_redef(m_file_id), "File opened to write, but cannot get define mode");
-			}
+			m_define_mode = true;
 		}
 #else
 		throw PDI::Error{PDI_ERR_SYSTEM, "Decl_netcdf plugin: MPI communicator defined, but NetCDF is not parallel"};
@@ -182,10 +219,7 @@ Dnc_netcdf_file::Dnc_netcdf_file(PDI::Context& ctx, const std::string& filename,
 		if (nc_open(m_filename.c_str(), rights_flag | NC_NETCDF4, &m_file_id) != NC_NOERR) {
 			m_ctx.logger().trace("Cannot open `{}' file, creating", m_filename);
 			nc_try(nc_create(m_filename.c_str(), rights_flag | NC_NETCDF4 | NC_NOCLOBBER, &m_file_id), "Cannot open or create file: {}", m_filename);
-		} else {
-			if (rights_flag == NC_WRITE) {
-				nc_try(nc_redef(m_file_id), "File opened to write, but cannot get define mode");
-			}
+			m_define_mode = true;
 		}
 	}
 
@@ -199,8 +233,17 @@ Dnc_netcdf_file::Dnc_netcdf_file(Dnc_netcdf_file&& other) noexcept
 	: m_ctx{other.m_ctx}
 	, m_filename{std::move(other.m_filename)}
 	, m_file_id{std::move(other.m_file_id)}
+	, m_communicator{std::move(other.m_communicator)}
+	, m_define_mode{other.m_define_mode}
 	, m_groups{std::move(other.m_groups)}
 	, m_variables{std::move(other.m_variables)}
+	, m_created_variables{std::move(other.m_created_variables)}
+	, m_initial_records{std::move(other.m_initial_records)}
+	, m_buffer{std::move(other.m_buffer)}
+	, m_types{std::move(other.m_types)}
+	, m_dimensions{std::move(other.m_dimensions)}
+	, m_attribute_values{std::move(other.m_attribute_values)}
+	, m_variables_dimensions{std::move(other.m_variables_dimensions)}
 {}
 
 void Dnc_netcdf_file::read_group(const Dnc_group& group)
@@ -210,13 +253,16 @@ void Dnc_netcdf_file::read_group(const Dnc_group& group)
 	std::vector<std::string> groups_names = split_to_groups(group.path());
 	int group_id = m_file_id;
 	for (auto&& group_name: groups_names) {
-		nc_try(nc_inq_grp_ncid(dest_id, group_name.c_str(), &group_id), "Cannot read {} group from (nc_id = {})", group_name, dest_id);
-
-		m_ctx.logger().trace("Read `{}' group (nc_id = {}) in (nc_id = {})", dest_path + "/" + group_name, group_id, dest_id);
-
-		dest_id = group_id;
 		dest_path += "/" + group_name;
-		m_groups.emplace(dest_path, dest_id);
+		auto group_it = m_groups.find(dest_path);
+		if (group_it != m_groups.end()) {
+			group_id = group_it->second;
+		} else {
+			nc_try(nc_inq_grp_ncid(dest_id, group_name.c_str(), &group_id), "Cannot read {} group from (nc_id = {})", group_name, dest_id);
+			m_ctx.logger().trace("Read `{}' group (nc_id = {}) in (nc_id = {})", dest_path, group_id, dest_id);
+			m_groups.emplace(dest_path, group_id);
+		}
+		dest_id = group_id;
 	}
 
 	for (auto&& attribute: group.attributes()) {
@@ -231,14 +277,19 @@ void Dnc_netcdf_file::define_group(const Dnc_group& group)
 	std::vector<std::string> groups_names = split_to_groups(group.path());
 	int group_id = m_file_id;
 	for (auto&& group_name: groups_names) {
-		if (nc_inq_grp_ncid(dest_id, group_name.c_str(), &group_id) != NC_NOERR) {
-			nc_try(nc_def_grp(dest_id, group_name.c_str(), &group_id), "Cannot define group {} in nc_id = {}", group_name, dest_id);
-			m_ctx.logger().trace("Defined `{}' group (nc_id = {}) in (nc_id = {})", dest_path + "/" + group_name, group_id, dest_id);
+		dest_path += "/" + group_name;
+		auto group_it = m_groups.find(dest_path);
+		if (group_it != m_groups.end()) {
+			group_id = group_it->second;
+		} else {
+			if (nc_inq_grp_ncid(dest_id, group_name.c_str(), &group_id) != NC_NOERR) {
+				redef();
+				nc_try(nc_def_grp(dest_id, group_name.c_str(), &group_id), "Cannot define group {} in nc_id = {}", group_name, dest_id);
+				m_ctx.logger().trace("Defined `{}' group (nc_id = {}) in (nc_id = {})", dest_path, group_id, dest_id);
+			}
+			m_groups.emplace(dest_path, group_id);
 		}
-
 		dest_id = group_id;
-		dest_path += "/" + group_name;
-		m_groups.emplace(dest_path, dest_id);
 	}
 
 	for (auto&& attribute: group.attributes()) {
@@ -289,22 +340,64 @@ void Dnc_netcdf_file::read_variable(const Dnc_variable& variable)
 
 namespace {
 
-int get_dimension_id(PDI::Context& ctx, int nc_dest_id, const std::string& dim_name, int type_dim)
+/// Maximum size in bytes of automatically computed chunks
+constexpr size_t AUTO_CHUNK_TARGET_SIZE = 1 << 20;
+
+/** Computes a chunk size for a variable
+ *
+ * The chunk starts as the whole variable with a size of 1 in unlimited
+ * dimensions, the largest dimension is then halved until the chunk fits in the
+ * target size.
+ *
+ * \param sizes the size of the variable in each dimension (0 for unlimited)
+ * \param element_size the size in bytes of one element of the variable
+ * \return the chunk size in each dimension
+ */
+std::vector<size_t> auto_chunking(const std::vector<size_t>& sizes, size_t element_size)
 {
-	int dim_id;
-	if (nc_inq_dimid(nc_dest_id, dim_name.c_str(), &dim_id) == NC_NOERR) {
-		ctx.logger().debug("`{}' dimension is already defined", dim_name);
-		size_t dim_len;
-		nc_try(nc_inq_dimlen(nc_dest_id, dim_id, &dim_len), "Cannot inquire dimension length");
-	} else {
-		ctx.logger().debug("Defining `{}' dimension", dim_name);
-		nc_try(nc_def_dim(nc_dest_id, dim_name.c_str(), type_dim, &dim_id), "Cannot define {} dimension", dim_name);
+	std::vector<size_t> chunk = sizes;
+	for (auto&& size: chunk) {
+		if (size == NC_UNLIMITED) {
+			size = 1;
+		}
 	}
-	return dim_id;
+	auto chunk_bytes = [&]() {
+		size_t result = element_size;
+		for (auto&& size: chunk) {
+			result *= size;
+		}
+		return result;
+	};
+	while (chunk_bytes() > AUTO_CHUNK_TARGET_SIZE) {
+		// max_element returns the first largest, i.e. the outermost one on ties
+		auto&& largest = std::max_element(chunk.begin(), chunk.end());
+		if (*largest <= 1) break;
+		*largest = (*largest + 1) / 2;
+	}
+	return chunk;
 }
 
 } // namespace
 
+Dnc_netcdf_file::nc_id Dnc_netcdf_file::dimension_id(nc_id dest_id, const std::string& dim_name, size_t dim_len)
+{
+	auto dimension_it = m_dimensions.find({dest_id, dim_name});
+	if (dimension_it != m_dimensions.end()) {
+		return dimension_it->second;
+	}
+
+	nc_id dim_id;
+	if (nc_inq_dimid(dest_id, dim_name.c_str(), &dim_id) == NC_NOERR) {
+		m_ctx.logger().debug("`{}' dimension is already defined", dim_name);
+	} else {
+		m_ctx.logger().debug("Defining `{}' dimension", dim_name);
+		redef();
+		nc_try(nc_def_dim(dest_id, dim_name.c_str(), dim_len, &dim_id), "Cannot define {} dimension", dim_name);
+	}
+	m_dimensions.emplace(std::make_pair(dest_id, dim_name), dim_id);
+	return dim_id;
+}
+
 nc_type Dnc_netcdf_file::define_compound_type(std::shared_ptr<const PDI::Record_datatype> record_type)
 {
 	nc_type type_id;
@@ -315,9 +408,15 @@ nc_type Dnc_netcdf_file::define_compound_type(std::shared_ptr<const PDI::Record_
 		throw PDI::Value_error{"Cannot get `decl_netcdf.type' attribute from: {}", record_type->debug_string()};
 	}
 
+	auto type_it = m_types.find(compound_type_name);
+	if (type_it != m_types.end()) {
+		return type_it->second;
+	}
+
 	int status = nc_inq_typeid(m_file_id, compound_type_name.c_str(), &type_id);
 	if (status == NC_NOERR) {
 		m_ctx.logger().trace("{} type already defined: (nc_type = {})", compound_type_name, type_id);
+		m_types.emplace(compound_type_name, type_id);
 		return type_id;
 	}
 
@@ -346,6 +445,7 @@ nc_type Dnc_netcdf_file::define_compound_type(std::shared_ptr<const PDI::Record_
 	}
 
 	m_ctx.logger().debug("Defining new compound type: {} ({} B)", compound_type_name, record_type->buffersize());
+	redef();
 	nc_try(nc_def_compound(m_file_id, record_type->buffersize(), compound_type_name.c_str(), &type_id), "Cannot define record type");
 
 	for (auto&& member: record_type->members()) {
@@ -380,6 +480,7 @@ nc_type Dnc_netcdf_file::define_compound_type(std::shared_ptr<const PDI::Record_
 		}
 	}
 	m_ctx.logger().trace("Complete defining new compound type: {} (nc_type = {}): ", compound_type_name, type_id, record_type->debug_string());
+	m_types.emplace(compound_type_name, type_id);
 	return type_id;
 }
 
@@ -446,7 +547,7 @@ void Dnc_netcdf_file::define_variable(const Dnc_variable& variable)
 			for (int i = 0; i < sizes.size(); i++) {
 				std::string dim_name = variable_name + "_" + std::to_string(i);
 				m_ctx.logger().trace("\t {}[{}]", dim_name, sizes[i]);
-				dimensions_ids.emplace_back(get_dimension_id(m_ctx, dest_id, dim_name, sizes[i]));
+				dimensions_ids.emplace_back(dimension_id(dest_id, dim_name, sizes[i]));
 			}
 		} else {
 			if (sizes.size() != dimensions_names.size()) {
@@ -461,11 +562,12 @@ void Dnc_netcdf_file::define_variable(const Dnc_variable& variable)
 			for (int i = 0; i < dimensions_names.size(); i++) {
 				std::string dim_name = dimensions_names[i];
 				m_ctx.logger().trace("\t {}[{}]", dim_name, sizes[i]);
-				dimensions_ids.emplace_back(get_dimension_id(m_ctx, dest_id, dim_name, sizes[i]));
+				dimensions_ids.emplace_back(dimension_id(dest_id, dim_name, sizes[i]));
 			}
 		}
 
 		m_ctx.logger().trace("Defining variable `{}' in (nc_id = {}) of type (nc_id = {})", variable.path(), dest_id, type_id);
+		redef();
 		nc_try(
 			nc_def_var(dest_id, variable_name.c_str(), type_id, dimensions_ids.size(), dimensions_ids.data(), &var_id),
 			"Cannot define `{}' variable in (nc_id = {})",
@@ -473,6 +575,9 @@ void Dnc_netcdf_file::define_variable(const Dnc_variable& variable)
 			dest_id
 		);
 		m_ctx.logger().trace("Variable `{}' defined (var_id = {})", variable.path(), var_id);
+		m_created_variables.emplace(variable.path());
+
+		define_storage(dest_id, var_id, variable, sizes, type->buffersize());
 	}
 
 	m_variables.emplace(variable.path(), var_id);
@@ -488,6 +593,66 @@ void Dnc_netcdf_file::define_variable(const Dnc_variable& variable)
 	for (auto&& attribute: variable.attributes()) {
 		m_ctx.logger().trace("Putting attribute {} to `{}' variable", attribute.name(), variable_name);
 		this->put_attribute(dest_id, var_id, attribute);
+		cache_attribute(variable.path(), attribute, attribute.value());
+	}
+}
+
+void Dnc_netcdf_file::define_storage(nc_id dest_id, nc_id var_id, const Dnc_variable& variable, const std::vector<size_t>& sizes, size_t element_size)
+{
+	long deflate = variable.deflate();
+	bool shuffle = variable.shuffle();
+	std::string quantize_mode = variable.quantize_mode();
+
+	std::vector<size_t> chunking = variable.chunking();
+	if (chunking.empty() && variable.chunking_auto()) {
+		chunking = auto_chunking(sizes, element_size);
+	}
+	if (!chunking.empty()) {
+		if (chunking.size() != sizes.size()) {
+			throw PDI::Error{
+				PDI_ERR_VALUE,
+				"Decl_netcdf plugin: Variable {}: chunking dimension ({}) != variable dimension ({})",
+				variable.path(),
+				chunking.size(),
+				sizes.size()
+			};
+		}
+		m_ctx.logger().trace("Chunking `{}' variable with chunks of [{}]", variable.path(), fmt::join(chunking, ", "));
+		nc_try(nc_def_var_chunking(dest_id, var_id, NC_CHUNKED, chunking.data()), "Cannot set chunking of `{}' variable", variable.path());
+	}
+
+	if (deflate != -1 || shuffle) {
+		m_ctx.logger().trace("Compressing `{}' variable (shuffle = {}, deflate = {})", variable.path(), shuffle, deflate);
+		nc_try(
+			nc_def_var_deflate(dest_id, var_id, shuffle, deflate != -1, std::max(deflate, 0L)),
+			"Cannot set compression of `{}' variable",
+			variable.path()
+		);
+	}
+
+	if (!quantize_mode.empty()) {
+#if NC_HAS_QUANTIZE
+		int mode;
+		if (quantize_mode == "bitgroom") {
+			mode = NC_QUANTIZE_BITGROOM;
+		} else if (quantize_mode == "granularbr") {
+			mode = NC_QUANTIZE_GRANULARBR;
+		} else if (quantize_mode == "bitround") {
+			mode = NC_QUANTIZE_BITROUND;
+		} else {
+			throw PDI::Error{
+				PDI_ERR_VALUE,
+				"Decl_netcdf plugin: Variable {}: invalid quantize mode `{}', expecting `bitgroom', `granularbr' or `bitround'",
+				variable.path(),
+				quantize_mode
+			};
+		}
+		long nsd = variable.quantize_nsd();
+		m_ctx.logger().trace("Quantizing `{}' variable ({}, nsd = {})", variable.path(), quantize_mode, nsd);
+		nc_try(nc_def_var_quantize(dest_id, var_id, mode, nsd), "Cannot set quantization of `{}' variable", variable.path());
+#else
+		throw PDI::Error{PDI_ERR_SYSTEM, "Decl_netcdf plugin: Variable {}: quantization requires NetCDF 4.9.0 or newer", variable.path()};
+#endif
 	}
 }
 
@@ -533,6 +698,7 @@ void Dnc_netcdf_file::get_attribute(nc_id src_id, nc_id var_id, const Dnc_attrib
 void Dnc_netcdf_file::put_attribute(nc_id dest_id, nc_id var_id, const Dnc_attribute& attribute)
 {
 	m_ctx.logger().trace("Putting `{}' attribute to (nc_id = {}/{})", attribute.name(), dest_id, var_id);
+	redef();
 	nc_del_att(dest_id, var_id, attribute.name().c_str()); // try to delete old attribute, if fails nothing happens
 	if (PDI::Ref_r ref_r = attribute.value()) {
 		if (auto&& scalar_type = std::dynamic_pointer_cast<const PDI::Scalar_datatype>(ref_r.type())) {
@@ -569,13 +735,162 @@ void Dnc_netcdf_file::put_attribute(nc_id dest_id, nc_id var_id, const Dnc_attri
 	}
 }
 
-void Dnc_netcdf_file::enddef() const
+bool Dnc_netcdf_file::same_attribute(const std::string& variable_path, nc_id dest_id, nc_id var_id, const Dnc_attribute& attribute, PDI::Ref_r ref_r)
+{
+	PDI::Datatype_sptr type = ref_r.type();
+	size_t count = 1;
+	if (auto&& array_type = std::dynamic_pointer_cast<const PDI::Array_datatype>(type)) {
+		count = array_type->size();
+		type = array_type->subtype();
+	}
+	auto&& scalar_type = std::dynamic_pointer_cast<const PDI::Scalar_datatype>(type);
+	if (!scalar_type || !ref_r.type()->dense()) {
+		// not supported, let put_attribute report it
+		return false;
+	}
+	const uint8_t* value = static_cast<const uint8_t*>(ref_r.get());
+
+	auto&& cached = m_attribute_values.find({variable_path, attribute.name()});
+	if (cached != m_attribute_values.end()) {
+		return *cached->second.first == *ref_r.type() && cached->second.second.size() == ref_r.type()->buffersize()
+		    && std::equal(cached->second.second.begin(), cached->second.second.end(), value);
+	}
+
+	// first access since the file was opened, compare to the file
+	nc_type file_type;
+	size_t file_count;
+	if (nc_inq_att(dest_id, var_id, attribute.name().c_str(), &file_type, &file_count) != NC_NOERR) {
+		return false;
+	}
+	if (file_type != nc_scalar_type(*scalar_type) || file_count != count) {
+		return false;
+	}
+	std::vector<uint8_t> file_value(ref_r.type()->buffersize());
+	if (nc_get_att(dest_id, var_id, attribute.name().c_str(), file_value.data()) != NC_NOERR) {
+		return false;
+	}
+	return std::equal(file_value.begin(), file_value.end(), value);
+}
+
+void Dnc_netcdf_file::cache_attribute(const std::string& variable_path, const Dnc_attribute& attribute, PDI::Ref_r ref_r)
+{
+	if (!ref_r || !ref_r.type()->dense()) return;
+	const uint8_t* value = static_cast<const uint8_t*>(ref_r.get());
+	auto& cached = m_attribute_values[{variable_path, attribute.name()}];
+	cached.first = ref_r.type();
+	cached.second.assign(value, value + ref_r.type()->buffersize());
+}
+
+void Dnc_netcdf_file::update_variable_attributes(const Dnc_variable& variable)
+{
+	auto variable_it = m_variables.find(variable.path());
+	if (variable_it == m_variables.end()) {
+		throw PDI::Error{PDI_ERR_VALUE, "Decl_netcdf plugin: Variable `{}' not defined", variable.path()};
+	}
+	auto [group_path, variable_name] = split_group_and_variable(variable.path());
+	nc_id dest_id = m_groups.at(group_path);
+	for (auto&& attribute: variable.attributes()) {
+		PDI::Ref_r ref_r = attribute.value();
+		if (!ref_r) {
+			// nothing to put
+			continue;
+		}
+		if (!same_attribute(variable.path(), dest_id, variable_it->second, attribute, ref_r)) {
+			m_ctx.logger().trace("Updating attribute {} of `{}' variable", attribute.name(), variable_name);
+			this->put_attribute(dest_id, variable_it->second, attribute);
+		}
+		cache_attribute(variable.path(), attribute, ref_r);
+	}
+}
+
+bool Dnc_netcdf_file::has_variable(const std::string& variable_path) const
+{
+	return m_variables.find(variable_path) != m_variables.end();
+}
+
+void Dnc_netcdf_file::redef()
+{
+	if (!m_define_mode) {
+		nc_try(nc_redef(m_file_id), "File opened to write, but cannot get define mode");
+		m_define_mode = true;
+		m_ctx.logger().debug("Define mode begin in file {} (nc_id = {})", m_filename, m_file_id);
+	}
+}
+
+void Dnc_netcdf_file::enddef()
+{
+	if (m_define_mode) {
+		nc_try(nc_enddef(m_file_id), "Cannot end define mode");
+		m_define_mode = false;
+		m_ctx.logger().debug("Define mode end in file {} (nc_id = {})", m_filename, m_file_id);
+	}
+}
+
+void Dnc_netcdf_file::sync()
+{
+	enddef();
+	nc_try(nc_sync(m_file_id), "Cannot sync the file {}", m_filename);
+	m_ctx.logger().debug("File {} synced (nc_id = {})", m_filename, m_file_id);
+}
+
+const std::string& Dnc_netcdf_file::filename() const
+{
+	return m_filename;
+}
+
+size_t Dnc_netcdf_file::record_count(const Dnc_variable& variable)
+{
+	std::vector<size_t> var_stride;
+	get_variable_stride(variable.type(), var_stride);
+	if (std::find(var_stride.begin(), var_stride.end(), NC_UNLIMITED) == var_stride.end()
+	    || m_created_variables.find(variable.path()) != m_created_variables.end())
+	{
+		return 0;
+	}
+
+	auto [group_path, variable_name] = split_group_and_variable(variable.path());
+	auto group_it = m_groups.find(group_path);
+	auto var_it = m_variables.find(variable.path());
+	if (group_it == m_groups.end() || var_it == m_variables.end()) {
+		throw PDI::Error{PDI_ERR_VALUE, "Decl_netcdf plugin: Cannot find variable that should be created: {}", variable.path()};
+	}
+
+	const std::vector<nc_id>& dim_ids = variable_dimensions(variable.path(), group_it->second, var_it->second);
+	size_t result = 0;
+	for (size_t dim = 0; dim < var_stride.size(); ++dim) {
+		if (var_stride[dim] == NC_UNLIMITED) {
+			result = std::max(result, initial_records(group_it->second, dim_ids[dim]));
+		}
+	}
+	m_ctx.logger().trace("Variable `{}' has {} records", variable.path(), result);
+	return result;
+}
+
+const std::vector<Dnc_netcdf_file::nc_id>& Dnc_netcdf_file::variable_dimensions(const std::string& variable_path, nc_id group_id, nc_id var_id)
 {
-	nc_try(nc_enddef(m_file_id), "Cannot end define mode");
-	m_ctx.logger().debug("Define mode end in file {} (nc_id = {})", m_filename, m_file_id);
+	auto dimensions_it = m_variables_dimensions.find(variable_path);
+	if (dimensions_it == m_variables_dimensions.end()) {
+		int ndims;
+		nc_try(nc_inq_varndims(group_id, var_id, &ndims), "Cannot inquire dimensions count of `{}'", variable_path);
+		std::vector<nc_id> dim_ids(ndims);
+		nc_try(nc_inq_vardimid(group_id, var_id, dim_ids.data()), "Cannot inquire dimensions of `{}'", variable_path);
+		dimensions_it = m_variables_dimensions.emplace(variable_path, std::move(dim_ids)).first;
+	}
+	return dimensions_it->second;
 }
 
-void Dnc_netcdf_file::put_variable(const Dnc_variable& variable, const Dnc_io& write, PDI::Ref_r ref_r)
+size_t Dnc_netcdf_file::initial_records(nc_id group_id, nc_id dim_id)
+{
+	auto records_it = m_initial_records.find({group_id, dim_id});
+	if (records_it == m_initial_records.end()) {
+		size_t dim_len;
+		nc_try(nc_inq_dimlen(group_id, dim_id, &dim_len), "Cannot inquire dimension length");
+		records_it = m_initial_records.emplace(std::make_pair(group_id, dim_id), dim_len).first;
+	}
+	return records_it->second;
+}
+
+size_t Dnc_netcdf_file::put_variable(const Dnc_variable& variable, const Dnc_io& write, PDI::Ref_r ref_r, size_t next_record)
 {
 	// check access
 	if (!ref_r) {
@@ -604,19 +919,53 @@ void Dnc_netcdf_file::put_variable(const Dnc_variable& variable, const Dnc_io& w
 	std::vector<size_t> var_start = write.get_dims_start(var_stride);
 	std::vector<size_t> var_count = write.get_dims_count(var_stride);
 
+	// append records in unlimited dimensions
+	if (!write.has_start() && std::count(var_stride.begin(), var_stride.end(), NC_UNLIMITED) > 1) {
+		throw PDI::Error{PDI_ERR_VALUE, "Decl_netcdf plugin: Cannot append to `{}' with multiple unlimited dimensions, define a start", variable.path()};
+	}
+	size_t record_end = next_record;
+	for (size_t dim = 0; dim < var_stride.size(); ++dim) {
+		if (var_stride[dim] == NC_UNLIMITED) {
+			// keep the length before this write for the other variables of the dimension
+			initial_records(dest_id, variable_dimensions(variable.path(), dest_id, var_id)[dim]);
+			if (!write.has_start()) {
+				var_start[dim] = next_record;
+			}
+			if (!write.has_subsize()) {
+				var_count[dim] = 1;
+			}
+			record_end = std::max(record_end, var_start[dim] + var_count[dim]);
+			m_ctx.logger().trace("Writing records [{}, {}) of `{}'", var_start[dim], var_start[dim] + var_count[dim], variable.path());
+		}
+	}
+
+	// write contiguous data in place, pack sparse data
+	const void* data = ref_r.get();
+	size_t offset;
+	if (contiguous_selection(ref_r.type(), offset)) {
+		data = static_cast<const uint8_t*>(data) + offset;
+	} else {
+		m_ctx.logger().trace("Packing sparse data of `{}' variable", variable_name);
+		m_buffer.resize(ref_r.type()->densify()->buffersize());
+		ref_r.type()->data_to_dense_copy(m_buffer.data(), data);
+		data = m_buffer.data();
+	}
+
 	// write variable
 	m_ctx.logger().trace("Putting variable `{}' (var_id = {})", variable_name, var_id);
 
 	if (var_stride.empty()) {
-		nc_try(nc_put_var(dest_id, var_id, ref_r.get()), "Decl_netcdf plugin: Cannot write `{}' to (nc_id = {})", dest_id);
+		nc_try(nc_put_var(dest_id, var_id, data), "Cannot write `{}' to (nc_id = {})", variable.path(), dest_id);
 	} else {
 		nc_try(
-			nc_put_vara(dest_id, var_id, var_start.data(), var_count.data(), ref_r.get()),
-			"Decl_netcdf plugin: Cannot write `{}' to (nc_id = {})",
+			nc_put_vara(dest_id, var_id, var_start.data(), var_count.data(), data),
+			"Cannot write `{}' to (nc_id = {})",
+			variable.path(),
 			dest_id
 		);
 	}
 	m_ctx.logger().trace("Variable `{}' written", variable_name);
+	return record_end;
 }
 
 void Dnc_netcdf_file::get_variable(const Dnc_variable& variable, const Dnc_io& read, PDI::Ref_w ref_w)
@@ -631,6 +980,15 @@ void Dnc_netcdf_file::get_variable(const Dnc_variable& variable, const Dnc_io& r
 	std::vector<size_t> var_start = read.get_dims_start(var_stride);
 	std::vector<size_t> var_count = read.get_dims_count(var_stride);
 
+	// read one record in unlimited dimensions by default
+	if (!read.has_subsize()) {
+		for (size_t dim = 0; dim < var_stride.size(); ++dim) {
+			if (var_stride[dim] == NC_UNLIMITED) {
+				var_count[dim] = 1;
+			}
+		}
+	}
+
 	// get group path and variable name
 	auto [group_path, variable_name] = split_group_and_variable(variable.path());
 
@@ -648,12 +1006,28 @@ void Dnc_netcdf_file::get_variable(const Dnc_variable& variable, const Dnc_io& r
 	}
 	nc_id var_id = var_it->second;
 
+	// read contiguous data in place, read sparse data to a buffer to scatter it
+	void* data = ref_w.get();
+	size_t offset;
+	bool sparse = !contiguous_selection(ref_w.type(), offset);
+	if (sparse) {
+		m_buffer.resize(ref_w.type()->densify()->buffersize());
+		data = m_buffer.data();
+	} else {
+		data = static_cast<uint8_t*>(data) + offset;
+	}
+
 	// read variable
 	m_ctx.logger().trace("Getting variable `{}'", variable.path());
 	if (var_stride.empty()) {
-		nc_try(nc_get_var(src_id, var_id, ref_w.get()), "Cannot read `{}' from file", variable.path());
+		nc_try(nc_get_var(src_id, var_id, data), "Cannot read `{}' from file", variable.path());
 	} else {
-		nc_try(nc_get_vara(src_id, var_id, var_start.data(), var_count.data(), ref_w.get()), "Cannot read `{}' from file", variable.path());
+		nc_try(nc_get_vara(src_id, var_id, var_start.data(), var_count.data(), data), "Cannot read `{}' from file", variable.path());
+	}
+
+	if (sparse) {
+		m_ctx.logger().trace("Unpacking sparse data of `{}' variable", variable.path());
+		ref_w.type()->data_from_dense_copy(ref_w.get(), m_buffer.data());
 	}
 }
 
@@ -26,7 +26,13 @@
 #ifndef DECL_NETCDF_DNC_NETCDF_FILE_H_
 #define DECL_NETCDF_DNC_NETCDF_FILE_H_
 
+#include <cstdint>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <netcdf.h>
 
 #include <pdi/context.h>
 #include <pdi/expression.h>
@@ -54,12 +60,54 @@ class Dnc_netcdf_file
 	/// MPI communicator for this file
 	PDI::Expression m_communicator;
 
+	/// Whether the file is currently in define mode
+	bool m_define_mode = false;
+
 	/// Groups in NetCDF file
 	std::unordered_map<std::string, nc_id> m_groups;
 
 	/// Variables in NetCDF file
 	std::unordered_map<std::string, nc_id> m_variables;
 
+	/// Paths of the variables created by this opened file, they have no record yet
+	std::unordered_set<std::string> m_created_variables;
+
+	/// Length of the unlimited dimensions (group nc_id, dimension nc_id) before this opened file wrote to them
+	std::map<std::pair<nc_id, nc_id>, size_t> m_initial_records;
+
+	/// Buffer to pack (or unpack) the data of sparse in-memory types, reused across operations
+	std::vector<uint8_t> m_buffer;
+
+	/// Compound types defined or inquired in NetCDF file
+	std::unordered_map<std::string, nc_type> m_types;
+
+	/// Dimensions (group nc_id, dimension name) defined or inquired in NetCDF file
+	std::map<std::pair<nc_id, std::string>, nc_id> m_dimensions;
+
+	/// Last value (type and bytes) of the variables attributes (variable path, attribute name) in the file
+	std::map<std::pair<std::string, std::string>, std::pair<PDI::Datatype_sptr, std::vector<uint8_t>>> m_attribute_values;
+
+	/// Dimensions nc_id of the variables with unlimited dimensions
+	std::unordered_map<std::string, std::vector<nc_id>> m_variables_dimensions;
+
+	/** Returns the nc_id of a dimension, defines it if it doesn't exist
+	 *
+	 * \param dest_id group nc_id of the dimension
+	 * \param dim_name name of the dimension
+	 * \param dim_len length of the dimension if it has to be defined (0 for unlimited)
+	 * \return nc_id of the dimension
+	 */
+	nc_id dimension_id(nc_id dest_id, const std::string& dim_name, size_t dim_len);
+
+	/** Returns the dimensions nc_id of a variable
+	 *
+	 * \param variable_path path of the variable
+	 * \param group_id group nc_id of the variable
+	 * \param var_id nc_id of the variable
+	 * \return the dimensions nc_id of the variable
+	 */
+	const std::vector<nc_id>& variable_dimensions(const std::string& variable_path, nc_id group_id, nc_id var_id);
+
 	/** Defines compound type in the netcdf file
 	 *
 	 * If type is already defined, the nc_type of it is returned
@@ -70,6 +118,24 @@ class Dnc_netcdf_file
 	 */
 	nc_type define_compound_type(std::shared_ptr<const PDI::Record_datatype> record_type);
 
+	/** Returns the length of an unlimited dimension before this opened file wrote to it
+	 *
+	 * \param group_id group nc_id of the dimension
+	 * \param dim_id nc_id of the dimension
+	 * \return the length of the dimension when first accessed
+	 */
+	size_t initial_records(nc_id group_id, nc_id dim_id);
+
+	/** Sets the chunking, compression and quantization of a newly defined variable
+	 *
+	 * \param dest_id group nc_id of the variable
+	 * \param var_id nc_id of the variable
+	 * \param variable variable configuration
+	 * \param sizes size of the variable in each dimension (0 for unlimited)
+	 * \param element_size size in bytes of one element of the variable
+	 */
+	void define_storage(nc_id dest_id, nc_id var_id, const Dnc_variable& variable, const std::vector<size_t>& sizes, size_t element_size);
+
 	/** Puts attribute to the file
 	 *
 	 * \param dest_id file nc_id or group nc_id in which the attribute will be put
@@ -78,6 +144,26 @@ class Dnc_netcdf_file
 	 */
 	void put_attribute(nc_id dest_id, nc_id var_id, const Dnc_attribute& attribute);
 
+	/** Checks whether a variable attribute already has the value to put, compared to the last value put since the
+	 * file was opened, or to the file on the first access
+	 *
+	 * \param variable_path path of the variable of the attribute
+	 * \param dest_id file nc_id or group nc_id of the variable
+	 * \param var_id variable nc_id of the attribute
+	 * \param attribute attribute to compare
+	 * \param ref_r the value to put
+	 * \return true if the attribute already has the same type and value
+	 */
+	bool same_attribute(const std::string& variable_path, nc_id dest_id, nc_id var_id, const Dnc_attribute& attribute, PDI::Ref_r ref_r);
+
+	/** Remembers the value of a variable attribute in the file
+	 *
+	 * \param variable_path path of the variable of the attribute
+	 * \param attribute the attribute
+	 * \param ref_r the value of the attribute in the file
+	 */
+	void cache_attribute(const std::string& variable_path, const Dnc_attribute& attribute, PDI::Ref_r ref_r);
+
 	/** Gets attribute from the file
 	 *
 	 * \param src_id file nc_id or group nc_id from which the attribute will be gotten
@@ -126,16 +212,61 @@ public:
 	 */
 	void define_variable(const Dnc_variable& variable);
 
-	/// Ends definion mode in NetCDF file
-	void enddef() const;
+	/** Puts again the attributes of a defined variable whose value changed in the file
+	 *
+	 * Only enters define mode if at least one attribute has to be put.
+	 *
+	 * \param variable variable to update, must be defined
+	 */
+	void update_variable_attributes(const Dnc_variable& variable);
+
+	/** Checks whether a variable has already been defined or read in this opened file
+	 *
+	 * \param variable_path path of the variable
+	 * \return true if the variable nc_id is known
+	 */
+	bool has_variable(const std::string& variable_path) const;
+
+	/** Enters definion mode in NetCDF file (does nothing if already in define mode)
+	 *
+	 * Called before each definition, so that a file only enters define mode when something new has to be defined.
+	 */
+	void redef();
+
+	/// Ends definion mode in NetCDF file (does nothing if already in data mode)
+	void enddef();
+
+	/// Flushes the file buffers to disk, ending definition mode if needed
+	void sync();
+
+	/** Returns the path of this opened file
+	 *
+	 * \return the path of this opened file
+	 */
+	const std::string& filename() const;
+
+	/** Returns the number of records of a variable, i.e. the length of its unlimited dimension
+	 *
+	 * The length of the unlimited dimension is shared by all variables using it, so the count of a variable that already
+	 * exists in the file is the length of the dimension when this opened file first accessed it.
+	 *
+	 * \param variable variable to inquire, must be defined or read
+	 * \return the length of the unlimited dimension of the variable, 0 if it has none or has just been created
+	 */
+	size_t record_count(const Dnc_variable& variable);
 
 	/** Puts variable to the file
+	 *
+	 * In unlimited dimensions, the data is written to the `next_record` record unless the write operation defines a
+	 * start, and one record is written unless the write operation defines a subsize.
 	 *
 	 * \param variable variable to put
 	 * \param write Dnc_io that deteremines the write operation
 	 * \param ref_r reference where from get data to put
+	 * \param next_record index of the record to write in unlimited dimensions
+	 * \return the index of the record following the written ones (`next_record' if the variable has no unlimited dimension)
 	 */
-	void put_variable(const Dnc_variable& variable, const Dnc_io& write, PDI::Ref_r ref_r);
+	size_t put_variable(const Dnc_variable& variable, const Dnc_io& write, PDI::Ref_r ref_r, size_t next_record);
 
 	/** Gets variable from the file
 	 *
@@ -52,6 +52,41 @@ Dnc_variable::Dnc_variable(PDI::Context& ctx, const std::string& path, PC_tree_t
 	if (!PC_status(type_node)) {
 		m_type = m_ctx.datatype(config);
 	}
+
+	PC_tree_t chunking_node = PC_get(config, ".chunking");
+	if (!PC_status(chunking_node)) {
+		if (PDI::is_list(chunking_node)) {
+			int len = PDI::len(chunking_node);
+			for (int i = 0; i < len; i++) {
+				m_chunking.emplace_back(PDI::to_string(PC_get(chunking_node, "[%d]", i)));
+			}
+		} else if (PDI::to_string(chunking_node) == "auto") {
+			m_chunking_auto = true;
+		} else {
+			throw PDI::Error{PDI_ERR_CONFIG, "Decl_netcdf plugin: Variable {}: `chunking' must be a list of sizes or `auto'", m_path};
+		}
+	}
+
+	PC_tree_t deflate_node = PC_get(config, ".deflate");
+	if (!PC_status(deflate_node)) {
+		m_deflate = PDI::Expression{PDI::to_string(deflate_node)};
+	}
+
+	PC_tree_t shuffle_node = PC_get(config, ".shuffle");
+	if (!PC_status(shuffle_node)) {
+		m_shuffle = PDI::Expression{PDI::to_string(shuffle_node)};
+	}
+
+	PC_tree_t quantize_node = PC_get(config, ".quantize");
+	if (!PC_status(quantize_node)) {
+		PC_tree_t mode_node = PC_get(quantize_node, ".mode");
+		PC_tree_t nsd_node = PC_get(quantize_node, ".nsd");
+		if (PC_status(mode_node) || PC_status(nsd_node)) {
+			throw PDI::Error{PDI_ERR_CONFIG, "Decl_netcdf plugin: Variable {}: `quantize' requires `mode' and `nsd'", m_path};
+		}
+		m_quantize_mode = PDI::Expression{PDI::to_string(mode_node)};
+		m_quantize_nsd = PDI::Expression{PDI::to_string(nsd_node)};
+	}
 }
 
 const std::string& Dnc_variable::path() const
@@ -87,5 +122,55 @@ const std::vector<Dnc_attribute>& Dnc_variable::attributes() const
 	return m_attributes;
 }
 
+std::vector<size_t> Dnc_variable::chunking() const
+{
+	std::vector<size_t> result;
+	for (auto&& size: m_chunking) {
+		result.emplace_back(size.to_long(m_ctx));
+	}
+	return result;
+}
+
+bool Dnc_variable::chunking_auto() const
+{
+	return m_chunking_auto;
+}
+
+long Dnc_variable::deflate() const
+{
+	if (m_deflate) {
+		return m_deflate.to_long(m_ctx);
+	} else {
+		return -1;
+	}
+}
+
+bool Dnc_variable::shuffle() const
+{
+	if (m_shuffle) {
+		return m_shuffle.to_long(m_ctx);
+	} else {
+		return false;
+	}
+}
+
+std::string Dnc_variable::quantize_mode() const
+{
+	if (m_quantize_mode) {
+		return m_quantize_mode.to_string(m_ctx);
+	} else {
+		return {};
+	}
+}
+
+long Dnc_variable::quantize_nsd() const
+{
+	if (m_quantize_nsd) {
+		return m_quantize_nsd.to_long(m_ctx);
+	} else {
+		return 0;
+	}
+}
+
 
 } // namespace decl_netcdf
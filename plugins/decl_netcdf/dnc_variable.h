@@ -26,6 +26,7 @@
 #ifndef DECL_NETCDF_DNC_VARIABLE_H_
 #define DECL_NETCDF_DNC_VARIABLE_H_
 
+#include <string>
 #include <vector>
 
 #include <pdi/pdi_fwd.h>
@@ -56,6 +57,24 @@ class Dnc_variable
 	/// Attributes of the variable
 	std::vector<Dnc_attribute> m_attributes;
 
+	/// Size of the chunks in each dimension, empty for the default NetCDF layout
+	std::vector<PDI::Expression> m_chunking;
+
+	/// Whether the size of the chunks is automatically computed
+	bool m_chunking_auto = false;
+
+	/// Deflate compression level, unset for no compression
+	PDI::Expression m_deflate;
+
+	/// Whether the shuffle filter is used
+	PDI::Expression m_shuffle;
+
+	/// Quantization algorithm, unset for no quantization
+	PDI::Expression m_quantize_mode;
+
+	/// Number of significant digits (or bits for bitround) kept by quantization
+	PDI::Expression m_quantize_nsd;
+
 public:
 	/** Creates NetCDF variable information from yaml
 	 *
@@ -93,6 +112,42 @@ public:
 	 * \return attributes of the variable
 	 */
 	const std::vector<Dnc_attribute>& attributes() const;
+
+	/** Getter for variable chunking
+	 *
+	 * \return size of the chunks in each dimension, empty if not defined or automatic
+	 */
+	std::vector<size_t> chunking() const;
+
+	/** Getter for automatic chunking
+	 *
+	 * \return whether the size of the chunks should be automatically computed
+	 */
+	bool chunking_auto() const;
+
+	/** Getter for variable deflate level
+	 *
+	 * \return deflate compression level, -1 if not compressed
+	 */
+	long deflate() const;
+
+	/** Getter for variable shuffle filter
+	 *
+	 * \return whether the shuffle filter is used
+	 */
+	bool shuffle() const;
+
+	/** Getter for variable quantization algorithm
+	 *
+	 * \return name of the quantization algorithm (`bitgroom', `granularbr' or `bitround'), empty if not quantized
+	 */
+	std::string quantize_mode() const;
+
+	/** Getter for variable quantization precision
+	 *
+	 * \return number of significant digits (or bits for bitround) kept by quantization
+	 */
+	long quantize_nsd() const;
 };
 
 } // namespace decl_netcdf
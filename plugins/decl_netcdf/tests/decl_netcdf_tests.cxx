@@ -23,6 +23,8 @@
  * THE SOFTWARE.
  ******************************************************************************/
 
+#include <cstdio>
+
 #include <gtest/gtest.h>
 #include <pdi.h>
 
@@ -808,3 +810,419 @@ TEST(decl_netcdf_test, size_of)
 
 	PDI_finalize();
 }
+
+/*
+ * Name:                decl_netcdf_test.persistent
+ *
+ * Description:         Tests writing rows of a variable to a file kept open across data shares, synced and closed on events
+ */
+TEST(decl_netcdf_test, persistent)
+{
+	const char* CONFIG_YAML
+		= "logging: trace                                            \n"
+		  "metadata:                                                 \n"
+		  "  step: int                                               \n"
+		  "data:                                                     \n"
+		  "  last_step: int                                          \n"
+		  "  int_row: {type: array, subtype: int, size: 8}           \n"
+		  "  int_matrix: {type: array, subtype: int, size: [4, 8]}   \n"
+		  "plugins:                                                  \n"
+		  "  decl_netcdf:                                            \n"
+		  "    - file: 'test_persistent.nc'                          \n"
+		  "      persistent: true                                    \n"
+		  "      sync_on: sync                                       \n"
+		  "      close_on: [close, other_close]                      \n"
+		  "      variables:                                          \n"
+		  "        int_matrix:                                       \n"
+		  "          type: array                                     \n"
+		  "          subtype: int                                    \n"
+		  "          size: [4, 8]                                    \n"
+		  "          dimensions: ['step', 'x']                       \n"
+		  "          attributes:                                     \n"
+		  "            last_step: $step                              \n"
+		  "      write:                                              \n"
+		  "        int_row:                                          \n"
+		  "          variable: int_matrix                            \n"
+		  "          variable_selection:                             \n"
+		  "            start: ['$step', 0]                           \n"
+		  "            subsize: [1, 8]                               \n"
+		  "    - file: 'test_persistent.nc'                          \n"
+		  "      on_event: 'read'                                    \n"
+		  "      variables:                                          \n"
+		  "        int_matrix:                                       \n"
+		  "          type: array                                     \n"
+		  "          subtype: int                                    \n"
+		  "          size: [4, 8]                                    \n"
+		  "          attributes:                                     \n"
+		  "            last_step: $last_step                         \n"
+		  "      read: [int_matrix]                                  \n";
+
+	remove("test_persistent.nc");
+	PDI_init(PC_parse_string(CONFIG_YAML));
+
+	// write the first rows in the same opened file
+	int int_row[8];
+	for (int step = 0; step < 3; step++) {
+		for (int i = 0; i < 8; i++) {
+			int_row[i] = step * 8 + i;
+		}
+		PDI_expose("step", &step, PDI_OUT);
+		PDI_expose("int_row", int_row, PDI_OUT);
+		PDI_event("sync");
+	}
+	PDI_event("close");
+
+	// the attribute was updated by each write to the opened file
+	int last_step = -1;
+	int int_matrix[4][8] = {};
+	PDI_share("last_step", &last_step, PDI_INOUT);
+	PDI_multi_expose("read", "int_matrix", int_matrix, PDI_IN, NULL);
+	PDI_reclaim("last_step");
+	ASSERT_EQ(last_step, 2);
+
+	// the last row reopens the file
+	int step = 3;
+	for (int i = 0; i < 8; i++) {
+		int_row[i] = step * 8 + i;
+	}
+	PDI_expose("step", &step, PDI_OUT);
+	PDI_expose("int_row", int_row, PDI_OUT);
+	PDI_event("other_close");
+
+	// read the whole matrix
+	PDI_share("last_step", &last_step, PDI_INOUT);
+	PDI_multi_expose("read", "int_matrix", int_matrix, PDI_IN, NULL);
+	PDI_reclaim("last_step");
+	ASSERT_EQ(last_step, 3);
+
+	// verify
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 8; j++) {
+			ASSERT_EQ(int_matrix[i][j], i * 8 + j);
+		}
+	}
+
+	PDI_finalize();
+}
+
+/*
+ * Name:                decl_netcdf_test.compression
+ *
+ * Description:         Tests write and read of chunked, compressed and quantized variables
+ */
+TEST(decl_netcdf_test, compression)
+{
+	const char* CONFIG_YAML
+		= "logging: trace                                                \n"
+		  "metadata:                                                     \n"
+		  "  level: int                                                  \n"
+		  "data:                                                         \n"
+		  "  int_matrix: {type: array, subtype: int, size: [64, 64]}     \n"
+		  "  float_matrix: {type: array, subtype: float, size: [64, 64]} \n"
+		  "plugins:                                                      \n"
+		  "  decl_netcdf:                                                \n"
+		  "    - file: 'test_compression.nc'                             \n"
+		  "      on_event: 'write'                                       \n"
+		  "      variables:                                              \n"
+		  "        int_matrix:                                           \n"
+		  "          chunking: [16, '$level * 8']                        \n"
+		  "          deflate: $level                                     \n"
+		  "          shuffle: true                                       \n"
+		  "        float_matrix:                                         \n"
+		  "          chunking: auto                                      \n"
+		  "          deflate: 1                                          \n"
+		  "          quantize:                                           \n"
+		  "            mode: bitround                                    \n"
+		  "            nsd: 8                                            \n"
+		  "      write: [int_matrix, float_matrix]                       \n"
+		  "    - file: 'test_compression.nc'                             \n"
+		  "      on_event: 'read'                                        \n"
+		  "      read: [int_matrix, float_matrix]                        \n";
+
+	remove("test_compression.nc");
+	PDI_init(PC_parse_string(CONFIG_YAML));
+
+	// init data
+	int level = 4;
+	int int_matrix[64][64];
+	float float_matrix[64][64];
+	for (int i = 0; i < 64; i++) {
+		for (int j = 0; j < 64; j++) {
+			int_matrix[i][j] = i * 64 + j;
+			float_matrix[i][j] = 1.f + i * 0.01f + j * 0.0001f;
+		}
+	}
+
+	// write data
+	PDI_expose("level", &level, PDI_OUT);
+	PDI_multi_expose("write", "int_matrix", int_matrix, PDI_OUT, "float_matrix", float_matrix, PDI_OUT, NULL);
+
+	// read data
+	int int_matrix_read[64][64] = {};
+	float float_matrix_read[64][64] = {};
+	PDI_multi_expose("read", "int_matrix", int_matrix_read, PDI_IN, "float_matrix", float_matrix_read, PDI_IN, NULL);
+
+	// verify: lossless for integers, 8 significant bits kept for floats
+	for (int i = 0; i < 64; i++) {
+		for (int j = 0; j < 64; j++) {
+			ASSERT_EQ(int_matrix_read[i][j], int_matrix[i][j]);
+			ASSERT_NEAR(float_matrix_read[i][j], float_matrix[i][j], float_matrix[i][j] / 256);
+		}
+	}
+
+	PDI_finalize();
+}
+
+/*
+ * Name:                decl_netcdf_test.append
+ *
+ * Description:         Tests appending records to variables sharing an unlimited dimension, across file reopening
+ */
+TEST(decl_netcdf_test, append)
+{
+	const char* CONFIG_YAML
+		= "logging: trace                                               \n"
+		  "metadata:                                                    \n"
+		  "  input: int                                                 \n"
+		  "data:                                                        \n"
+		  "  time: double                                               \n"
+		  "  int_row: {type: array, subtype: int, size: 4}              \n"
+		  "  times: {type: array, subtype: double, size: 5}             \n"
+		  "  int_matrix: {type: array, subtype: int, size: [5, 4]}      \n"
+		  "plugins:                                                     \n"
+		  "  decl_netcdf:                                               \n"
+		  "    - file: 'test_append.nc'                                 \n"
+		  "      when: '${input}=0'                                     \n"
+		  "      persistent: true                                       \n"
+		  "      variables:                                             \n"
+		  "        times:                                               \n"
+		  "          type: array                                        \n"
+		  "          subtype: double                                    \n"
+		  "          size: [0]                                          \n"
+		  "          dimensions: ['time']                               \n"
+		  "        int_matrix:                                          \n"
+		  "          type: array                                        \n"
+		  "          subtype: int                                       \n"
+		  "          size: [0, 4]                                       \n"
+		  "          dimensions: ['time', 'x']                          \n"
+		  "      write:                                                 \n"
+		  "        time: {variable: times}                              \n"
+		  "        int_row: {variable: int_matrix}                      \n"
+		  "    - file: 'test_append.nc'                                 \n"
+		  "      when: '${input}=1'                                     \n"
+		  "      variables:                                             \n"
+		  "        times: {type: array, subtype: double, size: [0]}     \n"
+		  "        int_matrix: {type: array, subtype: int, size: [0, 4]}\n"
+		  "      read:                                                  \n"
+		  "        times:                                               \n"
+		  "          variable_selection: {subsize: [5]}                 \n"
+		  "        int_matrix:                                          \n"
+		  "          variable_selection: {subsize: [5, 4]}              \n";
+
+	remove("test_append.nc");
+	int input = 0;
+	int int_row[4];
+	for (int session = 0; session < 2; session++) {
+		// the second session reopens the file and appends after the existing records
+		PDI_init(PC_parse_string(CONFIG_YAML));
+		PDI_expose("input", &input, PDI_OUT);
+		for (int step = 3 * session; step < 3 + 2 * session; step++) {
+			double time = step * 0.5;
+			for (int i = 0; i < 4; i++) {
+				int_row[i] = step * 4 + i;
+			}
+			PDI_expose("time", &time, PDI_OUT);
+			PDI_expose("int_row", int_row, PDI_OUT);
+		}
+		PDI_finalize();
+	}
+
+	// read all records
+	PDI_init(PC_parse_string(CONFIG_YAML));
+	input = 1;
+	PDI_expose("input", &input, PDI_OUT);
+	double times[5] = {};
+	int int_matrix[5][4] = {};
+	PDI_expose("times", times, PDI_IN);
+	PDI_expose("int_matrix", int_matrix, PDI_IN);
+
+	// verify
+	for (int step = 0; step < 5; step++) {
+		ASSERT_EQ(times[step], step * 0.5);
+		for (int i = 0; i < 4; i++) {
+			ASSERT_EQ(int_matrix[step][i], step * 4 + i);
+		}
+	}
+
+	PDI_finalize();
+}
+
+/*
+ * Name:                decl_netcdf_test.sparse
+ *
+ * Description:         Tests write and read of the interior of ghosted arrays, contiguous or not in memory
+ */
+TEST(decl_netcdf_test, sparse)
+{
+	const char* CONFIG_YAML
+		= "logging: trace                                                                     \n"
+		  "data:                                                                              \n"
+		  "  interior: {type: array, subtype: int, size: [6, 6], subsize: [4, 4], start: [1, 1]} \n"
+		  "  rows: {type: array, subtype: int, size: [6, 4], subsize: [4, 4], start: [1, 0]}     \n"
+		  "plugins:                                                                           \n"
+		  "  decl_netcdf:                                                                     \n"
+		  "    - file: 'test_sparse.nc'                                                       \n"
+		  "      on_event: 'write'                                                            \n"
+		  "      write: [interior, rows]                                                      \n"
+		  "    - file: 'test_sparse.nc'                                                       \n"
+		  "      on_event: 'read'                                                             \n"
+		  "      read:                                                                        \n"
+		  "        interior: {variable: rows}                                                 \n"
+		  "        rows: {variable: interior}                                                 \n";
+
+	remove("test_sparse.nc");
+	PDI_init(PC_parse_string(CONFIG_YAML));
+
+	// init data
+	int interior[6][6];
+	int rows[6][4];
+	for (int i = 0; i < 6; i++) {
+		for (int j = 0; j < 6; j++) {
+			interior[i][j] = (i == 0 || i == 5 || j == 0 || j == 5) ? -1 : (i - 1) * 4 + j - 1;
+		}
+		for (int j = 0; j < 4; j++) {
+			rows[i][j] = (i == 0 || i == 5) ? -1 : 100 + (i - 1) * 4 + j;
+		}
+	}
+
+	// write data
+	PDI_multi_expose("write", "interior", interior, PDI_OUT, "rows", rows, PDI_OUT, NULL);
+
+	// read data swapped
+	int interior_read[6][6];
+	int rows_read[6][4];
+	for (int i = 0; i < 6; i++) {
+		for (int j = 0; j < 6; j++) {
+			interior_read[i][j] = -2;
+		}
+		for (int j = 0; j < 4; j++) {
+			rows_read[i][j] = -2;
+		}
+	}
+	PDI_multi_expose("read", "interior", interior_read, PDI_IN, "rows", rows_read, PDI_IN, NULL);
+
+	// verify: ghosts untouched
+	for (int i = 0; i < 6; i++) {
+		for (int j = 0; j < 6; j++) {
+			if (i == 0 || i == 5 || j == 0 || j == 5) {
+				ASSERT_EQ(interior_read[i][j], -2);
+			} else {
+				ASSERT_EQ(interior_read[i][j], rows[i][j - 1]);
+			}
+		}
+		for (int j = 0; j < 4; j++) {
+			if (i == 0 || i == 5) {
+				ASSERT_EQ(rows_read[i][j], -2);
+			} else {
+				ASSERT_EQ(rows_read[i][j], interior[i][j + 1]);
+			}
+		}
+	}
+
+	PDI_finalize();
+}
+
+/*
+ * Name:                decl_netcdf_test.define_once
+ *
+ * Description:         Tests writing variables of a group to a persistent file, with a variable defined after the first steps
+ */
+TEST(decl_netcdf_test, define_once)
+{
+	const char* CONFIG_YAML
+		= "logging: trace                                               \n"
+		  "metadata:                                                    \n"
+		  "  step: int                                                  \n"
+		  "data:                                                        \n"
+		  "  int_row: {type: array, subtype: int, size: 4}              \n"
+		  "  double_row: {type: array, subtype: double, size: 4}        \n"
+		  "  int_matrix: {type: array, subtype: int, size: [3, 4]}      \n"
+		  "  double_matrix: {type: array, subtype: double, size: [3, 4]}\n"
+		  "plugins:                                                     \n"
+		  "  decl_netcdf:                                               \n"
+		  "    - file: 'test_define_once.nc'                            \n"
+		  "      persistent: true                                       \n"
+		  "      close_on: close                                        \n"
+		  "      groups:                                                \n"
+		  "        grp/sub:                                             \n"
+		  "          attributes:                                        \n"
+		  "            step_count: 3                                    \n"
+		  "      variables:                                             \n"
+		  "        grp/sub/int_matrix:                                  \n"
+		  "          type: array                                        \n"
+		  "          subtype: int                                       \n"
+		  "          size: [0, 4]                                       \n"
+		  "          dimensions: ['time', 'x']                          \n"
+		  "        grp/sub/double_matrix:                               \n"
+		  "          type: array                                        \n"
+		  "          subtype: double                                    \n"
+		  "          size: [0, 4]                                       \n"
+		  "          dimensions: ['time', 'x']                          \n"
+		  "      write:                                                 \n"
+		  "        int_row: {variable: grp/sub/int_matrix}              \n"
+		  "        double_row: {variable: grp/sub/double_matrix}        \n"
+		  "    - file: 'test_define_once.nc'                            \n"
+		  "      on_event: 'read'                                       \n"
+		  "      variables:                                             \n"
+		  "        grp/sub/int_matrix:                                  \n"
+		  "          type: array                                        \n"
+		  "          subtype: int                                       \n"
+		  "          size: [0, 4]                                       \n"
+		  "        grp/sub/double_matrix:                               \n"
+		  "          type: array                                        \n"
+		  "          subtype: double                                    \n"
+		  "          size: [0, 4]                                       \n"
+		  "      read:                                                  \n"
+		  "        int_matrix:                                          \n"
+		  "          variable: grp/sub/int_matrix                       \n"
+		  "          variable_selection: {subsize: [3, 4]}              \n"
+		  "        double_matrix:                                       \n"
+		  "          variable: grp/sub/double_matrix                    \n"
+		  "          variable_selection: {subsize: [3, 4]}              \n";
+
+	remove("test_define_once.nc");
+	PDI_init(PC_parse_string(CONFIG_YAML));
+
+	int int_row[4];
+	double double_row[4];
+	for (int step = 0; step < 3; step++) {
+		for (int i = 0; i < 4; i++) {
+			int_row[i] = step * 4 + i;
+			double_row[i] = step * 4 + i + 0.5;
+		}
+		PDI_expose("int_row", int_row, PDI_OUT);
+		// the double variable is defined once the file already holds records
+		if (step > 0) {
+			PDI_expose("double_row", double_row, PDI_OUT);
+		}
+	}
+	PDI_event("close");
+
+	int int_matrix[3][4] = {};
+	double double_matrix[3][4] = {};
+	PDI_multi_expose("read", "int_matrix", int_matrix, PDI_IN, "double_matrix", double_matrix, PDI_IN, NULL);
+
+	// verify
+	for (int step = 0; step < 3; step++) {
+		for (int i = 0; i < 4; i++) {
+			ASSERT_EQ(int_matrix[step][i], step * 4 + i);
+		}
+	}
+	for (int step = 0; step < 2; step++) {
+		for (int i = 0; i < 4; i++) {
+			ASSERT_EQ(double_matrix[step][i], (step + 1) * 4 + i + 0.5);
+		}
+	}
+
+	PDI_finalize();
+}
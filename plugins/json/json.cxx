@@ -22,10 +22,16 @@
  * THE SOFTWARE.
  ******************************************************************************/
 
+#include <cstdio>
+#include <exception>
 #include <filesystem>
 #include <fstream>
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
+
+#include <unistd.h>
 
 #include <pdi/array_datatype.h>
 #include <pdi/context.h>
@@ -44,12 +50,203 @@ namespace {
 
 using namespace PDI;
 
+/// How the data is written to a file
+struct Write_options {
+	/// whether the file is kept open between writes instead of re-opened on each write
+	bool streaming = false;
+
+	/// whether the JSON is indented (pretty) or compact
+	bool pretty = true;
+
+	/// in streaming mode, number of writes after which the array is terminated and the file synced to disk (0 for never)
+	long sync_every = 0;
+};
+
+/// An output file of a variable
+struct Output {
+	/// the condition to write the variable
+	Expression when;
+
+	/// the path of the file
+	Expression file;
+
+	/// how the variable is written
+	Write_options options;
+};
+
+/** A JSON array written incrementally to a file kept open
+ *
+ * The elements are written through a userspace buffer and the closing `]` of
+ * the array is only written when the stream is closed.
+ * With `sync_every`, the elements are instead kept in memory and written with
+ * the closing `]` every `sync_every` writes, the file being then synced to
+ * disk, so that the file on disk is always a valid JSON array.
+ */
+class Json_stream
+{
+	/// the path of the file
+	std::string m_path;
+
+	/// the file, kept open
+	std::FILE* m_file = nullptr;
+
+	/// userspace buffer of the file
+	std::vector<char> m_buffer;
+
+	/// whether an element was already written to the array
+	bool m_not_empty = false;
+
+	/// with `sync_every`, the elements written since the last sync
+	std::string m_pending;
+
+	/// with `sync_every`, the offset of the closing `]` of the array in the file
+	long m_end = 0;
+
+	/// number of writes since the last sync
+	long m_unsynced_writes = 0;
+
+	/// number of writes after which the array is terminated and the file synced
+	long m_sync_every;
+
+public:
+	/** Opens a file, continuing the array it contains if it exists
+	 *
+	 * \param path the path of the file
+	 * \param sync_every number of writes after which the array is terminated and the file synced (0 for never)
+	 */
+	Json_stream(const std::string& path, long sync_every)
+		: m_path{path}
+		, m_buffer(1 << 20)
+		, m_sync_every{sync_every}
+	{
+		m_file = std::fopen(path.c_str(), "r+");
+		if (m_file) {
+			// the buffer must be set before any other operation on the file
+			if (std::setvbuf(m_file, m_buffer.data(), _IOFBF, m_buffer.size())) {
+				std::fclose(m_file);
+				throw System_error{"JSON plugin: Cannot set the buffer of `{}'", path};
+			}
+			// continue the existing array, overwriting its closing `]`
+			char end[2] = {0, 0};
+			if (std::fseek(m_file, -2, SEEK_END) || std::fread(end, 1, 2, m_file) != 2 || end[1] != ']') {
+				std::fclose(m_file);
+				throw Value_error{"JSON plugin: `{}' does not end with a valid JSON array, cannot append", path};
+			}
+			if (std::fseek(m_file, end[0] == '\n' ? -2 : -1, SEEK_END) || (m_end = std::ftell(m_file)) < 0) {
+				std::fclose(m_file);
+				throw System_error{"JSON plugin: Cannot seek in `{}'", path};
+			}
+			m_not_empty = true;
+		} else {
+			m_file = std::fopen(path.c_str(), "w");
+			if (!m_file) {
+				throw System_error{"JSON plugin: Cannot open `{}' for writing", path};
+			}
+			if (std::setvbuf(m_file, m_buffer.data(), _IOFBF, m_buffer.size())) {
+				std::fclose(m_file);
+				throw System_error{"JSON plugin: Cannot set the buffer of `{}'", path};
+			}
+			if (m_sync_every > 0) {
+				// a valid empty array until the first sync
+				try {
+					terminate();
+				} catch (...) {
+					std::fclose(m_file);
+					throw;
+				}
+			}
+		}
+	}
+
+	Json_stream(const Json_stream&) = delete;
+
+	Json_stream& operator= (const Json_stream&) = delete;
+
+	/// Terminates the array and closes the file if not done yet, ignoring errors
+	~Json_stream()
+	{
+		if (m_file) {
+			try {
+				terminate();
+			} catch (const std::exception&) {
+			}
+			std::fclose(m_file);
+		}
+	}
+
+	/** Writes an element to the array
+	 *
+	 * \param element the serialized JSON element
+	 */
+	void write(const std::string& element)
+	{
+		const char* separator = m_not_empty ? ",\n" : "[\n";
+		m_not_empty = true;
+		if (m_sync_every > 0) {
+			// only written to the file with its closing `]` on sync
+			m_pending += separator;
+			m_pending += element;
+			if (++m_unsynced_writes >= m_sync_every) {
+				terminate();
+			}
+		} else if (std::fputs(separator, m_file) == EOF || std::fputs(element.c_str(), m_file) == EOF) {
+			throw System_error{"JSON plugin: Cannot write to `{}'", m_path};
+		}
+	}
+
+	/// Terminates the array and closes the file
+	void close()
+	{
+		try {
+			terminate();
+		} catch (...) {
+			std::fclose(m_file);
+			m_file = nullptr;
+			throw;
+		}
+		bool closed = !std::fclose(m_file);
+		m_file = nullptr;
+		if (!closed) {
+			throw System_error{"JSON plugin: Cannot write to `{}'", m_path};
+		}
+	}
+
+private:
+	/** Writes the closing `]` of the array (an empty array if nothing was written)
+	 *
+	 * With `sync_every`, the pending elements are written first, over the
+	 * previous closing `]`, and the file is synced to disk.
+	 */
+	void terminate()
+	{
+		if (m_sync_every > 0) {
+			if (std::fseek(m_file, m_end, SEEK_SET) || std::fputs(m_pending.c_str(), m_file) == EOF || (m_end = std::ftell(m_file)) < 0) {
+				throw System_error{"JSON plugin: Cannot write to `{}'", m_path};
+			}
+			m_pending.clear();
+			m_unsynced_writes = 0;
+		}
+		if (std::fputs(m_not_empty ? "\n]" : "[\n]", m_file) == EOF) {
+			throw System_error{"JSON plugin: Cannot write to `{}'", m_path};
+		}
+		if (m_sync_every > 0 && (std::fflush(m_file) || fsync(fileno(m_file)))) {
+			throw System_error{"JSON plugin: Cannot sync `{}' to disk", m_path};
+		}
+	}
+};
+
 /** The json plugin 
 */
 class json_plugin: public PDI::Plugin
 {
-	// Map between data variables and a pair between condition and the output filenames
-	std::unordered_map<std::string, std::vector<std::pair<Expression, Expression>>> m_data_to_path_map;
+	// Map between data variables and their conditions, output filenames and write options
+	std::unordered_map<std::string, std::vector<Output>> m_data_to_path_map;
+
+	/// Streams of the files kept open, by path
+	std::unordered_map<std::string, std::unique_ptr<Json_stream>> m_streams;
+
+	/// Files to close on each event, with their path
+	std::unordered_map<std::string, std::vector<Expression>> m_close_on;
 
 public:
 	json_plugin(Context& ctx, PC_tree_t spec_tree)
@@ -64,10 +261,25 @@ public:
 				data_path_pair.first
 			);
 		}
+		for (const auto& event_files: m_close_on) {
+			ctx.callbacks().add_event_callback([this](const std::string& event_name) { close_streams(event_name); }, event_files.first);
+		}
 		ctx.logger().info("Plugin loaded successfully");
 	}
 
-	~json_plugin() { context().logger().info("Closing plugin"); }
+	~json_plugin()
+	{
+		// terminate the arrays of the files kept open
+		for (auto&& stream: m_streams) {
+			try {
+				stream.second->close();
+			} catch (const std::exception& e) {
+				context().logger().error("While finalizing: {}", e.what());
+			}
+		}
+		m_streams.clear();
+		context().logger().info("Closing plugin");
+	}
 
 
 private:
@@ -89,15 +301,31 @@ private:
 				Expression filepath = to_string(PC_get(elem_tree, ".file"));
 
 				Expression default_when = 1L;
+				Write_options options;
 				each(elem_tree, [&](PC_tree_t key_tree, PC_tree_t value_tree) {
 					std::string key = to_string(key_tree);
 
 					if (key == "when") {
 						default_when = to_string(value_tree);
+					} else if (key == "streaming") {
+						options.streaming = to_bool(value_tree);
+					} else if (key == "pretty") {
+						options.pretty = to_bool(value_tree);
+					} else if (key == "sync_every") {
+						options.sync_every = to_long(value_tree);
+					} else if (key == "close_on") {
+						opt_each(value_tree, [&](PC_tree_t event_tree) { m_close_on[to_string(event_tree)].emplace_back(filepath); });
 					} else if (key != "file" && key != "write") {
-						throw Config_error{key_tree, "Unknown keyword '{}' encountered while expecting file, when, or write", key};
+						throw Config_error{
+							key_tree,
+							"Unknown keyword '{}' encountered while expecting file, when, write, streaming, pretty, sync_every or close_on",
+							key
+						};
 					}
 				});
+				if (!options.streaming && (options.sync_every || !PC_status(PC_get(elem_tree, ".close_on")))) {
+					throw Config_error{elem_tree, "sync_every and close_on are only valid with streaming: true"};
+				}
 
 				each(elem_tree, [&](PC_tree_t key_tree, PC_tree_t value_tree) {
 					std::string key = to_string(key_tree);
@@ -112,12 +340,9 @@ private:
 								// Append to list if key exist, else create it
 								auto iter = m_data_to_path_map.find(dset_string);
 								if (iter != m_data_to_path_map.end()) {
-									iter->second.push_back(std::make_pair(default_when, filepath));
+									iter->second.push_back(Output{default_when, filepath, options});
 								} else {
-									m_data_to_path_map.insert(std::make_pair(
-										dset_string,
-										std::vector<std::pair<Expression, Expression>>{std::make_pair(default_when, filepath)}
-									));
+									m_data_to_path_map.insert(std::make_pair(dset_string, std::vector<Output>{Output{default_when, filepath, options}}));
 								}
 							});
 						} else {
@@ -132,11 +357,9 @@ private:
 				auto iter = m_data_to_path_map.find(dset_string);
 				Expression default_when = 1L;
 				if (iter != m_data_to_path_map.end()) {
-					iter->second.push_back(std::make_pair(default_when, filepath));
+					iter->second.push_back(Output{default_when, filepath, Write_options{}});
 				} else {
-					m_data_to_path_map.insert(
-						std::make_pair(dset_string, std::vector<std::pair<Expression, Expression>>{std::make_pair(default_when, filepath)})
-					);
+					m_data_to_path_map.insert(std::make_pair(dset_string, std::vector<Output>{Output{default_when, filepath, Write_options{}}}));
 				}
 			}
 		});
@@ -321,6 +544,24 @@ private:
 		return std::move(json_data);
 	}
 
+	/** Terminates the arrays of the files to close on an event and closes them
+	 *
+	 * \param event_name the name of the event
+	 */
+	void close_streams(const std::string& event_name)
+	{
+		for (const auto& fpath: m_close_on[event_name]) {
+			const std::string filepath = fpath.to_string(context());
+			auto stream = m_streams.find(filepath);
+			if (stream != m_streams.end()) {
+				std::unique_ptr<Json_stream> closed = std::move(stream->second);
+				m_streams.erase(stream);
+				closed->close();
+				context().logger().debug("Closed {} on event {}", filepath, event_name);
+			}
+		}
+	}
+
 	/** Write the variable to a JSON file
 	 *
 	 * \param data_name the variable name shared from PDI
@@ -330,7 +571,7 @@ private:
 	{
 		Logger& logger = context().logger();
 
-		for (const auto& [condition, fpath]: m_data_to_path_map[data_name]) {
+		for (const auto& [condition, fpath, options]: m_data_to_path_map[data_name]) {
 			if (!condition.to_long(context())) {
 				logger.debug("Condition for {} isn't verified !", data_name);
 				continue;
@@ -344,7 +585,19 @@ private:
 			}
 
 			nlohmann::json json_data;
-			json_data[data_name] = choose_type_and_dump_to_json(std::move(reference));
+			json_data[data_name] = choose_type_and_dump_to_json(Ref_r{reference});
+			const int indent = options.pretty ? 4 : -1;
+
+			if (options.streaming) {
+				auto stream = m_streams.find(filepath);
+				if (stream == m_streams.end()) {
+					logger.debug("Opening {} for streaming", filepath);
+					stream = m_streams.emplace(filepath, std::make_unique<Json_stream>(filepath, options.sync_every)).first;
+				}
+				stream->second->write(json_data.dump(indent));
+				logger.debug("Done ! {} ", data_name);
+				continue;
+			}
 
 			std::filesystem::path fp(filepath);
 			std::fstream json_file(fp, std::ios::in | std::ios::out | std::ios::ate);
@@ -353,7 +606,7 @@ private:
 				// Create the file
 				// Write the json data between brackets
 				json_file.open(fp, std::ios::out);
-				json_file << "[\n" << json_data.dump(4) << "\n]";
+				json_file << "[\n" << json_data.dump(indent) << "\n]";
 				json_file.close();
 			} else {
 				// Case 2: File exist
@@ -366,7 +619,7 @@ private:
 				json_file.get(lastChar);
 				if (lastChar == ']') {
 					json_file.seekp(-2, std::ios::end); // Move one character back to overwrite the closing ']'
-					json_file << ",\n" << json_data.dump(4) << "\n]";
+					json_file << ",\n" << json_data.dump(indent) << "\n]";
 				} else {
 					logger.error("File does not end with a valid JSON array. Cannot append.");
 				}
@@ -0,0 +1,76 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include <paraconf.h>
+#include <stdio.h>
+#include <pdi.h>
+
+const char* CONFIG_YAML
+	= "pdi:                                                                    \n"
+	  "  data:                                                                 \n"
+	  "    var_int: int                                                        \n"
+	  "    var_array: { type: array, subtype: int, size: 3 }                   \n"
+	  "                                                                        \n"
+	  "  plugins:                                                              \n"
+	  "    json:                                                               \n"
+	  "      - file : json_08_streaming.json                                   \n"
+	  "        streaming : true                                                \n"
+	  "        pretty : false                                                  \n"
+	  "        sync_every : 2                                                  \n"
+	  "        close_on : checkpoint                                           \n"
+	  "        write : [var_int, var_array]                                    \n";
+
+int main(void)
+{
+	PC_tree_t conf = PC_parse_string(CONFIG_YAML);
+	PDI_init(PC_get(conf, ".pdi"));
+
+	for (int step = 0; step < 3; ++step) {
+		int var_array[3] = {step, step + 1, step + 2};
+		PDI_expose("var_int", &step, PDI_OUT);
+		// between two syncs, the file on disk is still a terminated JSON array
+		FILE* json_file = fopen("json_08_streaming.json", "r");
+		if (!json_file || fseek(json_file, -1, SEEK_END) || fgetc(json_file) != ']') {
+			fprintf(stderr, "json_08_streaming.json not terminated between syncs\n");
+			return 1;
+		}
+		fclose(json_file);
+		PDI_expose("var_array", var_array, PDI_OUT);
+		if (step == 0) {
+			// after sync_every writes, the file on disk is a terminated JSON array
+			json_file = fopen("json_08_streaming.json", "r");
+			if (!json_file || fseek(json_file, -1, SEEK_END) || fgetc(json_file) != ']') {
+				fprintf(stderr, "json_08_streaming.json not terminated after sync\n");
+				return 1;
+			}
+			fclose(json_file);
+		} else if (step == 1) {
+			// the file is closed with a valid JSON array, then re-opened on next write
+			PDI_event("checkpoint");
+		}
+	}
+
+	PDI_finalize();
+	return 0;
+}
@@ -0,0 +1,281 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include <paraconf.h>
+#include <pdi.h>
+
+namespace {
+
+struct Record_type {
+	char c;
+	double d;
+	int i;
+};
+
+const char* CONFIG_YAML
+	= "logging: off                                       \n"
+	  "metadata:                                          \n"
+	  "  nb_records: int64                                \n"
+	  "  n: int64                                         \n"
+	  "data:                                              \n"
+	  "  records:                                         \n"
+	  "    type: array                                    \n"
+	  "    size: $nb_records                              \n"
+	  "    subtype:                                       \n"
+	  "      type: struct                                 \n"
+	  "      members: [ {c: char}, {d: double}, {i: int} ]\n"
+	  "  ghosted:                                         \n"
+	  "    type: array                                    \n"
+	  "    subtype: double                                \n"
+	  "    size: ['$n+2', '$n+2', '$n+2']                 \n"
+	  "    start: [1, 1, 1]                               \n"
+	  "    subsize: ['$n', '$n', '$n']                    \n"
+	  "  dense:                                           \n"
+	  "    type: array                                    \n"
+	  "    subtype: double                                \n"
+	  "    size: ['$n', '$n']                             \n"
+	  "plugins:                                           \n"
+	  "  serialize:                                       \n"
+	  "    records: records_serialized                    \n"
+	  "    ghosted: ghosted_serialized                    \n"
+	  "    dense: dense_serialized                        \n";
+
+std::vector<Record_type> make_records(int64_t nb_records)
+{
+	std::vector<Record_type> records(nb_records);
+	for (int64_t record = 0; record < nb_records; record++) {
+		records[record] = Record_type{static_cast<char>(record), record * 1.23, static_cast<int>(record)};
+	}
+	return records;
+}
+
+std::vector<double> make_ghosted(int64_t n)
+{
+	std::vector<double> ghosted((n + 2) * (n + 2) * (n + 2));
+	for (size_t i = 0; i < ghosted.size(); i++) {
+		ghosted[i] = i * 1.23;
+	}
+	return ghosted;
+}
+
+/* Copies the inner n^3 block of a (n+2)^3 ghosted array to or from a dense one,
+ * as an application would do by hand
+ */
+template <bool SERIALIZE>
+void copy_ghosted(double* ghosted, double* dense, int64_t n)
+{
+	for (int64_t i = 0; i < n; i++) {
+		for (int64_t j = 0; j < n; j++) {
+			double* row = ghosted + ((i + 1) * (n + 2) + j + 1) * (n + 2) + 1;
+			if (SERIALIZE) {
+				memcpy(dense + (i * n + j) * n, row, n * sizeof(double));
+			} else {
+				memcpy(row, dense + (i * n + j) * n, n * sizeof(double));
+			}
+		}
+	}
+}
+
+} // namespace
+
+/* Serializes an array of padded records, the serialized data being shared
+ * with the `records_serialized` descriptor
+ */
+static void PDI_serialize_records(benchmark::State& state)
+{
+	int64_t nb_records = state.range(0);
+	std::vector<Record_type> records = make_records(nb_records);
+	PDI_init(PC_parse_string(CONFIG_YAML));
+	PDI_expose("nb_records", &nb_records, PDI_OUT);
+	for (auto _: state) {
+		PDI_expose("records", records.data(), PDI_OUT);
+	}
+	PDI_finalize();
+	state.SetBytesProcessed(state.iterations() * nb_records * sizeof(Record_type));
+}
+
+BENCHMARK(PDI_serialize_records)->Name("Serialize_records/PDI_serialize")->Arg(1 << 10)->Arg(1 << 20);
+
+static void Manual_serialize_records(benchmark::State& state)
+{
+	int64_t nb_records = state.range(0);
+	std::vector<Record_type> records = make_records(nb_records);
+	for (auto _: state) {
+		std::unique_ptr<Record_type[]> serialized{new Record_type[nb_records]};
+		memcpy(serialized.get(), records.data(), nb_records * sizeof(Record_type));
+		benchmark::DoNotOptimize(serialized.get());
+	}
+	state.SetBytesProcessed(state.iterations() * nb_records * sizeof(Record_type));
+}
+
+BENCHMARK(Manual_serialize_records)->Name("Serialize_records/Manual_serialize")->Arg(1 << 10)->Arg(1 << 20);
+
+/* Deserializes an array of padded records from the `records_serialized`
+ * descriptor when `records` is reclaimed
+ */
+static void PDI_deserialize_records(benchmark::State& state)
+{
+	int64_t nb_records = state.range(0);
+	std::vector<Record_type> records = make_records(nb_records);
+	PDI_init(PC_parse_string(CONFIG_YAML));
+	PDI_expose("nb_records", &nb_records, PDI_OUT);
+	for (auto _: state) {
+		PDI_expose("records", records.data(), PDI_IN);
+	}
+	PDI_finalize();
+	state.SetBytesProcessed(state.iterations() * nb_records * sizeof(Record_type));
+}
+
+BENCHMARK(PDI_deserialize_records)->Name("Serialize_records/PDI_deserialize")->Arg(1 << 10)->Arg(1 << 20);
+
+static void Manual_deserialize_records(benchmark::State& state)
+{
+	int64_t nb_records = state.range(0);
+	std::vector<Record_type> records = make_records(nb_records);
+	for (auto _: state) {
+		std::unique_ptr<Record_type[]> serialized{new Record_type[nb_records]};
+		benchmark::DoNotOptimize(serialized.get());
+		memcpy(records.data(), serialized.get(), nb_records * sizeof(Record_type));
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed(state.iterations() * nb_records * sizeof(Record_type));
+}
+
+BENCHMARK(Manual_deserialize_records)->Name("Serialize_records/Manual_deserialize")->Arg(1 << 10)->Arg(1 << 20);
+
+/* Serializes the inner block of a 3D array with a ghost layer of 1 */
+static void PDI_serialize_ghosted(benchmark::State& state)
+{
+	int64_t n = state.range(0);
+	std::vector<double> ghosted = make_ghosted(n);
+	PDI_init(PC_parse_string(CONFIG_YAML));
+	PDI_expose("n", &n, PDI_OUT);
+	for (auto _: state) {
+		PDI_expose("ghosted", ghosted.data(), PDI_OUT);
+	}
+	PDI_finalize();
+	state.SetBytesProcessed(state.iterations() * n * n * n * sizeof(double));
+}
+
+BENCHMARK(PDI_serialize_ghosted)->Name("Serialize_ghosted/PDI_serialize")->Arg(16)->Arg(128);
+
+static void Manual_serialize_ghosted(benchmark::State& state)
+{
+	int64_t n = state.range(0);
+	std::vector<double> ghosted = make_ghosted(n);
+	for (auto _: state) {
+		std::unique_ptr<double[]> serialized{new double[n * n * n]};
+		copy_ghosted<true>(ghosted.data(), serialized.get(), n);
+		benchmark::DoNotOptimize(serialized.get());
+	}
+	state.SetBytesProcessed(state.iterations() * n * n * n * sizeof(double));
+}
+
+BENCHMARK(Manual_serialize_ghosted)->Name("Serialize_ghosted/Manual_serialize")->Arg(16)->Arg(128);
+
+/* Deserializes the inner block of a 3D array with a ghost layer of 1 */
+static void PDI_deserialize_ghosted(benchmark::State& state)
+{
+	int64_t n = state.range(0);
+	std::vector<double> ghosted = make_ghosted(n);
+	PDI_init(PC_parse_string(CONFIG_YAML));
+	PDI_expose("n", &n, PDI_OUT);
+	for (auto _: state) {
+		PDI_expose("ghosted", ghosted.data(), PDI_IN);
+	}
+	PDI_finalize();
+	state.SetBytesProcessed(state.iterations() * n * n * n * sizeof(double));
+}
+
+BENCHMARK(PDI_deserialize_ghosted)->Name("Serialize_ghosted/PDI_deserialize")->Arg(16)->Arg(128);
+
+static void Manual_deserialize_ghosted(benchmark::State& state)
+{
+	int64_t n = state.range(0);
+	std::vector<double> ghosted = make_ghosted(n);
+	for (auto _: state) {
+		std::unique_ptr<double[]> serialized{new double[n * n * n]};
+		benchmark::DoNotOptimize(serialized.get());
+		copy_ghosted<false>(ghosted.data(), serialized.get(), n);
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed(state.iterations() * n * n * n * sizeof(double));
+}
+
+BENCHMARK(Manual_deserialize_ghosted)->Name("Serialize_ghosted/Manual_deserialize")->Arg(16)->Arg(128);
+
+/* Serializes and deserializes the inner block of a 3D array with a ghost layer
+ * of 1, split between threads along the outermost dimension
+ */
+static void PDI_serialize_ghosted_threads(benchmark::State& state)
+{
+	int64_t n = state.range(0);
+	std::vector<double> ghosted = make_ghosted(n);
+	std::string config = std::string{CONFIG_YAML} + "    threads: " + std::to_string(state.range(1)) + "\n    threads_threshold: 0\n";
+	PDI_init(PC_parse_string(config.c_str()));
+	PDI_expose("n", &n, PDI_OUT);
+	for (auto _: state) {
+		PDI_expose("ghosted", ghosted.data(), PDI_INOUT);
+	}
+	PDI_finalize();
+	state.SetBytesProcessed(state.iterations() * 2 * n * n * n * sizeof(double));
+}
+
+BENCHMARK(PDI_serialize_ghosted_threads)->Name("Serialize_ghosted_threads/PDI_serialize_deserialize")->ArgsProduct({{256}, {1, 2, 4}})->UseRealTime();
+
+/* Serializes a dense 2D array, that has the same layout once serialized */
+static void PDI_serialize_dense(benchmark::State& state)
+{
+	int64_t n = state.range(0);
+	std::vector<double> dense(n * n, 1.23);
+	PDI_init(PC_parse_string(CONFIG_YAML));
+	PDI_expose("n", &n, PDI_OUT);
+	for (auto _: state) {
+		PDI_expose("dense", dense.data(), PDI_OUT);
+	}
+	PDI_finalize();
+	state.SetBytesProcessed(state.iterations() * n * n * sizeof(double));
+}
+
+BENCHMARK(PDI_serialize_dense)->Name("Serialize_dense/PDI_serialize")->Arg(1 << 10);
+
+static void Manual_serialize_dense(benchmark::State& state)
+{
+	int64_t n = state.range(0);
+	std::vector<double> dense(n * n, 1.23);
+	for (auto _: state) {
+		std::unique_ptr<double[]> serialized{new double[n * n]};
+		memcpy(serialized.get(), dense.data(), n * n * sizeof(double));
+		benchmark::DoNotOptimize(serialized.get());
+	}
+	state.SetBytesProcessed(state.iterations() * n * n * sizeof(double));
+}
+
+BENCHMARK(Manual_serialize_dense)->Name("Serialize_dense/Manual_serialize")->Arg(1 << 10);
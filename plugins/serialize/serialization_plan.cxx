@@ -0,0 +1,355 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <thread>
+
+#include <pdi/array_datatype.h>
+#include <pdi/error.h>
+#include <pdi/pointer_datatype.h>
+#include <pdi/record_datatype.h>
+#include <pdi/scalar_datatype.h>
+#include <pdi/tuple_datatype.h>
+
+#include "serialization_plan.h"
+
+namespace serialize {
+
+using std::dynamic_pointer_cast;
+
+namespace {
+
+/** Copies strided elements of a scalar type with plain loads and stores that
+ * the compiler can vectorize
+ *
+ * \param count number of elements to copy
+ * \param to where to copy the first element
+ * \param to_stride distance between two copied elements
+ * \param from from where to copy the first element
+ * \param from_stride distance between two elements to copy
+ */
+template <class T>
+void strided_copy(size_t count, uint8_t* to, size_t to_stride, const uint8_t* from, size_t from_stride)
+{
+	for (size_t element = 0; element < count; ++element) {
+		T value;
+		memcpy(&value, from + element * from_stride, sizeof(T));
+		memcpy(to + element * to_stride, &value, sizeof(T));
+	}
+}
+
+/** Copies strided elements of any size
+ *
+ * \param size size of an element
+ * \param count number of elements to copy
+ * \param to where to copy the first element
+ * \param to_stride distance between two copied elements
+ * \param from from where to copy the first element
+ * \param from_stride distance between two elements to copy
+ */
+void strided_copy(size_t size, size_t count, uint8_t* to, size_t to_stride, const uint8_t* from, size_t from_stride)
+{
+	switch (size) {
+	case 1:
+		strided_copy<uint8_t>(count, to, to_stride, from, from_stride);
+		break;
+	case 2:
+		strided_copy<uint16_t>(count, to, to_stride, from, from_stride);
+		break;
+	case 4:
+		strided_copy<uint32_t>(count, to, to_stride, from, from_stride);
+		break;
+	case 8:
+		strided_copy<uint64_t>(count, to, to_stride, from, from_stride);
+		break;
+	default:
+		for (size_t element = 0; element < count; ++element) {
+			memcpy(to + element * to_stride, from + element * from_stride, size);
+		}
+	}
+}
+
+} // namespace
+
+PDI::Datatype_sptr serialize_type(PDI::Datatype_sptr type)
+{
+	if (auto&& scalar_type = dynamic_pointer_cast<const PDI::Scalar_datatype>(type)) {
+		return type;
+	} else if (auto&& array_type = dynamic_pointer_cast<const PDI::Array_datatype>(type)) {
+		return PDI::Array_datatype::make(serialize_type(array_type->subtype()), array_type->subsize(), array_type->attributes());
+	} else if (auto&& record_type = dynamic_pointer_cast<const PDI::Record_datatype>(type)) {
+		std::vector<PDI::Record_datatype::Member> serialized_members;
+		size_t offset = 0;
+		size_t alignment = 0;
+		size_t serialized_buffersize = 0;
+		for (auto&& member: record_type->members()) {
+			PDI::Datatype_sptr serialized_type = serialize_type(member.type());
+
+			size_t member_alignment = serialized_type->alignment();
+			size_t spacing = (member_alignment - (offset % member_alignment)) % member_alignment;
+
+			// add space to offset and buffersize
+			offset += spacing;
+			serialized_buffersize += spacing;
+
+			serialized_members.emplace_back(offset, serialized_type, member.name());
+
+			// move offset by the buffersize
+			offset += serialized_type->buffersize();
+			serialized_buffersize += serialized_type->buffersize();
+
+			// serialized alignment (for final spacing)
+			alignment = std::max(alignment, member_alignment);
+		}
+
+		// check the spacing at the end of record
+		size_t spacing = (alignment - (offset % alignment)) % alignment;
+		serialized_buffersize += spacing;
+
+		return PDI::Record_datatype::make(move(serialized_members), serialized_buffersize, record_type->attributes());
+	} else if (auto&& pointer_type = dynamic_pointer_cast<const PDI::Pointer_datatype>(type)) {
+		return serialize_type(pointer_type->subtype());
+	} else if (auto&& tuple_type = dynamic_pointer_cast<const PDI::Tuple_datatype>(type)) {
+		std::vector<PDI::Tuple_datatype::Element> serialized_elements;
+		size_t offset = 0;
+		size_t alignment = 0;
+		size_t serialized_buffersize = 0;
+		for (auto&& element: tuple_type->elements()) {
+			PDI::Datatype_sptr serialized_type = serialize_type(element.type());
+
+			size_t element_alignment = serialized_type->alignment();
+			size_t spacing = (element_alignment - (offset % element_alignment)) % element_alignment;
+
+			// add space to offset and buffersize
+			offset += spacing;
+			serialized_buffersize += spacing;
+
+			serialized_elements.emplace_back(offset, serialized_type);
+
+			// move offset by the buffersize
+			offset += serialized_type->buffersize();
+			serialized_buffersize += serialized_type->buffersize();
+
+			// serialized alignment (for final spacing)
+			alignment = std::max(alignment, element_alignment);
+		}
+
+		// check the spacing at the end of tuple
+		size_t spacing = (alignment - (offset % alignment)) % alignment;
+		serialized_buffersize += spacing;
+
+		return PDI::Tuple_datatype::make(move(serialized_elements), serialized_buffersize, tuple_type->attributes());
+	} else {
+		throw PDI::Type_error{"Serialize plugin: Unsupported type: {}", type->debug_string()};
+	}
+}
+
+Serialization_plan::Serialization_plan(PDI::Datatype_sptr type)
+	: m_type{type}
+	, m_serialized_type{serialize_type(type)}
+{
+	m_copied_size = compile(m_type, m_serialized_type, 0, 0, m_steps);
+	m_contiguous = m_steps.size() == 1 && m_steps.front().m_kind == Step::COPY && m_steps.front().m_serialized == 0
+	    && m_steps.front().m_size == m_serialized_type->buffersize();
+}
+
+void Serialization_plan::add_copy(size_t data, size_t serialized, size_t size, std::vector<Step>& steps)
+{
+	if (!steps.empty()) {
+		Step& previous = steps.back();
+		if (previous.m_kind == Step::COPY && previous.m_data + previous.m_size == data && previous.m_serialized + previous.m_size == serialized) {
+			// contiguous with the previous copy
+			previous.m_size += size;
+			return;
+		}
+	}
+	steps.push_back(Step{Step::COPY, data, serialized, size, 0, 0, 0, {}});
+}
+
+size_t Serialization_plan::compile(PDI::Datatype_sptr type, PDI::Datatype_sptr serialized_type, size_t data, size_t serialized, std::vector<Step>& steps)
+{
+	if (*type == *serialized_type) {
+		// same layout once serialized (no pointer nor sparse array): a single block, padding included
+		add_copy(data, serialized, type->buffersize(), steps);
+		return type->datasize();
+	} else if (auto&& scalar_type = dynamic_pointer_cast<const PDI::Scalar_datatype>(type)) {
+		size_t size = scalar_type->buffersize();
+		add_copy(data, serialized, size, steps);
+		return size;
+	} else if (auto&& array_type = dynamic_pointer_cast<const PDI::Array_datatype>(type)) {
+		auto&& serialized_array_type = dynamic_pointer_cast<const PDI::Array_datatype>(serialized_type);
+		size_t data_stride = array_type->subtype()->buffersize();
+		size_t serialized_stride = serialized_array_type->subtype()->buffersize();
+		data += array_type->start() * data_stride;
+
+		std::vector<Step> body;
+		size_t element_copied_size = compile(array_type->subtype(), serialized_array_type->subtype(), 0, 0, body);
+		if (array_type->subsize() == 0) {
+			return 0;
+		}
+		if (body.size() == 1 && body.front().m_kind == Step::COPY && body.front().m_data == 0 && body.front().m_serialized == 0
+		    && body.front().m_size == data_stride && body.front().m_size == serialized_stride)
+		{
+			// dense elements: the whole array is contiguous
+			add_copy(data, serialized, array_type->subsize() * data_stride, steps);
+		} else if (array_type->subsize() == 1) {
+			compile(array_type->subtype(), serialized_array_type->subtype(), data, serialized, steps);
+		} else {
+			steps.push_back(Step{Step::LOOP, data, serialized, 0, array_type->subsize(), data_stride, serialized_stride, move(body)});
+		}
+		return array_type->subsize() * element_copied_size;
+	} else if (auto&& record_type = dynamic_pointer_cast<const PDI::Record_datatype>(type)) {
+		auto&& serialized_record_type = dynamic_pointer_cast<const PDI::Record_datatype>(serialized_type);
+		size_t copied_size = 0;
+		for (size_t member_no = 0; member_no < record_type->members().size(); ++member_no) {
+			auto&& member = record_type->members()[member_no];
+			auto&& serialized_member = serialized_record_type->members()[member_no];
+			copied_size
+				+= compile(member.type(), serialized_member.type(), data + member.displacement(), serialized + serialized_member.displacement(), steps);
+		}
+		return copied_size;
+	} else if (auto&& pointer_type = dynamic_pointer_cast<const PDI::Pointer_datatype>(type)) {
+		std::vector<Step> body;
+		size_t copied_size = compile(pointer_type->subtype(), serialized_type, 0, 0, body);
+		steps.push_back(Step{Step::POINTER, data, serialized, 0, 0, 0, 0, move(body)});
+		return copied_size;
+	} else if (auto&& tuple_type = dynamic_pointer_cast<const PDI::Tuple_datatype>(type)) {
+		auto&& serialized_tuple_type = dynamic_pointer_cast<const PDI::Tuple_datatype>(serialized_type);
+		size_t copied_size = 0;
+		for (size_t element_no = 0; element_no < tuple_type->elements().size(); ++element_no) {
+			auto&& element = tuple_type->elements()[element_no];
+			auto&& serialized_element = serialized_tuple_type->elements()[element_no];
+			copied_size += compile(element.type(), serialized_element.type(), data + element.offset(), serialized + serialized_element.offset(), steps);
+		}
+		return copied_size;
+	} else {
+		throw PDI::Type_error{"Serialize plugin: Unsupported type: {}", type->debug_string()};
+	}
+}
+
+template <bool SERIALIZE>
+void Serialization_plan::run(const std::vector<Step>& steps, uint8_t* data, uint8_t* serialized)
+{
+	for (auto&& step: steps) {
+		switch (step.m_kind) {
+		case Step::COPY:
+			if (SERIALIZE) {
+				memcpy(serialized + step.m_serialized, data + step.m_data, step.m_size);
+			} else {
+				memcpy(data + step.m_data, serialized + step.m_serialized, step.m_size);
+			}
+			break;
+		case Step::LOOP: {
+			uint8_t* loop_data = data + step.m_data;
+			uint8_t* loop_serialized = serialized + step.m_serialized;
+			if (step.m_body.size() == 1 && step.m_body.front().m_kind == Step::COPY) {
+				// strided run
+				auto&& copy = step.m_body.front();
+				if (SERIALIZE) {
+					strided_copy(copy.m_size, step.m_count, loop_serialized + copy.m_serialized, step.m_serialized_stride, loop_data + copy.m_data, step.m_data_stride);
+				} else {
+					strided_copy(copy.m_size, step.m_count, loop_data + copy.m_data, step.m_data_stride, loop_serialized + copy.m_serialized, step.m_serialized_stride);
+				}
+			} else {
+				for (size_t element = 0; element < step.m_count; ++element) {
+					run<SERIALIZE>(step.m_body, loop_data + element * step.m_data_stride, loop_serialized + element * step.m_serialized_stride);
+				}
+			}
+		} break;
+		case Step::POINTER:
+			run<SERIALIZE>(step.m_body, *reinterpret_cast<uint8_t**>(data + step.m_data), serialized + step.m_serialized);
+			break;
+		}
+	}
+}
+
+template <bool SERIALIZE>
+void Serialization_plan::run(uint8_t* data, uint8_t* serialized, size_t threads) const
+{
+	if (threads <= 1 || m_steps.size() != 1 || m_steps.front().m_kind != Step::LOOP) {
+		run<SERIALIZE>(m_steps, data, serialized);
+		return;
+	}
+
+	// each thread runs the loop on its own range of elements, at precomputed offsets
+	const Step& loop = m_steps.front();
+	threads = std::min(threads, loop.m_count);
+	std::vector<std::vector<Step>> parts(threads, std::vector<Step>{loop});
+	for (size_t thread_id = 0; thread_id < threads; ++thread_id) {
+		size_t begin = loop.m_count * thread_id / threads;
+		size_t end = loop.m_count * (thread_id + 1) / threads;
+		Step& part = parts[thread_id].front();
+		part.m_data += begin * loop.m_data_stride;
+		part.m_serialized += begin * loop.m_serialized_stride;
+		part.m_count = end - begin;
+	}
+
+	std::vector<std::thread> workers;
+	for (size_t thread_id = 1; thread_id < threads; ++thread_id) {
+		workers.emplace_back([&parts, thread_id, data, serialized]() { run<SERIALIZE>(parts[thread_id], data, serialized); });
+	}
+	run<SERIALIZE>(parts.front(), data, serialized);
+	for (auto&& worker: workers) {
+		worker.join();
+	}
+}
+
+PDI::Datatype_sptr Serialization_plan::type() const
+{
+	return m_type;
+}
+
+PDI::Datatype_sptr Serialization_plan::serialized_type() const
+{
+	return m_serialized_type;
+}
+
+bool Serialization_plan::contiguous() const
+{
+	return m_contiguous;
+}
+
+void* Serialization_plan::in_place(void* data) const
+{
+	assert(m_contiguous);
+	return static_cast<uint8_t*>(data) + m_steps.front().m_data;
+}
+
+size_t Serialization_plan::serialize(void* to, const void* from, size_t threads) const
+{
+	// the data is only read when serializing
+	run<true>(static_cast<uint8_t*>(const_cast<void*>(from)), static_cast<uint8_t*>(to), threads);
+	return m_copied_size;
+}
+
+size_t Serialization_plan::deserialize(void* to, const void* from, size_t threads) const
+{
+	// the serialized data is only read when deserializing
+	run<false>(static_cast<uint8_t*>(to), static_cast<uint8_t*>(const_cast<void*>(from)), threads);
+	return m_copied_size;
+}
+
+} // namespace serialize
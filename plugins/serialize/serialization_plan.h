@@ -0,0 +1,196 @@
+/*******************************************************************************
+ * Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * * Neither the name of CEA nor the names of its contributors may be used to
+ *   endorse or promote products derived from this software without specific
+ *   prior written permission.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef SERIALIZE_SERIALIZATION_PLAN_H_
+#define SERIALIZE_SERIALIZATION_PLAN_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <pdi/pdi_fwd.h>
+#include <pdi/datatype.h>
+
+namespace serialize {
+
+/** Serializes data type
+ *
+ * \param type type to serialize (convert all sparse arrays and evaluate pointers)
+ * \return serialized data type
+ */
+PDI::Datatype_sptr serialize_type(PDI::Datatype_sptr type);
+
+/** A Serialization_plan copies data between a datatype and its serialized
+ * datatype.
+ *
+ * The serialized type and the copy are compiled once for a given type: the
+ * copy is a list of steps where contiguous bytes are copied with a single
+ * memcpy, strided elements by a loop and pointers dereferenced.
+ */
+class Serialization_plan
+{
+	/// A step of the copy
+	struct Step {
+		enum Kind {
+			COPY, ///< copies m_size contiguous bytes
+			LOOP, ///< runs m_body m_count times, moving by the strides
+			POINTER ///< runs m_body on the data pointed to
+		};
+
+		Kind m_kind;
+
+		/// offset of the step in the data (of the pointer for POINTER)
+		size_t m_data;
+
+		/// offset of the step in the serialized data
+		size_t m_serialized;
+
+		/// number of bytes copied (COPY)
+		size_t m_size;
+
+		/// number of iterations (LOOP)
+		size_t m_count;
+
+		/// distance between two elements in the data (LOOP)
+		size_t m_data_stride;
+
+		/// distance between two elements in the serialized data (LOOP)
+		size_t m_serialized_stride;
+
+		/// steps of each element (LOOP) or of the pointed data (POINTER)
+		std::vector<Step> m_body;
+	};
+
+	/// the type the plan was compiled for
+	PDI::Datatype_sptr m_type;
+
+	/// the serialized type
+	PDI::Datatype_sptr m_serialized_type;
+
+	/// the compiled copy
+	std::vector<Step> m_steps;
+
+	/// the number of bytes copied by the plan
+	size_t m_copied_size = 0;
+
+	/// whether the serialized data is a contiguous block of the data
+	bool m_contiguous = false;
+
+	/** Adds a copy to steps, merged with the previous one if contiguous
+	 *
+	 * \param data the offset of the copied bytes in the data
+	 * \param serialized the offset of the copied bytes in the serialized data
+	 * \param size the number of bytes copied
+	 * \param steps where to add the copy
+	 */
+	static void add_copy(size_t data, size_t serialized, size_t size, std::vector<Step>& steps);
+
+	/** Compiles the copy of a type
+	 *
+	 * \param type the type of the data
+	 * \param serialized_type the serialized type
+	 * \param data the offset of the data
+	 * \param serialized the offset of the serialized data
+	 * \param steps where to add the steps
+	 * \return the number of bytes copied
+	 */
+	static size_t compile(PDI::Datatype_sptr type, PDI::Datatype_sptr serialized_type, size_t data, size_t serialized, std::vector<Step>& steps);
+
+	/** Runs steps
+	 *
+	 * \tparam SERIALIZE whether to copy from data to serialized data or the opposite
+	 * \param steps the steps to run
+	 * \param data the data
+	 * \param serialized the serialized data
+	 */
+	template <bool SERIALIZE>
+	static void run(const std::vector<Step>& steps, uint8_t* data, uint8_t* serialized);
+
+	/** Runs the plan, split along the outermost array dimension between threads
+	 *
+	 * \tparam SERIALIZE whether to copy from data to serialized data or the opposite
+	 * \param data the data
+	 * \param serialized the serialized data
+	 * \param threads the number of threads to use
+	 */
+	template <bool SERIALIZE>
+	void run(uint8_t* data, uint8_t* serialized, size_t threads) const;
+
+public:
+	/** Compiles the plan of a type
+	 *
+	 * \param type the type of the data to (de)serialize
+	 */
+	Serialization_plan(PDI::Datatype_sptr type);
+
+	/** The type the plan was compiled for
+	 *
+	 * \return the type of the data
+	 */
+	PDI::Datatype_sptr type() const;
+
+	/** The serialized type
+	 *
+	 * \return the type of the serialized data
+	 */
+	PDI::Datatype_sptr serialized_type() const;
+
+	/** Whether the serialized data has the same layout as a contiguous block
+	 * of the data, e.g. a dense array without pointers, in which case it can
+	 * be shared in place without copy
+	 *
+	 * \return whether the serialized data is a contiguous block of the data
+	 */
+	bool contiguous() const;
+
+	/** The serialized data in place in the data, only valid for a contiguous
+	 * plan
+	 *
+	 * \param data pointer to the data
+	 * \return pointer to the serialized data inside data
+	 */
+	void* in_place(void* data) const;
+
+	/** Make a serialize copy (from deserialized data to serialized)
+	 *
+	 * \param to pointer where data will be copied (serialized)
+	 * \param from pointer from where get the data to copy (deserialized)
+	 * \param threads number of threads to split the copy between
+	 * \return count of copied bytes
+	 */
+	size_t serialize(void* to, const void* from, size_t threads = 1) const;
+
+	/** Make a deserialize copy (from serialized data to deserialized)
+	 *
+	 * \param to pointer where data will be copied (deserialized)
+	 * \param from pointer from where get the data to copy (serialized)
+	 * \param threads number of threads to split the copy between
+	 * \return count of copied bytes
+	 */
+	size_t deserialize(void* to, const void* from, size_t threads = 1) const;
+};
+
+} // namespace serialize
+
+#endif // SERIALIZE_SERIALIZATION_PLAN_H_
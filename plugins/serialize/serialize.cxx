@@ -23,28 +23,27 @@
  * THE SOFTWARE.
  ******************************************************************************/
 
+#include <algorithm>
 #include <functional>
+#include <list>
 #include <map>
 #include <memory>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include <pdi/pdi_fwd.h>
-#include <pdi/array_datatype.h>
 #include <pdi/context.h>
 #include <pdi/error.h>
 #include <pdi/expression.h>
 #include <pdi/logger.h>
 #include <pdi/paraconf_wrapper.h>
 #include <pdi/plugin.h>
-#include <pdi/pointer_datatype.h>
-#include <pdi/record_datatype.h>
 #include <pdi/ref_any.h>
-#include <pdi/scalar_datatype.h>
-#include <pdi/tuple_datatype.h>
 
-namespace {
+#include "serialization_plan.h"
 
-using std::dynamic_pointer_cast;
+namespace {
 
 struct serialize_plugin: PDI::Plugin {
 	/// Map of deserialized and serialized data dependency <deserialized desc_name, serialized desc_name>
@@ -54,215 +53,89 @@ struct serialize_plugin: PDI::Plugin {
 	 *  Cannot be a map - one data can be serialized mulitple times
 	 *  Cannot be a multimap - need to release the last serialized data (stack)
 	 *
-	 *  Tuple: <serialized desc name, remove callback function, right of deserialized share>
-	 */
-	std::vector<std::tuple<std::string, std::function<void()>, PDI_inout_t>> m_serialized_remove_callback;
-
-	/** Serializes data type
-	 *
-	 * \param type type to serialize (convert all sparse arrays and evaluate pointers)
-	 * \return serialized data type
+	 *  Tuple: <serialized desc name, remove callback function, right of deserialized share, whether the serialized data is shared in place>
 	 */
-	PDI::Datatype_sptr serialize_type(PDI::Datatype_sptr type)
-	{
-		if (auto&& scalar_type = dynamic_pointer_cast<const PDI::Scalar_datatype>(type)) {
-			return type;
-		} else if (auto&& array_type = dynamic_pointer_cast<const PDI::Array_datatype>(type)) {
-			return PDI::Array_datatype::make(serialize_type(array_type->subtype()), array_type->subsize(), array_type->attributes());
-		} else if (auto&& record_type = dynamic_pointer_cast<const PDI::Record_datatype>(type)) {
-			std::vector<PDI::Record_datatype::Member> serialized_members;
-			size_t offset = 0;
-			size_t alignment = 0;
-			size_t serialized_buffersize = 0;
-			for (auto&& member: record_type->members()) {
-				PDI::Datatype_sptr serialized_type = serialize_type(member.type());
-
-				size_t member_alignment = serialized_type->alignment();
-				size_t spacing = (member_alignment - (offset % member_alignment)) % member_alignment;
-
-				// add space to offset and buffersize
-				offset += spacing;
-				serialized_buffersize += spacing;
-
-				serialized_members.emplace_back(offset, serialized_type, member.name());
-
-				// move offset by the buffersize
-				offset += serialized_type->buffersize();
-				serialized_buffersize += serialized_type->buffersize();
-
-				// serialized alignment (for final spacing)
-				alignment = std::max(alignment, member_alignment);
-			}
-
-			// check the spacing at the end of record
-			size_t spacing = (alignment - (offset % alignment)) % alignment;
-			serialized_buffersize += spacing;
+	std::vector<std::tuple<std::string, std::function<void()>, PDI_inout_t, bool>> m_serialized_remove_callback;
 
-			return PDI::Record_datatype::make(move(serialized_members), serialized_buffersize, record_type->attributes());
-		} else if (auto&& pointer_type = dynamic_pointer_cast<const PDI::Pointer_datatype>(type)) {
-			return serialize_type(pointer_type->subtype());
-		} else if (auto&& tuple_type = dynamic_pointer_cast<const PDI::Tuple_datatype>(type)) {
-			std::vector<PDI::Tuple_datatype::Element> serialized_elements;
-			size_t offset = 0;
-			size_t alignment = 0;
-			size_t serialized_buffersize = 0;
-			for (auto&& element: tuple_type->elements()) {
-				PDI::Datatype_sptr serialized_type = serialize_type(element.type());
+	/// References to the user data shared in place, nullifying the serialized data with them (null once nullified)
+	std::list<PDI::Ref> m_aliased_data;
 
-				size_t element_alignment = serialized_type->alignment();
-				size_t spacing = (element_alignment - (offset % element_alignment)) % element_alignment;
+	/// Serialization plans of the data to serialize, compiled for the last shared type of each descriptor
+	std::unordered_map<std::string, serialize::Serialization_plan> m_plans;
 
-				// add space to offset and buffersize
-				offset += spacing;
-				serialized_buffersize += spacing;
+	/// Number of threads to (de)serialize large data with (0 for one per hardware thread)
+	PDI::Expression m_threads{1L};
 
-				serialized_elements.emplace_back(offset, serialized_type);
+	/// Size in bytes of the serialized data under which it is (de)serialized by a single thread
+	PDI::Expression m_threads_threshold{4L << 20};
 
-				// move offset by the buffersize
-				offset += serialized_type->buffersize();
-				serialized_buffersize += serialized_type->buffersize();
-
-				// serialized alignment (for final spacing)
-				alignment = std::max(alignment, element_alignment);
-			}
-
-			// check the spacing at the end of tuple
-			size_t spacing = (alignment - (offset % alignment)) % alignment;
-			serialized_buffersize += spacing;
-
-			return PDI::Tuple_datatype::make(move(serialized_elements), serialized_buffersize, tuple_type->attributes());
-		} else {
-			throw PDI::Type_error{"Serialize plugin: Unsupported type: {}", type->debug_string()};
+	/** Returns the number of threads to (de)serialize data with
+	 *
+	 * \param serialization_plan the serialization plan of the data
+	 * \return the number of threads to use
+	 */
+	size_t threads(const serialize::Serialization_plan& serialization_plan)
+	{
+		long threads = m_threads.to_long(context());
+		if (threads == 1 || serialization_plan.serialized_type()->datasize() < static_cast<size_t>(m_threads_threshold.to_long(context()))) {
+			return 1;
+		}
+		if (threads <= 0) {
+			threads = std::max(1u, std::thread::hardware_concurrency());
 		}
+		context().logger().trace("Copy split between {} threads", threads);
+		return threads;
 	}
 
-	/** Make a serialize copy (from serialized data to serialized)
+	/** Returns the serialization plan of a descriptor, compiled again if its type has changed
 	 *
-	 * \param type type of the deserialized data
-	 * \param to pointer where data will be copied (serialized)
-	 * \param from pointer from where get the data to copy (deserialized)
-	 * \return count of copied bytes
+	 * \param desc_name name of the descriptor to serialize/deserialize
+	 * \param type type of the data to serialize/deserialize
+	 * \return the serialization plan of the type
 	 */
-	size_t serialize_copy(const PDI::Datatype_sptr type, void* to, const void* from)
+	const serialize::Serialization_plan& plan(const std::string& desc_name, PDI::Datatype_sptr type)
 	{
-		if (auto&& scalar_type = dynamic_pointer_cast<const PDI::Scalar_datatype>(type)) {
-			memcpy(to, from, scalar_type->buffersize());
-			return scalar_type->buffersize();
-		} else if (auto&& array_type = dynamic_pointer_cast<const PDI::Array_datatype>(type)) {
-			size_t subtype_buffersize = array_type->subtype()->buffersize();
-			from = static_cast<const uint8_t*>(from) + (array_type->start() * subtype_buffersize);
-
-			PDI::Datatype_sptr serialized_subtype = serialize_type(array_type->subtype());
-			size_t subtype_alignment = serialized_subtype->alignment();
-
-			//space_to_align is set to alignment(), because we always find the alignment in the size of alignment
-			size_t space_to_align = subtype_alignment;
-			to = std::align(subtype_alignment, 0, to, space_to_align);
-
-			size_t all_bytes_copied = 0;
-			for (size_t subtype_no = 0; subtype_no < array_type->subsize(); subtype_no++) {
-				size_t bytes_copied = serialize_copy(array_type->subtype(), to, from);
-				all_bytes_copied += bytes_copied;
-				to = static_cast<uint8_t*>(to) + bytes_copied;
-				from = static_cast<const uint8_t*>(from) + subtype_buffersize;
-			}
-			return all_bytes_copied;
-		} else if (auto&& record_type = std::dynamic_pointer_cast<const PDI::Record_datatype>(type)) {
-			auto&& record_serialized = dynamic_pointer_cast<const PDI::Record_datatype>(serialize_type(record_type));
-
-			int member_no = 0;
-			size_t all_bytes_copied = 0;
-			uint8_t* original_to = static_cast<uint8_t*>(to);
-			for (auto&& member: record_type->members()) {
-				//size = 0, because we know that to points to allocated memory
-				to = original_to + record_serialized->members()[member_no].displacement();
-				const uint8_t* member_from = static_cast<const uint8_t*>(from) + member.displacement();
-
-				size_t bytes_copied = serialize_copy(member.type(), to, member_from);
-				all_bytes_copied += bytes_copied;
-				member_no++;
-			}
-			return all_bytes_copied;
-		} else if (auto&& pointer_type = std::dynamic_pointer_cast<const PDI::Pointer_datatype>(type)) {
-			return serialize_copy(pointer_type->subtype(), to, reinterpret_cast<void*>(*static_cast<const uintptr_t*>(from)));
-		} else if (auto&& tuple_type = std::dynamic_pointer_cast<const PDI::Tuple_datatype>(type)) {
-			auto&& tuple_serialized = dynamic_pointer_cast<const PDI::Tuple_datatype>(serialize_type(tuple_type));
-
-			int element_no = 0;
-			size_t all_bytes_copied = 0;
-			uint8_t* original_to = static_cast<uint8_t*>(to);
-			for (auto&& element: tuple_type->elements()) {
-				//size = 0, because we know that to points to allocated memory
-				to = original_to + tuple_serialized->elements()[element_no].offset();
-				const uint8_t* element_from = static_cast<const uint8_t*>(from) + element.offset();
-
-				size_t bytes_copied = serialize_copy(element.type(), to, element_from);
-				all_bytes_copied += bytes_copied;
-				element_no++;
-			}
-			return all_bytes_copied;
-		} else {
-			throw PDI::Type_error{"Serialize plugin: Unsupported type: {}", type->debug_string()};
+		auto plan_it = m_plans.find(desc_name);
+		if (plan_it == m_plans.end()) {
+			plan_it = m_plans.emplace(desc_name, serialize::Serialization_plan{type}).first;
+		} else if (plan_it->second.type() != type && !(*plan_it->second.type() == *type)) {
+			context().logger().trace("Type of `{}' changed, compiling a new serialization plan", desc_name);
+			plan_it->second = serialize::Serialization_plan{type};
 		}
+		return plan_it->second;
 	}
 
-	/** Make a deserialize copy (from serialized data to deserialized)
+	/** Returns the reference to share under the serialized name: the data itself when the plan is contiguous,
+	 *  a newly allocated buffer otherwise
 	 *
-	 * \param type type of the deserialized data
-	 * \param to pointer where data will be copied (deserialized)
-	 * \param from pointer from where get the data to copy (serialized)
-	 * \return count of copied bytes
+	 * \param serialization_plan the serialization plan of the data
+	 * \param data pointer to the data
+	 * \param readable whether the serialized data can be read
+	 * \param writable whether the serialized data can be written
+	 * \return the reference to the serialized data
 	 */
-	size_t deserialize_copy(const PDI::Datatype_sptr type, void* to, const void* from)
+	PDI::Ref serialized_ref(const serialize::Serialization_plan& serialization_plan, void* data, bool readable, bool writable)
 	{
-		if (auto&& scalar_type = std::dynamic_pointer_cast<const PDI::Scalar_datatype>(type)) {
-			memcpy(to, from, scalar_type->buffersize());
-			return scalar_type->buffersize();
-		} else if (auto&& array_type = std::dynamic_pointer_cast<const PDI::Array_datatype>(type)) {
-			PDI::Datatype_sptr serialized_subtype = serialize_type(array_type->subtype());
-
-			to = static_cast<uint8_t*>(to) + (array_type->start() * array_type->subtype()->buffersize());
-			size_t all_bytes_copied = 0;
-			for (int subtype_no = 0; subtype_no < array_type->subsize(); subtype_no++) {
-				size_t bytes_copied = deserialize_copy(array_type->subtype(), to, from);
-				to = static_cast<uint8_t*>(to) + array_type->subtype()->buffersize();
-				from = static_cast<const uint8_t*>(from) + bytes_copied;
-				all_bytes_copied += bytes_copied;
-			}
-			return all_bytes_copied;
-		} else if (auto&& record_type = std::dynamic_pointer_cast<const PDI::Record_datatype>(type)) {
-			auto&& record_serialized = dynamic_pointer_cast<const PDI::Record_datatype>(serialize_type(record_type));
-
-			int member_no = 0;
-			size_t all_bytes_copied = 0;
-			for (auto&& member: record_type->members()) {
-				uint8_t* member_to = static_cast<uint8_t*>(to) + member.displacement();
-				const uint8_t* member_from = static_cast<const uint8_t*>(from) + record_serialized->members()[member_no].displacement();
-
-				size_t bytes_copied = deserialize_copy(member.type(), member_to, member_from);
-				all_bytes_copied += bytes_copied;
-				member_no++;
-			}
-			return all_bytes_copied;
-		} else if (auto&& pointer_type = std::dynamic_pointer_cast<const PDI::Pointer_datatype>(type)) {
-			return deserialize_copy(pointer_type->subtype(), reinterpret_cast<void*>(*static_cast<const uintptr_t*>(to)), from);
-		} else if (auto&& tuple_type = std::dynamic_pointer_cast<const PDI::Tuple_datatype>(type)) {
-			auto&& tuple_serialized = dynamic_pointer_cast<const PDI::Tuple_datatype>(serialize_type(tuple_type));
-
-			int element_no = 0;
-			size_t all_bytes_copied = 0;
-			for (auto&& element: tuple_type->elements()) {
-				uint8_t* element_to = static_cast<uint8_t*>(to) + element.offset();
-				const uint8_t* element_from = static_cast<const uint8_t*>(from) + tuple_serialized->elements()[element_no].offset();
-
-				size_t bytes_copied = deserialize_copy(element.type(), element_to, element_from);
-				all_bytes_copied += bytes_copied;
-				element_no++;
-			}
-			return all_bytes_copied;
-		} else {
-			throw PDI::Type_error{"Serialize plugin: Unsupported type: {}", type->debug_string()};
+		PDI::Datatype_sptr serialized_type = serialization_plan.serialized_type();
+		if (serialization_plan.contiguous()) {
+			context().logger().trace("Same layout after serialization -> share the data in place");
+			return PDI::Ref{serialization_plan.in_place(data), [](void*) {}, serialized_type, readable, writable};
 		}
+		context().logger().trace("Allocating memory: {} B", serialized_type->buffersize());
+		return PDI::Ref{operator new (serialized_type->buffersize()), [](void* p) { operator delete (p); }, serialized_type, readable, writable};
+	}
+
+	/** Ties the serialized data shared in place to the user data: the serialized data is nullified, in all the plugins
+	 *  still referencing it, when the user data is (e.g. reclaimed)
+	 *
+	 * \param ref reference to the user data
+	 * \param serialized_ref reference to the serialized data in place in the user data
+	 */
+	void alias(PDI::Ref ref, PDI::Ref serialized_ref)
+	{
+		m_aliased_data.remove_if([](const PDI::Ref& aliased) { return !aliased; });
+		m_aliased_data.emplace_back(ref);
+		m_aliased_data.back().on_nullify([serialized_ref](PDI::Ref) mutable { serialized_ref.release(); });
 	}
 
 	/** Serialize or deserialize data depending on access rights
@@ -274,64 +147,74 @@ struct serialize_plugin: PDI::Plugin {
 	{
 		std::string serialized_name = m_desc_to_serialize[desc_name];
 		context().logger().debug("Serializing `{}` as `{}`", desc_name, serialized_name);
-		PDI::Datatype_sptr serialized_type = serialize_type(ref.type());
+		const serialize::Serialization_plan& serialization_plan = plan(desc_name, ref.type());
+		PDI::Datatype_sptr serialized_type = serialization_plan.serialized_type();
 		context().logger().debug("Type after serialization:\n {}", serialized_type->debug_string());
 
 		if (PDI::Ref_rw ref_rw = ref) {
-			context().logger().trace("PDI_INOUT -> allocate memory, serialize_copy, share PDI_INOUT, deserialize_copy on reclaim");
+			context().logger().trace("PDI_INOUT -> allocate memory, serialize, share PDI_INOUT, deserialize on reclaim");
 
-			context().logger().trace("Allocating memory: {} B", serialized_type->buffersize());
-			PDI::Ref serialized_ref{operator new (serialized_type->buffersize()), [](void* p) { operator delete (p); }, serialized_type, true, true};
+			PDI::Ref serialized_ref = this->serialized_ref(serialization_plan, ref_rw.get(), true, true);
 
-			context().logger().trace("Copy data to `{}' descriptor", serialized_name);
-			size_t bytes_copied = serialize_copy(ref.type(), PDI::Ref_w{serialized_ref}.get(), ref_rw.get());
-			if (bytes_copied != serialized_type->datasize()) {
-				throw PDI::Value_error{"Serialize plugin: `{}' Serialized {} B of {} B", desc_name, bytes_copied, serialized_type->buffersize()};
+			if (!serialization_plan.contiguous()) {
+				context().logger().trace("Copy data to `{}' descriptor", serialized_name);
+				size_t bytes_copied = serialization_plan.serialize(PDI::Ref_w{serialized_ref}.get(), ref_rw.get(), threads(serialization_plan));
+				if (bytes_copied != serialized_type->datasize()) {
+					throw PDI::Value_error{"Serialize plugin: `{}' Serialized {} B of {} B", desc_name, bytes_copied, serialized_type->buffersize()};
+				}
 			}
 
 			context().logger().trace("Sharing `{}' PDI_INOUT", serialized_name);
 			context().desc(serialized_name).share(serialized_ref, false, false);
+			if (serialization_plan.contiguous()) {
+				alias(ref, serialized_ref);
+			}
 			std::function<void()> remove_callback = context().callbacks().add_data_remove_callback(
 				[this](const std::string& desc_name, PDI::Ref ref) { release_serialized(desc_name, ref); },
 				desc_name
 			);
-			m_serialized_remove_callback.emplace_back(serialized_name, remove_callback, PDI_INOUT);
+			m_serialized_remove_callback.emplace_back(serialized_name, remove_callback, PDI_INOUT, serialization_plan.contiguous());
 
 		} else if (PDI::Ref_r ref_r = ref) {
-			context().logger().trace("PDI_OUT -> allocate memory, serialize_copy, then share PDI_OUT");
+			context().logger().trace("PDI_OUT -> allocate memory, serialize, then share PDI_OUT");
 
-			// allocate memory
-			context().logger().trace("Allocating memory: {} B", serialized_type->buffersize());
-			PDI::Ref serialized_ref{operator new (serialized_type->buffersize()), [](void* p) { operator delete (p); }, serialized_type, true, true};
+			// a reference in place of the data shared PDI_OUT must stay read-only
+			PDI::Ref serialized_ref = this->serialized_ref(serialization_plan, const_cast<void*>(ref_r.get()), true, !serialization_plan.contiguous());
 
 			// copy
-			context().logger().trace("Copy data to `{}' descriptor", serialized_name);
-			size_t bytes_copied = serialize_copy(ref.type(), PDI::Ref_w{serialized_ref}.get(), ref_r.get());
-			if (bytes_copied != serialized_type->datasize()) {
-				throw PDI::Value_error{"Serialize plugin: `{}' Serialized {} B of {} B ", desc_name, bytes_copied, serialized_type->buffersize()};
+			if (!serialization_plan.contiguous()) {
+				context().logger().trace("Copy data to `{}' descriptor", serialized_name);
+				size_t bytes_copied = serialization_plan.serialize(PDI::Ref_w{serialized_ref}.get(), ref_r.get(), threads(serialization_plan));
+				if (bytes_copied != serialized_type->datasize()) {
+					throw PDI::Value_error{"Serialize plugin: `{}' Serialized {} B of {} B ", desc_name, bytes_copied, serialized_type->buffersize()};
+				}
 			}
 			context().logger().trace("Sharing `{}' PDI_OUT", serialized_name);
 			context().desc(serialized_name).share(serialized_ref, true, false);
+			if (serialization_plan.contiguous()) {
+				alias(ref, serialized_ref);
+			}
 			std::function<void()> remove_callback = context().callbacks().add_data_remove_callback(
 				[this](const std::string& desc_name, PDI::Ref ref) { release_serialized(desc_name, ref); },
 				desc_name
 			);
-			m_serialized_remove_callback.emplace_back(serialized_name, remove_callback, PDI_OUT);
+			m_serialized_remove_callback.emplace_back(serialized_name, remove_callback, PDI_OUT, serialization_plan.contiguous());
 
 		} else if (PDI::Ref_w ref_w{ref}) {
-			context().logger().trace("PDI_IN -> allocate memory, share PDI_IN, then deserialize_copy on reclaim");
+			context().logger().trace("PDI_IN -> allocate memory, share PDI_IN, then deserialize on reclaim");
 
-			// allocate memory
-			context().logger().trace("Allocating memory: {} B", serialized_type->buffersize());
-			PDI::Ref serialized_ref{operator new (serialized_type->buffersize()), [](void* p) { operator delete (p); }, serialized_type, false, true};
+			PDI::Ref serialized_ref = this->serialized_ref(serialization_plan, ref_w.get(), false, true);
 
 			context().logger().trace("Sharing `{}' PDI_IN", serialized_name);
 			context().desc(serialized_name).share(serialized_ref, false, false);
+			if (serialization_plan.contiguous()) {
+				alias(ref, serialized_ref);
+			}
 			std::function<void()> remove_callback = context().callbacks().add_data_remove_callback(
 				[this](const std::string& desc_name, PDI::Ref ref) { release_serialized(desc_name, ref); },
 				desc_name
 			);
-			m_serialized_remove_callback.emplace_back(serialized_name, remove_callback, PDI_IN);
+			m_serialized_remove_callback.emplace_back(serialized_name, remove_callback, PDI_IN, serialization_plan.contiguous());
 		}
 	}
 
@@ -350,7 +233,9 @@ struct serialize_plugin: PDI::Plugin {
 			throw PDI::Value_error{"Serialize plugin: Cannot release not shared serialized data: {}", serialized_name};
 		}
 
-		if (std::get<2>(m_serialized_remove_callback[i]) & PDI_IN) {
+		if (std::get<3>(m_serialized_remove_callback[i])) {
+			context().logger().trace("`{}' shared in place, no deserialize copy", serialized_name);
+		} else if (std::get<2>(m_serialized_remove_callback[i]) & PDI_IN) {
 			// need to make a deserialize copy
 			PDI::Ref_w ref_w{ref};
 			if (!ref_w) {
@@ -363,7 +248,8 @@ struct serialize_plugin: PDI::Plugin {
 				throw PDI::Right_error{"Serialize plugin: Cannot get write access to serialized data: {}", serialized_name};
 			}
 
-			size_t bytes_copied = deserialize_copy(ref.type(), ref_w.get(), serialized_ref.get());
+			const serialize::Serialization_plan& serialization_plan = plan(desc_name, ref.type());
+			size_t bytes_copied = serialization_plan.deserialize(ref_w.get(), serialized_ref.get(), threads(serialization_plan));
 			if (bytes_copied != serialized_ref.type()->datasize()) {
 				throw PDI::Value_error{
 					"Serialize plugin: `{}' Deserialized {} B of {} B",
@@ -386,6 +272,15 @@ struct serialize_plugin: PDI::Plugin {
 	{
 		PDI::each(config, [this](PC_tree_t key, PC_tree_t value) mutable {
 			std::string desc_name = PDI::to_string(key);
+			if (desc_name == "logging") {
+				return;
+			} else if (desc_name == "threads") {
+				m_threads = PDI::to_string(value);
+				return;
+			} else if (desc_name == "threads_threshold") {
+				m_threads_threshold = PDI::to_string(value);
+				return;
+			}
 			m_desc_to_serialize.emplace(desc_name, PDI::to_string(value));
 			context().logger().trace("`{}' will be serialized", desc_name);
 			context().callbacks().add_data_callback(
@@ -27,6 +27,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <memory>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -1115,3 +1116,249 @@ TEST(serialize_test, 07)
 
 	PDI_finalize();
 }
+
+/*
+ * Name:                serialize_test.08
+ *
+ * Description:         array of records and ghosted array serialization with a size changing between shares
+ */
+TEST(serialize_test, 08)
+{
+	const char* CONFIG_YAML
+		= "logging: trace                                     \n"
+		  "metadata:                                          \n"
+		  "  n: int                                           \n"
+		  "data:                                              \n"
+		  "  records:                                         \n"
+		  "    type: array                                    \n"
+		  "    size: 4                                        \n"
+		  "    subtype:                                       \n"
+		  "      type: struct                                 \n"
+		  "      members: [ {c: char}, {d: double}, {i: int} ]\n"
+		  "  ghosted:                                         \n"
+		  "    type: array                                    \n"
+		  "    subtype: int                                   \n"
+		  "    size: ['$n+2', '$n+2', '$n+2']                 \n"
+		  "    start: [1, 1, 1]                               \n"
+		  "    subsize: ['$n', '$n', '$n']                    \n"
+		  "plugins:                                           \n"
+		  "  serialize:                                       \n"
+		  "    records: records_serialized                    \n"
+		  "    ghosted: ghosted_serialized                    \n";
+
+	struct Record {
+		char c;
+		double d;
+		int i;
+	};
+
+	PDI_init(PC_parse_string(CONFIG_YAML));
+
+	Record records[4];
+	for (int i = 0; i < 4; i++) {
+		records[i] = Record{static_cast<char>('a' + i), i * 1.5, i * 10};
+	}
+	PDI_share("records", records, PDI_INOUT);
+	char* records_serialized;
+	PDI_access("records_serialized", (void**)&records_serialized, PDI_INOUT);
+	// serialized record: c at 0, d at 8, i at 16, size 24
+	for (int i = 0; i < 4; i++) {
+		EXPECT_EQ(records_serialized[i * 24], 'a' + i);
+		EXPECT_EQ(*reinterpret_cast<double*>(records_serialized + i * 24 + 8), i * 1.5);
+		EXPECT_EQ(*reinterpret_cast<int*>(records_serialized + i * 24 + 16), i * 10);
+		*reinterpret_cast<int*>(records_serialized + i * 24 + 16) = -i;
+	}
+	PDI_release("records_serialized");
+	PDI_reclaim("records");
+	for (int i = 0; i < 4; i++) {
+		EXPECT_EQ(records[i].c, 'a' + i);
+		EXPECT_EQ(records[i].d, i * 1.5);
+		EXPECT_EQ(records[i].i, -i);
+	}
+
+	// the ghosted array is serialized with 2 different sizes
+	for (int n = 2; n <= 3; n++) {
+		PDI_expose("n", &n, PDI_OUT);
+		int m = n + 2;
+		std::vector<int> ghosted(m * m * m);
+		for (int i = 0; i < m * m * m; i++) {
+			ghosted[i] = i;
+		}
+		PDI_share("ghosted", ghosted.data(), PDI_OUT);
+		int* ghosted_serialized;
+		PDI_access("ghosted_serialized", (void**)&ghosted_serialized, PDI_IN);
+		for (int i = 0; i < n; i++) {
+			for (int j = 0; j < n; j++) {
+				for (int k = 0; k < n; k++) {
+					EXPECT_EQ(ghosted_serialized[(i * n + j) * n + k], ((i + 1) * m + j + 1) * m + k + 1);
+				}
+			}
+		}
+		PDI_release("ghosted_serialized");
+		PDI_reclaim("ghosted");
+	}
+
+	PDI_finalize();
+}
+
+/*
+ * Name:                serialize_test.09
+ *
+ * Description:         data with the same layout after serialization shared in place without copy
+ */
+TEST(serialize_test, 09)
+{
+	const char* CONFIG_YAML
+		= "logging: trace                 \n"
+		  "metadata:                      \n"
+		  "  records_serialized:          \n"
+		  "    type: array                \n"
+		  "    size: 4                    \n"
+		  "    subtype:                   \n"
+		  "      type: struct             \n"
+		  "      members: [ {c: char}, {d: double} ]\n"
+		  "data:                          \n"
+		  "  dense_array:                 \n"
+		  "    type: array                \n"
+		  "    subtype: double            \n"
+		  "    size: [4, 8]               \n"
+		  "  sparse_array:                \n"
+		  "    type: array                \n"
+		  "    subtype: int               \n"
+		  "    size: [8, 4]               \n"
+		  "    start: [2, 0]              \n"
+		  "    subsize: [4, 4]            \n"
+		  "  records:                     \n"
+		  "    type: array                \n"
+		  "    size: 4                    \n"
+		  "    subtype:                   \n"
+		  "      type: struct             \n"
+		  "      members: [ {c: char}, {d: double} ]\n"
+		  "plugins:                       \n"
+		  "  serialize:                   \n"
+		  "    dense_array: dense_serialized  \n"
+		  "    sparse_array: sparse_serialized\n"
+		  "    records: records_serialized    \n";
+
+	PDI_init(PC_parse_string(CONFIG_YAML));
+
+	double dense_array[4][8];
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 8; j++) {
+			dense_array[i][j] = i * 8 + j;
+		}
+	}
+	PDI_share("dense_array", dense_array, PDI_INOUT);
+	double* dense_serialized;
+	PDI_access("dense_serialized", (void**)&dense_serialized, PDI_INOUT);
+	EXPECT_EQ(dense_serialized, &dense_array[0][0]);
+	dense_serialized[9] = -1;
+	PDI_release("dense_serialized");
+	PDI_reclaim("dense_array");
+	EXPECT_EQ(dense_array[1][1], -1);
+	EXPECT_EQ(dense_array[1][2], 10);
+
+	// only the contiguous rows 2 to 5 are serialized
+	int sparse_array[8][4];
+	PDI_share("sparse_array", sparse_array, PDI_IN);
+	int* sparse_serialized;
+	PDI_access("sparse_serialized", (void**)&sparse_serialized, PDI_OUT);
+	EXPECT_EQ(sparse_serialized, &sparse_array[2][0]);
+	for (int i = 0; i < 16; i++) {
+		sparse_serialized[i] = i;
+	}
+	PDI_release("sparse_serialized");
+	PDI_reclaim("sparse_array");
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) {
+			EXPECT_EQ(sparse_array[i + 2][j], i * 4 + j);
+		}
+	}
+
+	// records keep their padding once serialized
+	struct Record {
+		char c;
+		double d;
+	};
+	Record records[4];
+	for (int i = 0; i < 4; i++) {
+		records[i] = Record{static_cast<char>(i), i * 1.5};
+	}
+	PDI_share("records", records, PDI_OUT);
+	Record* records_serialized;
+	PDI_access("records_serialized", (void**)&records_serialized, PDI_IN);
+	EXPECT_EQ(records_serialized, records);
+	PDI_release("records_serialized");
+	PDI_reclaim("records");
+
+	// the serialized metadata kept in place is nullified with the reclaimed data
+	PDI_errhandler(PDI_NULL_HANDLER);
+	PDI_status_t status = PDI_access("records_serialized", (void**)&records_serialized, PDI_IN);
+	EXPECT_NE(status, PDI_OK) << "Serialized data still references the reclaimed data";
+
+	PDI_finalize();
+}
+
+/*
+ * Name:                serialize_test.10
+ *
+ * Description:         multithreaded serialization and deserialization of a ghosted array of records
+ */
+TEST(serialize_test, 10)
+{
+	const char* CONFIG_YAML
+		= "logging: trace                                         \n"
+		  "data:                                                  \n"
+		  "  records:                                             \n"
+		  "    type: array                                        \n"
+		  "    size: [12, 7]                                      \n"
+		  "    start: [1, 1]                                      \n"
+		  "    subsize: [10, 5]                                   \n"
+		  "    subtype:                                           \n"
+		  "      type: struct                                     \n"
+		  "      members: [ {c: char}, {d: double}, {i: int} ]    \n"
+		  "plugins:                                               \n"
+		  "  serialize:                                           \n"
+		  "    threads: 3                                         \n"
+		  "    threads_threshold: 0                               \n"
+		  "    records: records_serialized                        \n";
+
+	struct Record {
+		char c;
+		double d;
+		int i;
+	};
+
+	PDI_init(PC_parse_string(CONFIG_YAML));
+
+	Record records[12][7];
+	for (int i = 0; i < 12; i++) {
+		for (int j = 0; j < 7; j++) {
+			records[i][j] = Record{static_cast<char>(i), i * 1.5, j};
+		}
+	}
+	PDI_share("records", records, PDI_INOUT);
+	Record* records_serialized;
+	PDI_access("records_serialized", (void**)&records_serialized, PDI_INOUT);
+	for (int i = 0; i < 10; i++) {
+		for (int j = 0; j < 5; j++) {
+			EXPECT_EQ(records_serialized[i * 5 + j].c, i + 1);
+			EXPECT_EQ(records_serialized[i * 5 + j].d, (i + 1) * 1.5);
+			EXPECT_EQ(records_serialized[i * 5 + j].i, j + 1);
+			records_serialized[i * 5 + j].i = -(i * 5 + j);
+		}
+	}
+	PDI_release("records_serialized");
+	PDI_reclaim("records");
+	for (int i = 0; i < 12; i++) {
+		for (int j = 0; j < 7; j++) {
+			if (i >= 1 && i <= 10 && j >= 1 && j <= 5) {
+				EXPECT_EQ(records[i][j].i, -((i - 1) * 5 + j - 1));
+			} else {
+				EXPECT_EQ(records[i][j].i, j);
+			}
+		}
+	}
+
+	PDI_finalize();
+}
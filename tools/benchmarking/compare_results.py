@@ -57,23 +57,37 @@ def check_system(result_1_context, result_2_context):
                 setting_warning("Level " + str(cache_1["level"]) + " " + cache_1["type"] + " cache exists",
                                 "Level " + str(cache_1["level"]) + " " + cache_1["type"] + " cache doesn't exist")
 
+def test_time(test):
+    # benchmarks timed manually or in real time (e.g. MPI ones) report a meaningless cpu_time
+    if test["name"].endswith("/manual_time") or test["name"].endswith("/real_time"):
+        return test["real_time"]
+    return test["cpu_time"]
+
 def compare_test(result_1_test, result_2_test, test_significance):
-    if (result_1_test["cpu_time"] * test_significance < result_2_test["cpu_time"]) :
+    result_1_time = test_time(result_1_test)
+    result_2_time = test_time(result_2_test)
+    regression = result_1_time * test_significance < result_2_time
+    if (regression) :
         print("{:<50} \033[92m{:<30} \033[91m{:<30}\033[0m".format(result_1_test["name"],
-                                             "{:.5f}".format(result_1_test["cpu_time"]) + " " + result_1_test["time_unit"],
-                                             "{:.5f}".format(result_2_test["cpu_time"]) + " " + result_2_test["time_unit"]))
-    elif (result_2_test["cpu_time"] * test_significance < result_1_test["cpu_time"]):
+                                             "{:.5f}".format(result_1_time) + " " + result_1_test["time_unit"],
+                                             "{:.5f}".format(result_2_time) + " " + result_2_test["time_unit"]))
+    elif (result_2_time * test_significance < result_1_time):
         print("{:<50} \033[91m{:<30} \033[92m{:<30}\033[0m".format(result_1_test["name"],
-                                             "{:.5f}".format(result_1_test["cpu_time"]) + " " + result_1_test["time_unit"],
-                                             "{:.5f}".format(result_2_test["cpu_time"]) + " " + result_2_test["time_unit"]))
+                                             "{:.5f}".format(result_1_time) + " " + result_1_test["time_unit"],
+                                             "{:.5f}".format(result_2_time) + " " + result_2_test["time_unit"]))
     else:
         print("{:<50} {:<30} {:<30}".format(result_1_test["name"],
-                                             "{:.5f}".format(result_1_test["cpu_time"]) + " " + result_1_test["time_unit"],
-                                             "{:.5f}".format(result_2_test["cpu_time"]) + " " + result_2_test["time_unit"]))
+                                             "{:.5f}".format(result_1_time) + " " + result_1_test["time_unit"],
+                                             "{:.5f}".format(result_2_time) + " " + result_2_test["time_unit"]))
+    return regression
 
 if __name__ == "__main__":
+    # in threshold mode, the script fails if any benchmark of the second file is slower
+    threshold_mode = "--threshold" in sys.argv
+    sys.argv = [arg for arg in sys.argv if arg != "--threshold"]
     if len(sys.argv) < 3:
-        print("Usage: " + sys.argv[0] + " <result_file_1> <result_file_2> <test_significance>")
+        print("Usage: " + sys.argv[0] + " [--threshold] <result_file_1> <result_file_2> <test_significance>")
+        sys.exit(2)
 
     if len(sys.argv) == 4:
         test_significance = 1.0 + float(sys.argv[3])
@@ -86,8 +100,16 @@ if __name__ == "__main__":
             result_2_root = json.load(result_file_2)
             check_system(result_1_root["context"], result_2_root["context"])
             print("\033[1m{:<50} {:<30} {:<30}\033[0m".format("Benchmark name", sys.argv[1], sys.argv[2]))
+            regressions = []
             for benchmark_1 in result_1_root["benchmarks"]:
                 for benchmark_2 in result_2_root["benchmarks"]:
                     if (benchmark_1["name"] == benchmark_2["name"]):
-                        compare_test(benchmark_1, benchmark_2, test_significance)
+                        if compare_test(benchmark_1, benchmark_2, test_significance):
+                            regressions.append(benchmark_1["name"])
                         continue
+
+    if threshold_mode and regressions:
+        print("[ERROR] " + str(len(regressions)) + " benchmark(s) slower than the threshold:")
+        for name in regressions:
+            print("    " + name)
+        sys.exit(1)
@@ -0,0 +1,62 @@
+#*******************************************************************************
+# Copyright (C) 2025 Commissariat a l'energie atomique et aux energies alternatives (CEA)
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+# * Redistributions of source code must retain the above copyright
+#   notice, this list of conditions and the following disclaimer.
+# * Redistributions in binary form must reproduce the above copyright
+#   notice, this list of conditions and the following disclaimer in the
+#   documentation and/or other materials provided with the distribution.
+# * Neither the name of CEA nor the names of its contributors may be used to
+#   endorse or promote products derived from this software without specific
+#   prior written permission.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+import json
+import sys
+
+from compare_results import test_time
+
+# raw I/O libraries or hand-written code the PDI benchmarks are compared to
+REFERENCES = ["HDF5_", "NetCDF_", "Manual_"]
+
+def references(name):
+    # `Family/PDI_case/args` is compared to `Family/HDF5_case/args`, `Family/NetCDF_case/args` or `Family/Manual_case/args`
+    parts = name.split("/")
+    if len(parts) < 2 or not parts[1].startswith("PDI_"):
+        return []
+    case = parts[1][len("PDI_"):]
+    return ["/".join(parts[:1] + [prefix + case] + parts[2:]) for prefix in REFERENCES]
+
+def bandwidth(test):
+    if "bytes_per_second" not in test:
+        return ""
+    return "{:.2f} MiB/s".format(test["bytes_per_second"] / (1 << 20))
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        print("Usage: " + sys.argv[0] + " <result_file>")
+        sys.exit(2)
+
+    with open(sys.argv[1], "r") as result_file:
+        benchmarks = json.load(result_file)["benchmarks"]
+    by_name = {benchmark["name"]: benchmark for benchmark in benchmarks}
+    print("\033[1m{:<70} {:<16} {:<16} {:<10}\033[0m".format("Benchmark name", "PDI", "Reference", "Overhead"))
+    for benchmark in benchmarks:
+        for reference_name in references(benchmark["name"]):
+            reference = by_name.get(reference_name)
+            if reference is None:
+                continue
+            pdi_time = test_time(benchmark)
+            reference_time = test_time(reference)
+            print("{:<70} {:<16} {:<16} {:+.1f}%".format(benchmark["name"], bandwidth(benchmark), bandwidth(reference),
+                                                          100.0 * (pdi_time - reference_time) / reference_time))